@@ -0,0 +1,190 @@
+#include "AllocTracker.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <new>
+#include <atomic>
+
+static thread_local AllocTag gCurrentTag = ALLOC_TAG_GENERAL;
+
+static const char *gAllocTagNames[ALLOC_TAG_COUNT] = {
+    "general",
+    "animation",
+    "mesh",
+    "texture",
+    "shader",
+    "ecs",
+    "collision"
+};
+
+AllocTagScope::AllocTagScope(AllocTag tag) {
+    mPrevious = gCurrentTag;
+    gCurrentTag = tag;
+}
+
+AllocTagScope::~AllocTagScope() {
+    gCurrentTag = mPrevious;
+}
+
+const char *AllocTagName(AllocTag tag) {
+    return gAllocTagNames[tag];
+}
+
+AllocTag AllocTagCurrent() {
+    return gCurrentTag;
+}
+
+#ifdef ALLOC_TRACKING_ENABLED
+
+#define ALLOC_MAGIC 0xA110CA7E
+
+// Every tracked block starts with a header, 16 bytes to keep the alignment
+struct AllocHeader {
+    size_t mSize;
+    unsigned int mTag;
+    unsigned int mMagic;
+};
+
+static std::atomic<long long> gLiveBytes[ALLOC_TAG_COUNT];
+static std::atomic<long long> gLiveCount[ALLOC_TAG_COUNT];
+static std::atomic<long long> gTotalCount[ALLOC_TAG_COUNT];
+static std::atomic<unsigned int> gFrameAllocations;
+static std::atomic<size_t> gFrameBytes;
+static unsigned int gLastFrameAllocations;
+static size_t gLastFrameBytes;
+static std::atomic<bool> gSteadyState;
+
+static void *TrackAllocation(void *block, size_t size, AllocTag tag) {
+    AllocHeader *header = (AllocHeader *)block;
+    header->mSize = size;
+    header->mTag = tag;
+    header->mMagic = ALLOC_MAGIC;
+    gLiveBytes[tag] += (long long)size;
+    gLiveCount[tag]++;
+    gTotalCount[tag]++;
+    gFrameAllocations++;
+    gFrameBytes += size;
+    if(gSteadyState) {
+        printf("Allocation of %zu bytes tagged %s in a steady state frame\n", size, gAllocTagNames[tag]);
+        assert(!"heap allocation in a steady state frame");
+    }
+    return header + 1;
+}
+
+static AllocHeader *UntrackAllocation(void *ptr) {
+    AllocHeader *header = (AllocHeader *)ptr - 1;
+    assert(header->mMagic == ALLOC_MAGIC && "freeing memory the tracker does not own");
+    gLiveBytes[header->mTag] -= (long long)header->mSize;
+    gLiveCount[header->mTag]--;
+    header->mMagic = 0;
+    return header;
+}
+
+void *TrackedMalloc(size_t size, AllocTag tag) {
+    void *block = malloc(sizeof(AllocHeader) + size);
+    if(!block) {
+        return 0;
+    }
+    return TrackAllocation(block, size, tag);
+}
+
+void *TrackedRealloc(void *ptr, size_t size, AllocTag tag) {
+    if(!ptr) {
+        return TrackedMalloc(size, tag);
+    }
+    AllocHeader *header = UntrackAllocation(ptr);
+    void *block = realloc(header, sizeof(AllocHeader) + size);
+    if(!block) {
+        return 0;
+    }
+    return TrackAllocation(block, size, tag);
+}
+
+void TrackedFree(void *ptr) {
+    if(!ptr) {
+        return;
+    }
+    free(UntrackAllocation(ptr));
+}
+
+void AllocTrackerBeginFrame() {
+    gFrameAllocations = 0;
+    gFrameBytes = 0;
+}
+
+void AllocTrackerEndFrame() {
+    gLastFrameAllocations = gFrameAllocations;
+    gLastFrameBytes = gFrameBytes;
+}
+
+void AllocTrackerSetSteadyState(bool steadyState) {
+    gSteadyState = steadyState;
+}
+
+unsigned int AllocTrackerLastFrameAllocations() {
+    return gLastFrameAllocations;
+}
+
+size_t AllocTrackerLastFrameBytes() {
+    return gLastFrameBytes;
+}
+
+size_t AllocTrackerLiveBytes(AllocTag tag) {
+    return (size_t)gLiveBytes[tag].load();
+}
+
+void AllocTrackerReport() {
+    printf("Heap by tag:\n");
+    for(int tag = 0; tag < ALLOC_TAG_COUNT; ++tag) {
+        printf("  %-10s live %10lld bytes in %6lld blocks, %8lld allocations total\n",
+               gAllocTagNames[tag], gLiveBytes[tag].load(), gLiveCount[tag].load(), gTotalCount[tag].load());
+    }
+    printf("  last frame: %u allocations, %zu bytes\n", gLastFrameAllocations, gLastFrameBytes);
+}
+
+// Global replacements, everything that goes through new gets the current tag
+void *operator new(size_t size) {
+    void *ptr = TrackedMalloc(size, gCurrentTag);
+    if(!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return TrackedMalloc(size, gCurrentTag);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return TrackedMalloc(size, gCurrentTag);
+}
+
+void operator delete(void *ptr) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    TrackedFree(ptr);
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _ALLOCTRACKER_H_
+#define _ALLOCTRACKER_H_
+
+#include <stddef.h>
+#include <stdlib.h>
+
+// Debug builds replace the global operator new/delete to count every heap
+// allocation by subsystem tag. Define ALLOC_TRACKING_DISABLED to opt out
+#if defined(_APP_DEBUG) && !defined(ALLOC_TRACKING_DISABLED)
+#define ALLOC_TRACKING_ENABLED
+#endif
+
+enum AllocTag {
+    ALLOC_TAG_GENERAL,
+    ALLOC_TAG_ANIMATION,
+    ALLOC_TAG_MESH,
+    ALLOC_TAG_TEXTURE,
+    ALLOC_TAG_SHADER,
+    ALLOC_TAG_ECS,
+    ALLOC_TAG_COLLISION,
+    ALLOC_TAG_COUNT
+};
+
+// Allocations made while the scope is alive get the tag, scopes nest
+struct AllocTagScope {
+    AllocTag mPrevious;
+
+    AllocTagScope(AllocTag tag);
+    ~AllocTagScope();
+};
+
+const char *AllocTagName(AllocTag tag);
+AllocTag AllocTagCurrent();
+
+#ifdef ALLOC_TRACKING_ENABLED
+
+// malloc style allocations that show up in the tracker
+void *TrackedMalloc(size_t size, AllocTag tag);
+void *TrackedRealloc(void *ptr, size_t size, AllocTag tag);
+void TrackedFree(void *ptr);
+
+void AllocTrackerBeginFrame();
+void AllocTrackerEndFrame();
+// While set any allocation asserts, the game loop sets it after warm up
+void AllocTrackerSetSteadyState(bool steadyState);
+unsigned int AllocTrackerLastFrameAllocations();
+size_t AllocTrackerLastFrameBytes();
+size_t AllocTrackerLiveBytes(AllocTag tag);
+void AllocTrackerReport();
+
+#else
+
+inline void *TrackedMalloc(size_t size, AllocTag) { return malloc(size); }
+inline void *TrackedRealloc(void *ptr, size_t size, AllocTag) { return realloc(ptr, size); }
+inline void TrackedFree(void *ptr) { free(ptr); }
+
+inline void AllocTrackerBeginFrame() { }
+inline void AllocTrackerEndFrame() { }
+inline void AllocTrackerSetSteadyState(bool) { }
+inline unsigned int AllocTrackerLastFrameAllocations() { return 0; }
+inline size_t AllocTrackerLastFrameBytes() { return 0; }
+inline size_t AllocTrackerLiveBytes(AllocTag) { return 0; }
+inline void AllocTrackerReport() { }
+
+#endif
+
+#endif
@@ -0,0 +1,117 @@
+#include "AnimationLod.h"
+#include "Defines.h"
+
+#include <cmath>
+
+#define ANIMATION_LOD_BOUNDS_RATE 30.0f
+
+// The joint volumes are in the bind space of their joint, so the global
+// transform of the joint in a pose takes them to model space
+static void GrowBounds(Sphere &sphere, const MeshBounds &bounds, Pose &pose) {
+    unsigned int count = pose.Size() < (unsigned int)bounds.mJoints.size() ? pose.Size() : (unsigned int)bounds.mJoints.size();
+    for(unsigned int i = 0; i < count; ++i) {
+        const BoundingVolume &volume = bounds.mJoints[i];
+        if(!volume.mValid) {
+            continue;
+        }
+        Transform joint = pose.GetGlobalTransform(i);
+        float scale = fmaxf(fabsf(joint.mScale.x), fmaxf(fabsf(joint.mScale.y), fabsf(joint.mScale.z)));
+        float reach = len(transformPoint(joint, volume.mSphere.c) - sphere.c) + volume.mSphere.r * scale;
+        sphere.r = fmaxf(sphere.r, reach);
+    }
+}
+
+void AnimationLod::Initialize(cgltf_data *data, Pose &restPose, const MeshBounds &bounds, std::vector<Clip> &clips) {
+    mDistances[0] = 15.0f;
+    mDistances[1] = 30.0f;
+    mIntervals[0] = 1;
+    mIntervals[1] = 2;
+    mIntervals[2] = 4;
+    mReducedLevel = 2;
+    // A standing character when the mesh had no bounds
+    mBounds.c = vec3(0, 1.75f, 0);
+    mBounds.r = 1.75f;
+    if(bounds.mMesh.mValid) {
+        // Fitted to the bind pose, a death or a jump reaches further than that
+        mBounds = bounds.mMesh.mSphere;
+        Pose pose = restPose;
+        for(unsigned int i = 0; i < (unsigned int)clips.size(); ++i) {
+            Clip &clip = clips[i];
+            for(float time = clip.mStartTime; time < clip.mEndTime; time += 1.0f / ANIMATION_LOD_BOUNDS_RATE) {
+                clip.Sample(pose, time);
+                GrowBounds(mBounds, bounds, pose);
+            }
+            clip.Sample(pose, clip.mEndTime);
+            GrowBounds(mBounds, bounds, pose);
+        }
+    }
+
+    unsigned int jointCount = restPose.Size();
+    mReducedMask = JointMask().Inverted(jointCount);
+    const char *details[] = {
+        "mixamorig:LeftHand", "mixamorig:RightHand", "mixamorig:Head",
+        "mixamorig:LeftToeBase", "mixamorig:RightToeBase"
+    };
+    for(unsigned int i = 0; i < ArrayCount(details); ++i) {
+        int joint = FindJointIndex(data, details[i]);
+        if(joint >= 0) {
+            mReducedMask.mBits &= ~GetSubtreeMask(restPose, (unsigned int)joint).mBits;
+        }
+    }
+    // The hips carry the root motion, skeletons without them keep their top joints
+    mRootMask = JointMask();
+    int hips = FindJointIndex(data, "mixamorig:Hips");
+    for(unsigned int i = 0; i < jointCount; ++i) {
+        if((int)i == hips || (hips < 0 && restPose.GetParent(i) < 0)) {
+            mRootMask.Set(i);
+        }
+    }
+
+    SetProjection(60.0f, 16.0f / 9.0f, 100.0f);
+    SetView(vec3(0, 0, 0), vec3(0, 0, -1));
+    mFrame = 0;
+    for(unsigned int i = 0; i <= ANIMATION_LOD_LEVELS; ++i) {
+        mLevelCounts[i] = 0;
+    }
+    mSampledCount = 0;
+}
+
+void AnimationLod::SetProjection(float fovY, float aspect, float far) {
+    // The corners of the frustum are the furthest from its axis
+    float tanHalf = tanf(TO_RAD(fovY) * 0.5f);
+    mHalfAngle = atanf(tanHalf * sqrtf(1.0f + aspect * aspect));
+    mFar = far;
+}
+
+void AnimationLod::SetView(const vec3 &position, const vec3 &front) {
+    mCameraPosition = position;
+    mCameraFront = normalized(front);
+    mFrame++;
+}
+
+unsigned int AnimationLod::Select(const Transform &model) {
+    vec3 toCenter = transformPoint(model, mBounds.c) - mCameraPosition;
+    float scale = fmaxf(fabsf(model.mScale.x), fmaxf(fabsf(model.mScale.y), fabsf(model.mScale.z)));
+    float radius = mBounds.r * scale;
+    float distance = len(toCenter);
+    if(distance > radius) {
+        if(distance - radius > mFar) {
+            return ANIMATION_LOD_CULLED;
+        }
+        float cosAngle = fminf(fmaxf(dot(toCenter, mCameraFront) / distance, -1.0f), 1.0f);
+        if(acosf(cosAngle) - asinf(radius / distance) > mHalfAngle) {
+            return ANIMATION_LOD_CULLED;
+        }
+    }
+    unsigned int level = 0;
+    while(level < ANIMATION_LOD_LEVELS - 1 && distance > mDistances[level]) {
+        level++;
+    }
+    return level;
+}
+
+bool AnimationLod::IsDue(unsigned int level, unsigned int stagger) {
+    // Culled characters keep the rate of the furthest level
+    unsigned int interval = mIntervals[level < ANIMATION_LOD_LEVELS ? level : ANIMATION_LOD_LEVELS - 1];
+    return (mFrame + stagger) % interval == 0;
+}
@@ -0,0 +1,54 @@
+#ifndef _ANIMATIONLOD_H_
+#define _ANIMATIONLOD_H_
+
+#include <cgltf.h>
+#include <vector>
+#include "Pose.h"
+#include "JointMask.h"
+#include "Clip.h"
+#include "BoundingVolume.h"
+
+#define ANIMATION_LOD_LEVELS 3
+// Level of the characters outside the view, only the root is sampled
+#define ANIMATION_LOD_CULLED ANIMATION_LOD_LEVELS
+
+// Picks how much animation work a character gets from where it is relative
+// to the camera. Each level further away is updated every mIntervals[level]
+// frames, characters of a level are staggered across those frames by a
+// per-character number so the work is spread evenly. From mReducedLevel on
+// only the joints in mReducedMask are sampled
+struct AnimationLod {
+    // A character past mDistances[i] uses level i + 1
+    float mDistances[ANIMATION_LOD_LEVELS - 1];
+    unsigned int mIntervals[ANIMATION_LOD_LEVELS];
+    unsigned int mReducedLevel;
+    JointMask mReducedMask;
+    JointMask mRootMask;
+    // Bounding sphere of a character in model space, holds every pose of its clips
+    Sphere mBounds;
+
+    // Cone around the view direction holding the whole view frustum
+    vec3 mCameraPosition;
+    vec3 mCameraFront;
+    float mHalfAngle;
+    float mFar;
+    unsigned int mFrame;
+
+    // Characters per level (culled last) and characters sampled, last update
+    unsigned int mLevelCounts[ANIMATION_LOD_LEVELS + 1];
+    unsigned int mSampledCount;
+
+    // The hands, head and toes with everything below them (fingers, face)
+    // are left out of the reduced set, they are found by their Mixamo names.
+    // The mesh sphere of bounds is grown to hold the joint volumes of bounds
+    // in the poses of clips, sampled 30 times a second
+    void Initialize(cgltf_data *data, Pose &restPose, const MeshBounds &bounds, std::vector<Clip> &clips);
+    void SetProjection(float fovY, float aspect, float far);
+    // Call once a frame before the animation system
+    void SetView(const vec3 &position, const vec3 &front);
+    unsigned int Select(const Transform &model);
+    // True when a character of this level and stagger number is sampled this frame
+    bool IsDue(unsigned int level, unsigned int stagger);
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "Arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "AllocTracker.h"
+
+static FrameArena gFrameArena;
+static Arena gScratchArena;
+
+void Arena::Initialize(size_t size, const char *name) {
+    mBase = (unsigned char *)TrackedMalloc(size, ALLOC_TAG_GENERAL);
+    mSize = size;
+    mUsed = 0;
+    mHighWater = 0;
+    mName = name;
+}
+
+void Arena::Shutdown() {
+    TrackedFree(mBase);
+    mBase = 0;
+    mSize = 0;
+    mUsed = 0;
+}
+
+void *Arena::Push(size_t size, size_t align) {
+    size_t start = (mUsed + align - 1) & ~(align - 1);
+    assert(start + size <= mSize && "arena out of memory");
+    if(start + size > mSize) {
+        return 0;
+    }
+    mUsed = start + size;
+    if(mUsed > mHighWater) {
+        mHighWater = mUsed;
+    }
+    return mBase + start;
+}
+
+void Arena::Reset() {
+    mUsed = 0;
+}
+
+size_t Arena::GetMarker() {
+    return mUsed;
+}
+
+void Arena::FreeToMarker(size_t marker) {
+    assert(marker <= mUsed);
+    mUsed = marker;
+}
+
+void Arena::Report() {
+    printf("Arena %s: high water %zu / %zu bytes (%.1f%%)\n",
+           mName, mHighWater, mSize, 100.0 * (double)mHighWater / (double)mSize);
+}
+
+void FrameArena::Initialize(size_t size) {
+    mArenas[0].Initialize(size, "frame 0");
+    mArenas[1].Initialize(size, "frame 1");
+    mCurrent = 0;
+}
+
+void FrameArena::Shutdown() {
+    mArenas[0].Shutdown();
+    mArenas[1].Shutdown();
+}
+
+Arena *FrameArena::Current() {
+    return &mArenas[mCurrent];
+}
+
+void FrameArena::EndFrame() {
+    mCurrent ^= 1;
+    mArenas[mCurrent].Reset();
+}
+
+ScratchScope::ScratchScope() {
+    mArena = &gScratchArena;
+    mMarker = mArena->GetMarker();
+}
+
+ScratchScope::~ScratchScope() {
+    mArena->FreeToMarker(mMarker);
+}
+
+void MemoryInitialize() {
+    gFrameArena.Initialize(FRAME_ARENA_SIZE);
+    gScratchArena.Initialize(SCRATCH_ARENA_SIZE, "scratch");
+}
+
+void MemoryShutdown() {
+    gFrameArena.mArenas[0].Report();
+    gFrameArena.mArenas[1].Report();
+    gScratchArena.Report();
+    gFrameArena.Shutdown();
+    gScratchArena.Shutdown();
+}
+
+FrameArena *GetFrameArena() {
+    return &gFrameArena;
+}
+
+Arena *GetScratchArena() {
+    return &gScratchArena;
+}
@@ -0,0 +1,59 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+#include "Defines.h"
+
+#define FRAME_ARENA_SIZE Megabyte(4)
+#define SCRATCH_ARENA_SIZE Megabyte(16)
+
+// Linear allocator: Push bumps a pointer inside one fixed block, memory is
+// only given back all at once with Reset or down to a marker with FreeToMarker
+struct Arena {
+    unsigned char *mBase;
+    size_t mSize;
+    size_t mUsed;
+    size_t mHighWater;
+    const char *mName;
+
+    void Initialize(size_t size, const char *name);
+    void Shutdown();
+    void *Push(size_t size, size_t align = 16);
+    void Reset();
+    size_t GetMarker();
+    void FreeToMarker(size_t marker);
+    void Report();
+
+    template <typename T>
+    T *PushArray(size_t count) {
+        return (T *)Push(sizeof(T) * count, alignof(T) > 16 ? alignof(T) : 16);
+    }
+};
+
+// Two arenas swapped every frame: data pushed this frame stays valid until
+// the end of the next one, so it can still be read after the frame ends
+struct FrameArena {
+    Arena mArenas[2];
+    unsigned int mCurrent;
+
+    void Initialize(size_t size);
+    void Shutdown();
+    Arena *Current();
+    void EndFrame();
+};
+
+// Gives back everything pushed to the scratch arena inside the scope
+struct ScratchScope {
+    Arena *mArena;
+    size_t mMarker;
+
+    ScratchScope();
+    ~ScratchScope();
+};
+
+void MemoryInitialize();
+void MemoryShutdown();
+FrameArena *GetFrameArena();
+Arena *GetScratchArena();
+
+#endif
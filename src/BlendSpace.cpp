@@ -0,0 +1,286 @@
+#include "BlendSpace.h"
+#include "AllocTracker.h"
+#include "Profiler.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <assert.h>
+
+#define BLEND_SPACE_EPSILON 0.0001f
+
+static float Cross(const vec2 &a, const vec2 &b, const vec2 &c) {
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+// True when p is strictly inside the circle through a, b and c
+static bool InCircumcircle(const vec2 &p, const vec2 &a, const vec2 &b, const vec2 &c) {
+    float ax = a.x - p.x, ay = a.y - p.y;
+    float bx = b.x - p.x, by = b.y - p.y;
+    float cx = c.x - p.x, cy = c.y - p.y;
+    float det = (ax * ax + ay * ay) * (bx * cy - cx * by) -
+                (bx * bx + by * by) * (ax * cy - cx * ay) +
+                (cx * cx + cy * cy) * (ax * by - bx * ay);
+    return Cross(a, b, c) > 0.0f ? det > 0.0f : det < 0.0f;
+}
+
+void BlendSpace::Initialize(const Pose &restPose, bool is2D) {
+    mRestPose = restPose;
+    mPose = restPose;
+    mScratchPose = restPose;
+    mClipCount = 0;
+    mTriangleCount = 0;
+    m2D = is2D;
+    mParameter = vec2(0.0f, 0.0f);
+    mPhase = 0.0f;
+    mActiveCount = 0;
+    mRootTranslation = vec3(0, 0, 0);
+    mRootYaw = 0.0f;
+}
+
+void BlendSpace::AddClip(Clip *clip, vec2 position) {
+    assert(mClipCount < BLEND_SPACE_MAX_CLIPS && "blend space is full");
+    if(!m2D) {
+        position.y = 0.0f;
+    }
+    mClips[mClipCount] = clip;
+    mPositions[mClipCount] = position;
+    mClipCount++;
+}
+
+void BlendSpace::Build() {
+    if(!m2D) {
+        // Insertion sort by x, the 1D selection walks the points in order
+        for(unsigned int i = 1; i < mClipCount; ++i) {
+            for(unsigned int j = i; j > 0 && mPositions[j].x < mPositions[j - 1].x; --j) {
+                std::swap(mPositions[j], mPositions[j - 1]);
+                std::swap(mClips[j], mClips[j - 1]);
+            }
+        }
+        return;
+    }
+    Triangulate();
+}
+
+bool BlendSpace::Contains(Clip *clip) {
+    for(unsigned int i = 0; i < mClipCount; ++i) {
+        if(mClips[i] == clip) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BlendSpace::Update(float dt) {
+    if(!mClipCount) {
+        return;
+    }
+    PROFILE_SCOPE("BlendSpace::Update");
+    Select();
+
+    // The cycle length is the weighted average of the active clips
+    float duration = 0.0f;
+    for(unsigned int i = 0; i < mActiveCount; ++i) {
+        duration += mClips[mActive[i]]->GetDuration() * mWeights[i];
+    }
+    float previousPhase = mPhase;
+    if(duration > 0.0f) {
+        mPhase = fmodf(mPhase + dt / duration, 1.0f);
+    }
+
+    mRootTranslation = vec3(0, 0, 0);
+    mRootYaw = 0.0f;
+    for(unsigned int i = 0; i < mActiveCount; ++i) {
+        Clip *clip = mClips[mActive[i]];
+        vec3 translation;
+        float yaw;
+        clip->SampleRootMotion(clip->mStartTime + clip->GetDuration() * previousPhase,
+                               clip->mStartTime + clip->GetDuration() * mPhase, translation, yaw);
+        mRootTranslation = mRootTranslation + translation * mWeights[i];
+        mRootYaw += yaw * mWeights[i];
+    }
+
+    float total = 0.0f;
+    for(unsigned int i = 0; i < mActiveCount; ++i) {
+        Clip *clip = mClips[mActive[i]];
+        float time = clip->mStartTime + clip->GetDuration() * mPhase;
+        total += mWeights[i];
+        if(i == 0) {
+            mPose = mRestPose;
+            clip->Sample(mPose, time);
+            continue;
+        }
+        mScratchPose = mRestPose;
+        clip->Sample(mScratchPose, time);
+        Blend(mPose, mPose, mScratchPose, mWeights[i] / total);
+    }
+}
+
+Pose &BlendSpace::GetCurrentPose() {
+    return mPose;
+}
+
+// Bowyer-Watson: add the points one at a time to a triangle that covers all
+// of them, re-triangulating the hole left by the triangles whose circumcircle
+// holds the new point. Runs once at load so it uses plain vectors
+void BlendSpace::Triangulate() {
+    AllocTagScope tag(ALLOC_TAG_ANIMATION);
+    mTriangleCount = 0;
+    if(mClipCount < 3) {
+        return;
+    }
+
+    vec2 minimum = mPositions[0];
+    vec2 maximum = mPositions[0];
+    for(unsigned int i = 1; i < mClipCount; ++i) {
+        minimum = vec2(fminf(minimum.x, mPositions[i].x), fminf(minimum.y, mPositions[i].y));
+        maximum = vec2(fmaxf(maximum.x, mPositions[i].x), fmaxf(maximum.y, mPositions[i].y));
+    }
+    vec2 center = (minimum + maximum) * 0.5f;
+    float size = fmaxf(maximum.x - minimum.x, maximum.y - minimum.y) * 10.0f + 1.0f;
+
+    std::vector<vec2> points(mPositions, mPositions + mClipCount);
+    points.push_back(vec2(center.x - 2.0f * size, center.y - size));
+    points.push_back(vec2(center.x + 2.0f * size, center.y - size));
+    points.push_back(vec2(center.x, center.y + 2.0f * size));
+
+    struct Triangle { unsigned int v[3]; };
+    struct Edge { unsigned int a, b; };
+    std::vector<Triangle> triangles;
+    triangles.push_back({ { mClipCount, mClipCount + 1, mClipCount + 2 } });
+    std::vector<Edge> polygon;
+    for(unsigned int p = 0; p < mClipCount; ++p) {
+        polygon.clear();
+        for(unsigned int t = 0; t < (unsigned int)triangles.size();) {
+            Triangle &triangle = triangles[t];
+            if(!InCircumcircle(points[p], points[triangle.v[0]], points[triangle.v[1]], points[triangle.v[2]])) {
+                ++t;
+                continue;
+            }
+            // Edges shared by two removed triangles are inside the hole
+            for(unsigned int e = 0; e < 3; ++e) {
+                Edge edge = { triangle.v[e], triangle.v[(e + 1) % 3] };
+                bool shared = false;
+                for(unsigned int k = 0; k < (unsigned int)polygon.size(); ++k) {
+                    if((polygon[k].a == edge.b && polygon[k].b == edge.a) ||
+                       (polygon[k].a == edge.a && polygon[k].b == edge.b)) {
+                        polygon.erase(polygon.begin() + k);
+                        shared = true;
+                        break;
+                    }
+                }
+                if(!shared) {
+                    polygon.push_back(edge);
+                }
+            }
+            triangles[t] = triangles.back();
+            triangles.pop_back();
+        }
+        for(unsigned int e = 0; e < (unsigned int)polygon.size(); ++e) {
+            triangles.push_back({ { polygon[e].a, polygon[e].b, p } });
+        }
+    }
+
+    for(unsigned int t = 0; t < (unsigned int)triangles.size(); ++t) {
+        Triangle &triangle = triangles[t];
+        if(triangle.v[0] >= mClipCount || triangle.v[1] >= mClipCount || triangle.v[2] >= mClipCount) {
+            continue;
+        }
+        if(fabsf(Cross(points[triangle.v[0]], points[triangle.v[1]], points[triangle.v[2]])) < BLEND_SPACE_EPSILON) {
+            continue;
+        }
+        assert(mTriangleCount < BLEND_SPACE_MAX_TRIANGLES);
+        mTriangles[mTriangleCount][0] = triangle.v[0];
+        mTriangles[mTriangleCount][1] = triangle.v[1];
+        mTriangles[mTriangleCount][2] = triangle.v[2];
+        mTriangleCount++;
+    }
+}
+
+void BlendSpace::Select() {
+    mActiveCount = 0;
+    if(mClipCount == 1) {
+        mActive[0] = 0;
+        mWeights[0] = 1.0f;
+        mActiveCount = 1;
+        return;
+    }
+
+    if(!m2D) {
+        float x = mParameter.x;
+        unsigned int last = mClipCount - 1;
+        if(x <= mPositions[0].x || x >= mPositions[last].x) {
+            mActive[0] = x <= mPositions[0].x ? 0 : last;
+            mWeights[0] = 1.0f;
+            mActiveCount = 1;
+            return;
+        }
+        unsigned int i = 0;
+        while(x >= mPositions[i + 1].x) {
+            i++;
+        }
+        float t = (x - mPositions[i].x) / (mPositions[i + 1].x - mPositions[i].x);
+        mActive[0] = i;
+        mWeights[0] = 1.0f - t;
+        mActive[1] = i + 1;
+        mWeights[1] = t;
+        mActiveCount = 2;
+        return;
+    }
+
+    // Barycentric weights of the triangle holding the parameter
+    vec2 p = mParameter;
+    for(unsigned int t = 0; t < mTriangleCount; ++t) {
+        const vec2 &a = mPositions[mTriangles[t][0]];
+        const vec2 &b = mPositions[mTriangles[t][1]];
+        const vec2 &c = mPositions[mTriangles[t][2]];
+        float area = Cross(a, b, c);
+        float wa = Cross(p, b, c) / area;
+        float wb = Cross(a, p, c) / area;
+        float wc = 1.0f - wa - wb;
+        if(wa < -BLEND_SPACE_EPSILON || wb < -BLEND_SPACE_EPSILON || wc < -BLEND_SPACE_EPSILON) {
+            continue;
+        }
+        float weights[3] = { wa, wb, wc };
+        for(unsigned int k = 0; k < 3; ++k) {
+            if(weights[k] > BLEND_SPACE_EPSILON) {
+                mActive[mActiveCount] = mTriangles[t][k];
+                mWeights[mActiveCount] = weights[k];
+                mActiveCount++;
+            }
+        }
+        return;
+    }
+    SelectClosestEdge();
+}
+
+// Outside the triangulation, or with every point on a line, the parameter
+// is projected on the closest segment between two clips
+void BlendSpace::SelectClosestEdge() {
+    vec2 p = mParameter;
+    float bestDistance = -1.0f;
+    for(unsigned int i = 0; i < mClipCount; ++i) {
+        for(unsigned int j = i + 1; j < mClipCount; ++j) {
+            vec2 edge = mPositions[j] - mPositions[i];
+            float edgeLenSq = lenSq(edge);
+            float t = edgeLenSq > 0.0f ? dot(p - mPositions[i], edge) / edgeLenSq : 0.0f;
+            t = fminf(fmaxf(t, 0.0f), 1.0f);
+            float distance = lenSq(p - (mPositions[i] + edge * t));
+            if(bestDistance >= 0.0f && distance >= bestDistance) {
+                continue;
+            }
+            bestDistance = distance;
+            mActiveCount = 0;
+            if(1.0f - t > BLEND_SPACE_EPSILON) {
+                mActive[mActiveCount] = i;
+                mWeights[mActiveCount] = 1.0f - t;
+                mActiveCount++;
+            }
+            if(t > BLEND_SPACE_EPSILON) {
+                mActive[mActiveCount] = j;
+                mWeights[mActiveCount] = t;
+                mActiveCount++;
+            }
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef _BLENDSPACE_H_
+#define _BLENDSPACE_H_
+
+#include "Pose.h"
+#include "Clip.h"
+#include "Vec2.h"
+
+#define BLEND_SPACE_MAX_CLIPS 16
+// A Delaunay triangulation of n points has at most 2n - 5 triangles
+#define BLEND_SPACE_MAX_TRIANGLES (2 * BLEND_SPACE_MAX_CLIPS - 5)
+// Clips sampled per update, a point in a triangle or on a segment
+#define BLEND_SPACE_MAX_ACTIVE 3
+
+// Clips placed at points of a 1D (speed) or 2D (direction x speed) parameter
+// space. Every update picks the segment or triangle around the parameter and
+// samples at most three clips, weighted by where the parameter falls in it.
+// All clips play at the same normalized time so their footfalls line up
+struct BlendSpace {
+    Clip *mClips[BLEND_SPACE_MAX_CLIPS];
+    vec2 mPositions[BLEND_SPACE_MAX_CLIPS];
+    unsigned int mClipCount;
+    unsigned int mTriangles[BLEND_SPACE_MAX_TRIANGLES][3];
+    unsigned int mTriangleCount;
+    bool m2D;
+
+    vec2 mParameter;
+    // Normalized time shared by every clip, 0 to 1
+    float mPhase;
+    unsigned int mActive[BLEND_SPACE_MAX_ACTIVE];
+    float mWeights[BLEND_SPACE_MAX_ACTIVE];
+    unsigned int mActiveCount;
+    // Weighted root motion of the active clips over the last update, model space
+    vec3 mRootTranslation;
+    float mRootYaw;
+
+    Pose mPose;
+    Pose mScratchPose;
+    Pose mRestPose;
+
+    void Initialize(const Pose &restPose, bool is2D);
+    // 1D spaces only use position.x
+    void AddClip(Clip *clip, vec2 position);
+    // Sorts a 1D space or triangulates a 2D one, call once all clips are added
+    void Build();
+    bool Contains(Clip *clip);
+    void Update(float dt);
+    Pose &GetCurrentPose();
+
+private:
+    void Triangulate();
+    void Select();
+    void SelectClosestEdge();
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "BoundingVolume.h"
+
+#include <cmath>
+#include <float.h>
+
+static void Identity33(float m[3][3]) {
+    for(int i = 0; i < 3; ++i) {
+        m[i][0] = m[i][1] = m[i][2] = 0.0f;
+        m[i][i] = 1.0f;
+    }
+}
+
+static void Mul33(float out[3][3], float a[3][3], float b[3][3]) {
+    float r[3][3];
+    for(int i = 0; i < 3; ++i) {
+        for(int j = 0; j < 3; ++j) {
+            r[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j];
+        }
+    }
+    for(int i = 0; i < 3; ++i) {
+        for(int j = 0; j < 3; ++j) {
+            out[i][j] = r[i][j];
+        }
+    }
+}
+
+// 2-by-2 Symmetric Schur decomposition. Given an n-by-n symmetric matrix
+// and indices p, q such that 1 <= p < q <= n, computes a sine-cosine pair
+// (s, c) that will serve to form a Jacobi rotation matrix.
+void SymSchur2(float a[3][3], int p, int q, float &c, float &s) {
+    if(fabsf(a[p][q]) > 0.0001f) {
+        float r = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
+        float t;
+        if(r >= 0.0f) {
+            t = 1.0f / (r + sqrtf(1.0f + r * r));
+        }
+        else {
+            t = -1.0f / (-r + sqrtf(1.0f + r * r));
+        }
+        c = 1.0f / sqrtf(1.0f + t * t);
+        s = t * c;
+    }
+    else {
+        c = 1.0f;
+        s = 0.0f;
+    }
+}
+
+// Computes the eigenvectors and eigenvalues of the symmetric matrix a using
+// the classic Jacobi method of iteratively updating A as A = J^T * A * J,
+// where J = J(p, q, theta) is the Jacobi rotation matrix.
+// On exit, v will contain the eigenvectors (as columns), and the diagonal
+// elements of a are the corresponding eigenvalues.
+void Jacobi(float a[3][3], float v[3][3]) {
+    float prevoff = 0.0f;
+    float c, s;
+    float J[3][3], Jt[3][3];
+    Identity33(v);
+    const int MAX_ITERATIONS = 50;
+    for(int n = 0; n < MAX_ITERATIONS; ++n) {
+        // Find largest off-diagonal absolute element a[p][q]
+        int p = 0, q = 1;
+        for(int i = 0; i < 3; ++i) {
+            for(int j = 0; j < 3; ++j) {
+                if(i == j) continue;
+                if(fabsf(a[i][j]) > fabsf(a[p][q])) {
+                    p = i;
+                    q = j;
+                }
+            }
+        }
+        // Compute the Jacobi rotation matrix J(p, q, theta)
+        SymSchur2(a, p, q, c, s);
+        Identity33(J);
+        J[p][p] = c; J[p][q] = s;
+        J[q][p] = -s; J[q][q] = c;
+        for(int i = 0; i < 3; ++i) {
+            for(int j = 0; j < 3; ++j) {
+                Jt[i][j] = J[j][i];
+            }
+        }
+        // Cumulate rotations into what will contain the eigenvectors
+        Mul33(v, v, J);
+        // Make a more diagonal, until just eigenvalues remain on diagonal
+        Mul33(a, Jt, a);
+        Mul33(a, a, J);
+        // Compute "norm" of off-diagonal elements
+        float off = 0.0f;
+        for(int i = 0; i < 3; ++i) {
+            for(int j = 0; j < 3; ++j) {
+                if(i == j) continue;
+                off += a[i][j] * a[i][j];
+            }
+        }
+        // Stop when norm no longer decreasing
+        if(n > 2 && off >= prevoff) {
+            return;
+        }
+        prevoff = off;
+    }
+}
+
+// Points extreme along a fixed set of directions all lie on the convex hull,
+// so they are a cheap stand-in for it: the covariance of these points is not
+// biased by how densely the interior of the mesh is tessellated
+static const vec3 gExtremalDirections[] = {
+    vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, 0, 1),
+    vec3(1, 1, 1), vec3(1, 1, -1), vec3(1, -1, 1), vec3(1, -1, -1),
+    vec3(1, 1, 0), vec3(1, -1, 0), vec3(1, 0, 1),
+    vec3(1, 0, -1), vec3(0, 1, 1), vec3(0, 1, -1)
+};
+
+void ExtremalPoints(std::vector<vec3> &out, vec3 pt[], int numPts) {
+    out.clear();
+    if(numPts <= 0) {
+        return;
+    }
+    int directionCount = (int)(sizeof(gExtremalDirections) / sizeof(gExtremalDirections[0]));
+    for(int d = 0; d < directionCount; ++d) {
+        vec3 dir = gExtremalDirections[d];
+        int minIndex = 0, maxIndex = 0;
+        float minProj = dot(pt[0], dir);
+        float maxProj = minProj;
+        for(int i = 1; i < numPts; ++i) {
+            float proj = dot(pt[i], dir);
+            if(proj < minProj) { minProj = proj; minIndex = i; }
+            if(proj > maxProj) { maxProj = proj; maxIndex = i; }
+        }
+        out.push_back(pt[minIndex]);
+        out.push_back(pt[maxIndex]);
+    }
+}
+
+// Fit the extents of an OBB with the given (orthonormal) axes to the points
+void OBBFromAxes(OBB &b, vec3 axes[3], vec3 pt[], int numPts) {
+    vec3 minProj = vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+    vec3 maxProj = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for(int i = 0; i < numPts; ++i) {
+        for(int j = 0; j < 3; ++j) {
+            float proj = dot(pt[i], axes[j]);
+            if(proj < minProj.v[j]) minProj.v[j] = proj;
+            if(proj > maxProj.v[j]) maxProj.v[j] = proj;
+        }
+    }
+    b.c = vec3(0, 0, 0);
+    for(int j = 0; j < 3; ++j) {
+        b.u[j] = axes[j];
+        b.e.v[j] = (maxProj.v[j] - minProj.v[j]) * 0.5f;
+        b.c = b.c + axes[j] * ((maxProj.v[j] + minProj.v[j]) * 0.5f);
+    }
+}
+
+static float OBBVolume(const OBB &b) {
+    return b.e.x * b.e.y * b.e.z;
+}
+
+static void EigenAxes(vec3 axes[3], vec3 pt[], int numPts) {
+    float cov[3][3];
+    float v[3][3];
+    CovarianceMatrix(cov, pt, numPts);
+    Jacobi(cov, v);
+    // Eigenvectors are the columns of v
+    axes[0] = normalized(vec3(v[0][0], v[1][0], v[2][0]));
+    axes[1] = normalized(vec3(v[0][1], v[1][1], v[2][1]));
+    // Rebuild the last axis so the basis stays right handed and orthonormal
+    axes[2] = normalized(cross(axes[0], axes[1]));
+}
+
+// Covariance fitted OBB, tried both over the hull points and the full point
+// set, falling back to the AABB when the eigenvectors do worse than it
+void EigenOBB(OBB &b, vec3 pt[], int numPts) {
+    vec3 axes[3] = { vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, 0, 1) };
+    OBBFromAxes(b, axes, pt, numPts);
+    if(numPts < 3) {
+        return;
+    }
+
+    OBB candidate;
+    std::vector<vec3> hull;
+    ExtremalPoints(hull, pt, numPts);
+    EigenAxes(axes, &hull[0], (int)hull.size());
+    OBBFromAxes(candidate, axes, pt, numPts);
+    if(OBBVolume(candidate) < OBBVolume(b)) {
+        b = candidate;
+    }
+
+    EigenAxes(axes, pt, numPts);
+    OBBFromAxes(candidate, axes, pt, numPts);
+    if(OBBVolume(candidate) < OBBVolume(b)) {
+        b = candidate;
+    }
+}
+
+BoundingVolume ComputeBoundingVolume(vec3 pt[], int numPts) {
+    BoundingVolume result;
+    if(numPts <= 0) {
+        return result;
+    }
+    EigenOBB(result.mOBB, pt, numPts);
+    RitterSphere(result.mSphere, pt, numPts);
+    result.mValid = true;
+    return result;
+}
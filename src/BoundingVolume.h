@@ -0,0 +1,30 @@
+#ifndef _BOUNDINGVOLUME_H_
+#define _BOUNDINGVOLUME_H_
+
+#include <vector>
+#include "Collision.h"
+
+struct BoundingVolume {
+    OBB mOBB;
+    Sphere mSphere;
+    bool mValid;
+
+    BoundingVolume() : mValid(false) { }
+};
+
+// Bounding volumes computed once at load time
+// mMesh is in model space, mJoints[i] is in the bind space of node i
+// (only joints that are the dominant influence of some vertex are valid)
+struct MeshBounds {
+    BoundingVolume mMesh;
+    std::vector<BoundingVolume> mJoints;
+};
+
+void SymSchur2(float a[3][3], int p, int q, float &c, float &s);
+void Jacobi(float a[3][3], float v[3][3]);
+void ExtremalPoints(std::vector<vec3> &out, vec3 pt[], int numPts);
+void OBBFromAxes(OBB &b, vec3 axes[3], vec3 pt[], int numPts);
+void EigenOBB(OBB &b, vec3 pt[], int numPts);
+BoundingVolume ComputeBoundingVolume(vec3 pt[], int numPts);
+
+#endif
@@ -2,6 +2,7 @@
 #include "Shader.h"
 #include "Input.h"
 #include "Defines.h"
+#include "Raycast.h"
 #include <stdio.h>
 #include <math.h>
 
@@ -16,9 +17,13 @@ void Camera::Initialize(vec3 position, vec3 target) {
     mFirstClickY = 0;
     mPitch = 0;
     mYaw = TO_RAD(-90.0f);
+    mArmLength = mDistance;
+    mArmMinLength = 1.0f;
+    mArmRadius = 0.3f;
+    mArmReturnSpeed = 4.0f;
 }
 
-void Camera::UpdateFollowCamera(Transform *target) {
+void Camera::UpdateOrbit(Transform *target) {
     if(MouseGetButtonDown(MOUSE_BUTTON_LEFT) || MouseGetButtonDown(MOUSE_BUTTON_RIGHT)) {
         float offsetX = (float)(MouseGetCursorX() - MouseGetLastCursorX());
         float offsetY = (float)(MouseGetCursorY() - MouseGetLastCursorY());
@@ -51,6 +56,10 @@ void Camera::UpdateFollowCamera(Transform *target) {
     if(mDistance >= 20.0f) {
         mDistance = 20.0f;
     }
+}
+
+void Camera::UpdateFollowCamera(Transform *target) {
+    UpdateOrbit(target);
 
     mPosition = (target->mPosition + vec3(0, 3, 0)) - (mFront * mDistance);
 #if 1
@@ -60,6 +69,31 @@ void Camera::UpdateFollowCamera(Transform *target) {
 #endif
 }
 
+// Sphere cast from the pivot to the desired position, pull in on hit
+// and ease back out to mDistance when the way is clear again
+void Camera::UpdateSpringArmCamera(Transform *target, const Collider *colliders, int colliderCount, float dt) {
+    UpdateOrbit(target);
+
+    vec3 pivot = target->mPosition + vec3(0, 3, 0);
+    Ray arm = MakeRay(pivot, mFront * -1.0f, mDistance);
+    RayHit hit;
+    float length = mDistance;
+    if(SphereCast(arm, mArmRadius, colliders, colliderCount, hit)) {
+        length = hit.mDistance;
+    }
+    if(length < mArmLength) {
+        mArmLength = length;
+    }
+    else {
+        mArmLength += (length - mArmLength) * (1.0f - expf(-mArmReturnSpeed * dt));
+    }
+    if(mArmLength < mArmMinLength) {
+        mArmLength = mArmMinLength;
+    }
+
+    mPosition = pivot - (mFront * mArmLength);
+}
+
 void Camera::UpdateCameraInShader(Shader *shader) {
     mat4 view = lookAt(mPosition, mPosition + (mFront * mDistance), mWorldUp);
     shader->UpdateMat4("view", view);
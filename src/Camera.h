@@ -4,6 +4,7 @@
 #include "Vec3.h"
 #include "Transform.h"
 #include "Shader.h"
+#include "Collision.h"
 
 struct Camera {
     vec3 mPosition;
@@ -15,6 +16,13 @@ struct Camera {
     float mPitch;
     float mYaw; 
 
+    // Spring arm, mArmLength is the current (possibly pulled in) distance,
+    // never shorter than mArmMinLength so the camera stays off the pivot
+    float mArmLength;
+    float mArmMinLength;
+    float mArmRadius;
+    float mArmReturnSpeed;
+
     int mFirstClickX;
     int mFirstClickY;
 
@@ -22,7 +30,10 @@ struct Camera {
     void Initialize(vec3 position, vec3 target);
 
     void UpdateFollowCamera(Transform *target);
+    void UpdateSpringArmCamera(Transform *target, const Collider *colliders, int colliderCount, float dt);
     void UpdateCameraInShader(Shader *shader);
+private:
+    void UpdateOrbit(Transform *target);
 };
 
 #endif
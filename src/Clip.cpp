@@ -1,10 +1,25 @@
 #include "Clip.h"
+#include "Defines.h"
+#include "Arena.h"
+#include "AllocTracker.h"
+#include "Profiler.h"
+
+#include <cmath>
+#include <algorithm>
+
+#define ROOT_MOTION_SAMPLE_RATE 30.0f
+// Slower clips count as standing still, idle sway does not move the character
+#define ROOT_MOTION_MIN_SPEED 0.1f
+// Less net turning than this over the clip is sway and stays in the pose
+#define ROOT_MOTION_MIN_TURN TO_RAD(5.0f)
 
 Clip::Clip() {
     mName = "No Name";
     mStartTime = 0.0f;
     mEndTime = 0.0f;
     mLooping = true;
+    mAdditive = false;
+    mHasRootMotion = false;
 }
 
 unsigned int Clip::GetIdAtIndex(unsigned int index) {
@@ -31,6 +46,31 @@ float Clip::Sample(Pose& outPose, float inTime) {
     return inTime;
 }
 
+float Clip::SampleMasked(Pose& outPose, float inTime, const JointMask& mask) {
+    if(GetDuration() == 0.0f) {
+        return 0.0f;
+    }
+    inTime = AdjustTimeToFitRange(inTime);
+    if(mask.IsEmpty()) {
+        return inTime;
+    }
+
+    unsigned int first = mask.First();
+    unsigned int last = mask.Last();
+    std::vector<TransformTrack>::iterator track = std::lower_bound(mTracks.begin(), mTracks.end(), first,
+        [](const TransformTrack& t, unsigned int id) { return t.mId < id; });
+    for(; track != mTracks.end() && track->mId <= last; ++track) {
+        unsigned int joint = track->mId;
+        if(!mask.IsSet(joint)) {
+            continue;
+        }
+        Transform local = outPose.GetLocalTransform(joint);
+        Transform animated = track->Sample(local, inTime, mLooping);
+        outPose.SetLocalTransform(joint, animated);
+    }
+    return inTime;
+}
+
 TransformTrack& Clip::operator[](unsigned int joint) {
     unsigned int size = (unsigned int)mTracks.size();
     for(unsigned int i = 0; i < size; ++i) {
@@ -69,6 +109,255 @@ float Clip::GetDuration() {
     return mEndTime - mStartTime;
 }
 
+void Clip::MakeAdditive(Pose& restPose, bool fromFirstFrame) {
+    if(mAdditive) {
+        return;
+    }
+    Pose reference = restPose;
+    if(fromFirstFrame) {
+        Sample(reference, mStartTime);
+    }
+    unsigned int trackSize = (unsigned int)mTracks.size();
+    for(unsigned int i = 0; i < trackSize; ++i) {
+        TransformTrack& track = mTracks[i];
+        Transform base = reference.GetLocalTransform(track.mId);
+        quat invRotation = inverse(base.mRotation);
+        vec3 invScale = vec3(base.mScale.x != 0.0f ? 1.0f / base.mScale.x : 0.0f,
+                             base.mScale.y != 0.0f ? 1.0f / base.mScale.y : 0.0f,
+                             base.mScale.z != 0.0f ? 1.0f / base.mScale.z : 0.0f);
+        // The reference is constant so the cubic tangents only need the
+        // linear part of each conversion
+        for(unsigned int j = 0; j < (unsigned int)track.mPosition.mFrames.size(); ++j) {
+            FrameVec3& frame = track.mPosition.mFrames[j];
+            frame.mValue = frame.mValue - base.mPosition;
+        }
+        for(unsigned int j = 0; j < (unsigned int)track.mRotation.mFrames.size(); ++j) {
+            FrameQuat& frame = track.mRotation.mFrames[j];
+            frame.mValue = invRotation * frame.mValue;
+            frame.mIn = invRotation * frame.mIn;
+            frame.mOut = invRotation * frame.mOut;
+        }
+        for(unsigned int j = 0; j < (unsigned int)track.mScale.mFrames.size(); ++j) {
+            FrameVec3& frame = track.mScale.mFrames[j];
+            frame.mValue = frame.mValue * invScale;
+            frame.mIn = frame.mIn * invScale;
+            frame.mOut = frame.mOut * invScale;
+        }
+    }
+    mAdditive = true;
+}
+
+float Clip::SampleAdditive(Pose& outPose, float inTime, float weight) {
+    if(GetDuration() == 0.0f) {
+        return 0.0f;
+    }
+    inTime = AdjustTimeToFitRange(inTime);
+
+    // Missing channels sample as the identity, which adds nothing
+    Transform identity;
+    unsigned int trackSize = (unsigned int)mTracks.size();
+    for(unsigned int i = 0; i < trackSize; ++i) {
+        unsigned int joint = mTracks[i].mId;
+        Transform delta = mTracks[i].Sample(identity, inTime, mLooping);
+        if(delta.mRotation.w < 0.0f) {
+            delta.mRotation = -delta.mRotation;
+        }
+        Transform local = outPose.GetLocalTransform(joint);
+        local.mPosition = local.mPosition + delta.mPosition * weight;
+        local.mRotation = normalized(local.mRotation * nlerp(identity.mRotation, delta.mRotation, weight));
+        local.mScale = local.mScale * lerp(identity.mScale, delta.mScale, weight);
+        outPose.SetLocalTransform(joint, local);
+    }
+    return inTime;
+}
+
+static float GetYaw(const quat& rotation) {
+    vec3 forward = rotation * vec3(0, 0, 1);
+    return atan2f(forward.x, forward.z);
+}
+
+// Tangents of cubic keys whose values were rewritten, the slope between the
+// neighbouring keys in units per second like the ones read from glTF
+static void RecomputeTangents(TrackVec3& track) {
+    unsigned int count = (unsigned int)track.mFrames.size();
+    if(track.mInterpolation != INTERPOLATION_CUBIC || count < 2) {
+        return;
+    }
+    for(unsigned int i = 0; i < count; ++i) {
+        FrameVec3& prev = track.mFrames[i > 0 ? i - 1 : i];
+        FrameVec3& next = track.mFrames[i < count - 1 ? i + 1 : i];
+        float delta = next.mTime - prev.mTime;
+        vec3 slope = delta > 0.0f ? (next.mValue - prev.mValue) * (1.0f / delta) : vec3(0, 0, 0);
+        track.mFrames[i].mIn = slope;
+        track.mFrames[i].mOut = slope;
+    }
+}
+
+static void RecomputeTangents(TrackQuat& track) {
+    unsigned int count = (unsigned int)track.mFrames.size();
+    if(track.mInterpolation != INTERPOLATION_CUBIC || count < 2) {
+        return;
+    }
+    // Keys in one hemisphere, the sampler only flips the end of a segment
+    // and its tangent would point the wrong way
+    for(unsigned int i = 1; i < count; ++i) {
+        if(dot(track.mFrames[i - 1].mValue, track.mFrames[i].mValue) < 0.0f) {
+            track.mFrames[i].mValue = -track.mFrames[i].mValue;
+        }
+    }
+    for(unsigned int i = 0; i < count; ++i) {
+        FrameQuat& prev = track.mFrames[i > 0 ? i - 1 : i];
+        FrameQuat& next = track.mFrames[i < count - 1 ? i + 1 : i];
+        float delta = next.mTime - prev.mTime;
+        quat slope = delta > 0.0f ? (next.mValue - prev.mValue) * (1.0f / delta) : quat(0, 0, 0, 0);
+        track.mFrames[i].mIn = slope;
+        track.mFrames[i].mOut = slope;
+    }
+}
+
+void Clip::ExtractRootMotion(Pose& restPose, unsigned int root, unsigned int leftFoot, unsigned int rightFoot) {
+    AllocTagScope tag(ALLOC_TAG_ANIMATION);
+    ScratchScope scratch;
+    float duration = GetDuration();
+    mHasRootMotion = false;
+    if(duration <= 0.0f) {
+        return;
+    }
+    // Sampled without looping so the last sample is the end of the clip and not its start
+    bool looping = mLooping;
+    mLooping = false;
+    unsigned int count = (unsigned int)ceilf(duration * ROOT_MOTION_SAMPLE_RATE) + 1;
+    float *times = scratch.mArena->PushArray<float>(count);
+    vec3 *roots = scratch.mArena->PushArray<vec3>(count);
+    vec3 *lefts = scratch.mArena->PushArray<vec3>(count);
+    vec3 *rights = scratch.mArena->PushArray<vec3>(count);
+    float *yaws = scratch.mArena->PushArray<float>(count);
+    Pose pose = restPose;
+    for(unsigned int i = 0; i < count; ++i) {
+        times[i] = mStartTime + fminf((float)i / ROOT_MOTION_SAMPLE_RATE, duration);
+        pose = restPose;
+        Sample(pose, times[i]);
+        Transform rootTransform = pose.GetGlobalTransform(root);
+        roots[i] = rootTransform.mPosition;
+        lefts[i] = pose.GetGlobalTransform(leftFoot).mPosition;
+        rights[i] = pose.GetGlobalTransform(rightFoot).mPosition;
+        yaws[i] = GetYaw(rootTransform.mRotation);
+        if(i > 0) {
+            // Unwrapped so a turn past 180 degrees keeps going
+            while(yaws[i] - yaws[i - 1] > TO_RAD(180.0f)) yaws[i] -= TO_RAD(360.0f);
+            while(yaws[i] - yaws[i - 1] < -TO_RAD(180.0f)) yaws[i] += TO_RAD(360.0f);
+        }
+    }
+
+    vec3 *travel = scratch.mArena->PushArray<vec3>(count);
+    vec3 rootTravel = roots[count - 1] - roots[0];
+    bool fromRoot = sqrtf(rootTravel.x * rootTravel.x + rootTravel.z * rootTravel.z) / duration >= ROOT_MOTION_MIN_SPEED;
+    travel[0] = vec3(0, 0, 0);
+    for(unsigned int i = 1; i < count; ++i) {
+        vec3 step;
+        if(fromRoot) {
+            step = roots[i] - roots[i - 1];
+        }
+        else {
+            // The lower foot is the one on the ground, the body moves opposite to it
+            const vec3 *planted = lefts[i - 1].y < rights[i - 1].y ? lefts : rights;
+            step = planted[i - 1] - planted[i];
+        }
+        travel[i] = travel[i - 1] + vec3(step.x, 0.0f, step.z);
+    }
+    float netTurn = yaws[count - 1] - yaws[0];
+    bool hasYaw = fabsf(netTurn) >= ROOT_MOTION_MIN_TURN;
+    if(len(travel[count - 1]) / duration < ROOT_MOTION_MIN_SPEED && !hasYaw) {
+        mLooping = looping;
+        return;
+    }
+
+    mRootTranslation.mInterpolation = INTERPOLATION_LINEAR;
+    mRootTranslation.mFrames.resize(count);
+    mRootYaw.mInterpolation = INTERPOLATION_LINEAR;
+    mRootYaw.mFrames.resize(hasYaw ? count : 0);
+    for(unsigned int i = 0; i < count; ++i) {
+        FrameVec3& frame = mRootTranslation.mFrames[i];
+        frame.mTime = times[i];
+        frame.mValue = travel[i];
+        frame.mIn = vec3(0, 0, 0);
+        frame.mOut = vec3(0, 0, 0);
+        if(hasYaw) {
+            FrameScalar& yaw = mRootYaw.mFrames[i];
+            yaw.mTime = times[i];
+            yaw.mValue = yaws[i] - yaws[0];
+            yaw.mIn = 0.0f;
+            yaw.mOut = 0.0f;
+        }
+    }
+    mHasRootMotion = true;
+
+    // Take what was extracted out of the root keys, the ground position
+    // under the root no longer moves. The parent of the root is not
+    // animated. Cubic keys get new tangents, the old ones still carry the
+    // motion taken out
+    TransformTrack *track = 0;
+    for(unsigned int i = 0; i < (unsigned int)mTracks.size(); ++i) {
+        if(mTracks[i].mId == root) {
+            track = &mTracks[i];
+        }
+    }
+    if(!track || (!fromRoot && !hasYaw)) {
+        mLooping = looping;
+        return;
+    }
+    int parent = restPose.GetParent(root);
+    Transform parentTransform = parent >= 0 ? restPose.GetGlobalTransform(parent) : Transform();
+    Transform invParent = inverse(parentTransform);
+    if(fromRoot) {
+        for(unsigned int i = 0; i < (unsigned int)track->mPosition.mFrames.size(); ++i) {
+            FrameVec3& frame = track->mPosition.mFrames[i];
+            vec3 offset = mRootTranslation.Sample(frame.mTime, false);
+            vec3 position = transformPoint(parentTransform, frame.mValue) - offset;
+            frame.mValue = transformPoint(invParent, position);
+        }
+        RecomputeTangents(track->mPosition);
+    }
+    if(hasYaw) {
+        for(unsigned int i = 0; i < (unsigned int)track->mRotation.mFrames.size(); ++i) {
+            FrameQuat& frame = track->mRotation.mFrames[i];
+            Transform local;
+            local.mRotation = frame.mValue;
+            Transform model = combine(parentTransform, local);
+            Transform unturn;
+            unturn.mRotation = angleAxis(-mRootYaw.Sample(frame.mTime, false), vec3(0, 1, 0));
+            model = combine(unturn, model);
+            frame.mValue = combine(invParent, model).mRotation;
+        }
+        RecomputeTangents(track->mRotation);
+    }
+    mLooping = looping;
+}
+
+void Clip::SampleRootMotion(float fromTime, float toTime, vec3& outTranslation, float& outYaw) {
+    outTranslation = vec3(0, 0, 0);
+    outYaw = 0.0f;
+    if(!mHasRootMotion) {
+        return;
+    }
+    bool hasYaw = mRootYaw.mFrames.size() > 1;
+    vec3 from = mRootTranslation.Sample(fromTime, false);
+    vec3 to = mRootTranslation.Sample(toTime, false);
+    float fromYaw = hasYaw ? mRootYaw.Sample(fromTime, false) : 0.0f;
+    float toYaw = hasYaw ? mRootYaw.Sample(toTime, false) : 0.0f;
+    if(mLooping && toTime < fromTime) {
+        // The rest of this loop plus the start of the next, the curves are
+        // zero at mStartTime. The next loop starts turned by this loop's yaw
+        float endYaw = hasYaw ? mRootYaw.Sample(mEndTime, false) : 0.0f;
+        to = mRootTranslation.Sample(mEndTime, false) + angleAxis(endYaw, vec3(0, 1, 0)) * to;
+        toYaw += endYaw;
+    }
+    // The curves are in the space of the clip, the caller's frame is the one
+    // with the yaw up to fromTime already taken out
+    outTranslation = angleAxis(-fromYaw, vec3(0, 1, 0)) * (to - from);
+    outYaw = toYaw - fromYaw;
+}
+
 float Clip::AdjustTimeToFitRange(float inTime) {
     if(mLooping) {
         float duration = mEndTime - mStartTime;
@@ -92,11 +381,13 @@ float Clip::AdjustTimeToFitRange(float inTime) {
     return inTime;
 }
 
-static void GetScalarValues(std::vector<float>& out, unsigned int compCount, const cgltf_accessor& inAccessor) {
-    out.resize(inAccessor.count * compCount);
+// The values live in the scratch arena, callers free them with a ScratchScope
+static float *GetScalarValues(unsigned int compCount, const cgltf_accessor& inAccessor) {
+    float *out = GetScratchArena()->PushArray<float>(inAccessor.count * compCount);
     for(cgltf_size i = 0; i < inAccessor.count; ++i) {
         cgltf_accessor_read_float(&inAccessor, i, &out[i * compCount], compCount);
     }
+    return out;
 }
 
 static int GetNodeIndex(cgltf_node *target, cgltf_node *nodes, unsigned int nodeCount) {
@@ -124,13 +415,12 @@ static void TrackScalarFromChannel(TrackScalar& inOutTrack, cgltf_animation_chan
     bool isSamplerCubic = interpolation == INTERPOLATION_CUBIC;
     inOutTrack.mInterpolation = interpolation;
 
-    std::vector<float> timelineFloats;
-    GetScalarValues(timelineFloats, 1, *sampler->input);
-    std::vector<float> valueFloats;
-    GetScalarValues(valueFloats, 1, *sampler->output);
+    ScratchScope scratch;
+    float *timelineFloats = GetScalarValues(1, *sampler->input);
+    float *valueFloats = GetScalarValues(1, *sampler->output);
 
     unsigned int numFrames = (unsigned int)sampler->input->count;
-    unsigned int numberOfValuesPerFrame = (unsigned int)(valueFloats.size() / timelineFloats.size());
+    unsigned int numberOfValuesPerFrame = (unsigned int)((sampler->output->count * 1) / sampler->input->count);
     inOutTrack.mFrames.resize(numFrames);
     for(unsigned int i = 0; i < numFrames; ++i) {
         int baseIndex = i * numberOfValuesPerFrame;
@@ -157,13 +447,12 @@ static void TrackVec3FromChannel(TrackVec3& inOutTrack, cgltf_animation_channel
     bool isSamplerCubic = interpolation == INTERPOLATION_CUBIC;
     inOutTrack.mInterpolation = interpolation;
 
-    std::vector<float> timelineFloats;
-    GetScalarValues(timelineFloats, 1, *sampler->input);
-    std::vector<float> valueFloats;
-    GetScalarValues(valueFloats, 3, *sampler->output);
+    ScratchScope scratch;
+    float *timelineFloats = GetScalarValues(1, *sampler->input);
+    float *valueFloats = GetScalarValues(3, *sampler->output);
 
     unsigned int numFrames = (unsigned int)sampler->input->count;
-    unsigned int numberOfValuesPerFrame = (unsigned int)(valueFloats.size() / timelineFloats.size());
+    unsigned int numberOfValuesPerFrame = (unsigned int)((sampler->output->count * 3) / sampler->input->count);
     inOutTrack.mFrames.resize(numFrames);
     for(unsigned int i = 0; i < numFrames; ++i) {
         int baseIndex = i * numberOfValuesPerFrame;
@@ -195,13 +484,12 @@ static void TrackQuatFromChannel(TrackQuat& inOutTrack, cgltf_animation_channel
     bool isSamplerCubic = interpolation == INTERPOLATION_CUBIC;
     inOutTrack.mInterpolation = interpolation;
 
-    std::vector<float> timelineFloats;
-    GetScalarValues(timelineFloats, 1, *sampler->input);
-    std::vector<float> valueFloats;
-    GetScalarValues(valueFloats, 4, *sampler->output);
+    ScratchScope scratch;
+    float *timelineFloats = GetScalarValues(1, *sampler->input);
+    float *valueFloats = GetScalarValues(4, *sampler->output);
 
     unsigned int numFrames = (unsigned int)sampler->input->count;
-    unsigned int numberOfValuesPerFrame = (unsigned int)(valueFloats.size() / timelineFloats.size());
+    unsigned int numberOfValuesPerFrame = (unsigned int)((sampler->output->count * 4) / sampler->input->count);
     inOutTrack.mFrames.resize(numFrames);
     for(unsigned int i = 0; i < numFrames; ++i) {
         int baseIndex = i * numberOfValuesPerFrame;
@@ -223,6 +511,8 @@ static void TrackQuatFromChannel(TrackQuat& inOutTrack, cgltf_animation_channel
 
 
 std::vector<Clip> LoadClips(cgltf_data *data) {
+    PROFILE_FUNCTION();
+    AllocTagScope tag(ALLOC_TAG_ANIMATION);
     unsigned int numClips = (unsigned int)data->animations_count;
     unsigned int numNodes = (unsigned int)data->nodes_count;
 
@@ -250,6 +540,8 @@ std::vector<Clip> LoadClips(cgltf_data *data) {
 			}
         }
         result[i].RecalculateDuration();
+        std::sort(result[i].mTracks.begin(), result[i].mTracks.end(),
+            [](const TransformTrack& a, const TransformTrack& b) { return a.mId < b.mId; });
     }
     return result;
 }
@@ -9,22 +9,47 @@
 #include "Pose.h"
 
 struct Clip {
+    // Sorted by joint id once loaded, so a mask over neighbouring joints
+    // walks a contiguous run of tracks
     std::vector<TransformTrack> mTracks;
     std::string mName;
     float mStartTime;
     float mEndTime;
     bool mLooping;
+    // The tracks hold differences from a reference pose, see MakeAdditive
+    bool mAdditive;
+    // Horizontal travel and yaw of the root in model space, zero at
+    // mStartTime, see ExtractRootMotion
+    TrackVec3 mRootTranslation;
+    TrackScalar mRootYaw;
+    bool mHasRootMotion;
 
 	Clip();
 	unsigned int GetIdAtIndex(unsigned int index);
 	void SetIdAtIndex(unsigned int index, unsigned int id);
 	float Sample(Pose& outPose, float inTime);
+	// Like Sample but only for the tracks of joints in mask
+	float SampleMasked(Pose& outPose, float inTime, const JointMask& mask);
 	TransformTrack& operator[](unsigned int joint);
 	void RecalculateDuration();
 	float GetDuration();
-private:
+	// Turns every frame into its difference from the rest pose, or from the
+	// clip's own first frame, once at load. Positions are stored as offsets,
+	// rotations as inverse(reference) * rotation and scales as ratios. The
+	// demo has no overlay clips, nothing calls it or SampleAdditive yet
+	void MakeAdditive(Pose& restPose, bool fromFirstFrame);
+	// Adds the deltas at inTime on top of outPose scaled by weight, joints
+	// without a track are left alone. Only valid on additive clips
+	float SampleAdditive(Pose& outPose, float inTime, float weight);
+	// Moves the horizontal travel and the net turning of the root joint out
+	// of its tracks into mRootTranslation and mRootYaw, once at load. Clips
+	// animated in place get their travel from the planted foot instead
+	void ExtractRootMotion(Pose& restPose, unsigned int root, unsigned int leftFoot, unsigned int rightFoot);
+	// Root travel and yaw between two playback times, across the loop if toTime
+	// wrapped. The travel is turned into the frame of the yaw at fromTime
+	void SampleRootMotion(float fromTime, float toTime, vec3& outTranslation, float& outYaw);
+	// Wraps the time of a looping clip into its range, clamps the others
     float AdjustTimeToFitRange(float inTime);
-
 };
 
 std::vector<Clip> LoadClips(cgltf_data *data);
@@ -0,0 +1,345 @@
+#include "Collision.h"
+
+#include <cmath>
+
+// TODO: Collision Detection System...
+// -If it looks right it is right
+// -Nothing is faster than not having to perform a task
+
+// Barycentric Coords
+void SolveBarycentric(vec3 a, vec3 b, vec3 c, vec3 p, float &u, float &v, float &w) {
+    vec3 v0 = b - a;
+    vec3 v1 = c - a;
+    vec3 v2 = p - a;
+    float d00 = dot(v0, v0);
+    float d10 = dot(v1, v0);
+    float d11 = dot(v1, v1);
+    float d20 = dot(v2, v0);
+    float d21 = dot(v2, v1);
+    float denom = d00*d11 - d10*d10;
+    v = (d20*d11 - d10*d21) / denom;
+    w = (d00*d21 - d20*d10) / denom;
+    u = 1.0f - v - w;
+}
+
+// Polygones
+// Convex Check
+int IsConvexQuad(vec3 a, vec3 b, vec3 c, vec3 d) {
+    // Quad is nonconvex if Dot(Cross(bd, ba), Cross(bd, bc)) >= 0
+    vec3 bda = cross(d - b, a - b);
+    vec3 bdc = cross(d - b, c - b);
+    if(dot(bda, bdc) >= 0.0f) return 0;
+    // Quad is now convex if Dot(Cross(ac, ad), Cross(ac, ab)) < 0
+    vec3 acd = cross(c - a, d - a);
+    vec3 acb = cross(c - a, b - a);
+    return dot(acd, acb) < 0.0f;
+}
+
+///the function can be effectively implemented by simply stripping
+///the sign bit of the binary representation 
+
+// Computing an encompassing bounding box for a rotated AABB using min-max representation
+// Transform AABB a by the matrix m and translation t,
+// find the maximun extents, and store result into AABB b
+void UpdateAABB(AABB_min_max a, float m[3][3], float t[3], AABB_min_max &b) {
+    // For all three axes
+    for(int i = 0; i < 3; ++i) {
+        // start by adding in the translation
+        b.min.v[i] = b.max.v[i] = t[i];
+        // Form extent by summing smaller and larger terms respectively
+        for(int j = 0; j < 3; ++j) {
+            float e = m[i][j] * a.min.v[j];
+            float f = m[i][j] * a.max.v[j];
+            if(e < f) {
+                b.min.v[i] += e;
+                b.max.v[i] += f;
+            } else {
+                b.min.v[i] += f;
+                b.max.v[i] += e;
+            }
+        }
+    }
+}
+
+// the code for the center-radius AABB representation becomes
+// Transform AABB a by the matrix m and translation t,
+// find the maximun extents, and store result into AABB b
+void UpdateAABB(AABB_center_radius a, float m[3][3], float t[3], AABB_center_radius &b) {
+    for(int i = 0; i < 3; ++i) {
+        b.center.v[i] = t[i];
+        b.r[i] = 0.0f;
+        for(int j = 0; j < 3; ++j) {
+            b.center.v[i] += m[i][j] * a.center.v[j];
+            b.r[i] += fabsf(m[i][j]) * a.r[j];
+        }
+    }
+}
+
+int TestSphereSphere(Sphere a, Sphere b) {
+    // Calculate the squared distance between centers
+    vec3 d = a.c - b.c;
+    float dist2 = dot(d, d);
+    float radSum = a.r + b.r;
+    return dist2 <= radSum * radSum;
+}
+
+// Computing the bounding Sphere
+// Compute indices to the two most separeted points of the (up to) six points
+// defining tha AAABB encompassing the point set. Return these as min and max
+void MostSeparatedPointsOnAABB(int &min, int &max, vec3 pt[], int numPts) {
+    int minx = 0, maxx = 0, miny = 0, maxy = 0, minz = 0, maxz = 0;
+    for(int i = 1; i < numPts; ++i) {
+        if(pt[i].x < pt[minx].x) minx = i;
+        if(pt[i].x > pt[maxx].x) maxx = i;
+        if(pt[i].y < pt[miny].y) miny = i;
+        if(pt[i].y > pt[maxy].y) maxy = i;
+        if(pt[i].z < pt[minz].z) minz = i;
+        if(pt[i].z > pt[maxz].z) maxz = i;
+    }
+    // Compute the squared distances for the three pairs of points
+    float dist2x = dot(pt[maxx] - pt[minx], pt[maxx] - pt[minx]);
+    float dist2y = dot(pt[maxy] - pt[miny], pt[maxy] - pt[miny]);
+    float dist2z = dot(pt[maxz] - pt[minz], pt[maxz] - pt[minz]);
+    min = minx;
+    max = maxx;
+    if(dist2y > dist2x && dist2y > dist2z) {
+        min = miny;
+        max = maxy;
+    }
+    if(dist2z > dist2x && dist2z > dist2y) {
+        min = minz;
+        max = maxz;
+    }
+}
+
+void SphereFromDistantPoints(Sphere &s, vec3 pt[], int numPts) {
+    // Find the most separated pair defining the encompassing AABB
+    int min, max;
+    MostSeparatedPointsOnAABB(min, max, pt, numPts);
+    // Set up the sphere to just encompase these two points
+    s.c = (pt[min] + pt[max]) * 0.5f;
+    s.r = dot(pt[max] - s.c, pt[max] - s.c);
+    s.r = sqrtf(s.r);
+}
+
+void SphereOfSphereAndPt(Sphere &s, vec3 &p) {
+    // Compute squared distance between point and sphere center
+    vec3 d = p - s.c;
+    float dist2 = dot(d, d);
+    // Only update s if point p is outside it
+    if(dist2 > s.r * s.r) {
+        float dist = sqrtf(dist2);
+        float newRadius = (s.r + dist) * 0.5f;
+        float k = (newRadius - s.r) / dist;
+        s.r = newRadius;
+        s.c = s.c + (d * k);
+    }
+}
+
+// The full Code for computing the approximate bounding sphere becomes
+void RitterSphere(Sphere &s, vec3 pt[], int numPts) {
+    // Get sphere encompassing two approximately most distant points
+    SphereFromDistantPoints(s, pt, numPts);
+    
+    // Grow sphere to include all points
+    for(int i = 0; i < numPts; ++i) {
+        SphereOfSphereAndPt(s, pt[i]);
+    }
+}
+
+// Compute variance of a set of 1D values
+float Variance(float x[], int n) {
+    float u = 0.0f;
+    for(int i = 0; i < n; ++i) {
+        u += x[i];
+    }
+    u /= n;
+    float s2 = 0.0f;
+    for(int i = 0; i < n; ++i) {
+        s2 += (x[i] - u) * (x[i] - u);
+    }
+    return s2 / n;
+}
+
+/*
+| 00 01 02 | 
+| 10 11 12 | 
+| 20 21 22 | 
+*/
+
+void CovarianceMatrix(float cov[3][3], vec3 pt[], int numPts) {
+    float oon = 1.0f / (float)numPts;
+    vec3 c = vec3(0, 0, 0);
+    float e00, e11, e22, e01, e02, e12;
+    // Compute the center of mass (centroid) of the points 
+    for(int i = 0; i < numPts; ++i) {
+        c = c + pt[i];
+    }
+    c = c * oon;
+    // Compute covariance elements;
+    e00 = e11 = e22 = e01 = e02 = e12 = 0.0f;
+    for(int i = 0; i < numPts; ++i) {
+        // translate points so center of mass is at origin
+        vec3 p = pt[i] - c;
+        // Compute covariance of traslated points
+        e00 += p.x * p.x;
+        e01 += p.x * p.y;
+        e02 += p.x * p.z;
+        e11 += p.y * p.y;
+        e12 += p.y * p.z;
+        e22 += p.z * p.z;
+    }
+    // Fill the covariance matrix elements
+    cov[0][0] = e00 * oon;
+    cov[1][1] = e11 * oon;
+    cov[2][2] = e22 * oon;
+    cov[0][1] = cov[1][0] = e01 * oon;
+    cov[0][2] = cov[2][0] = e02 * oon;
+    cov[1][2] = cov[2][1] = e12 * oon;
+}
+
+// Given point p, return the point q on or in AABB b that is closest to p
+void ClosestPtPointAABB(vec3 p, AABB_min_max b, vec3 &q) {
+    // For each coordinate axis, if the point coordinate value is
+    // outside box, clamp it to the box, else keep it as is
+    for(int i = 0; i < 3; ++i) {
+        float v = p.v[i];
+        if(v < b.min.v[i]) v = b.min.v[i];
+        if(v > b.max.v[i]) v = b.max.v[i];
+        q.v[i] = v;
+    }
+}
+
+// Computes the square distance between a point p and an AADD b
+float SqDistPointAABB(vec3 p, AABB_min_max b) {
+    float sqDist = 0.0f;
+    for(int i = 0; i < 3; ++i) {
+        float v = p.v[i];
+        if(v < b.min.v[i]) sqDist += (b.min.v[i] - v) * (b.min.v[i] - v);
+        if(v > b.max.v[i]) sqDist += (v - b.max.v[i]) * (v - b.max.v[i]);
+    }
+    return sqDist;
+}
+
+vec3 GetAABBNormalFromPoint(vec3 p, AABB_min_max b, float playerY) {
+    if(p.x == b.max.x && playerY != b.max.y) {
+        return vec3(1, 0, 0);
+    }
+    else if(p.x == b.min.x && playerY != b.max.y) {
+        return vec3(-1, 0, 0);
+    }
+    if(p.z == b.max.z && playerY != b.max.y) {
+        return vec3(0, 0, 1);
+    }
+    else if(p.z == b.min.z && playerY != b.max.y) {
+        return vec3(0, 0, -1);
+    }
+    if(p.y == b.max.y) {
+        return vec3(0, 1, 0);
+    }
+    else if(p.y == b.min.y) {
+        return vec3(0, -1, 0);
+    }
+    return vec3();
+}
+
+vec3 ClosestPtPointPlane(vec3 q, Plane plane)
+{
+    vec3 n = plane.n;
+    vec3 p = plane.p;
+    float t = dot(n, q - p) / dot(n , n);
+    vec3 r = q - (n * t);
+    return r;
+}
+
+float SqDistPointOBB(vec3 p, OBB b) {
+    vec3 v = p - b.c;
+    float sqDist = 0.0f;
+    for(int i = 0; i < 3; ++i) {
+        // Project vector from box center to p on each axis, getting the distance
+        // of p along that axis, and count any excess distance outside box extends
+        float d = dot(v, b.u[i]), excess = 0.0f;
+        if(d < -b.e.v[i]) {
+            excess = d + b.e.v[i];
+        }
+        else if (d > b.e.v[i]) {
+            excess = d - b.e.v[i];
+        }
+        sqDist += excess * excess;
+    }
+    return sqDist;
+}
+
+void ClosestPtPointOBB(vec3 p, OBB b, vec3 &q) {
+    vec3 d = p - b.c;
+    // start result at center of the box; make steps from there
+    q = b.c;
+    // For each OBB axis...
+    for(int i = 0; i < 3; ++i) {
+        // project d onto that axis to get the distance
+        // along the axis of d from the box center
+        float dist = dot(d, b.u[i]);
+        if(dist > b.e.v[i]) dist = b.e.v[i];
+        if(dist < -b.e.v[i]) dist = -b.e.v[i];
+        // Step that distance along the axis to get world coordinate
+        q = q + b.u[i] * dist;
+    }
+}
+
+vec3 GetOBBNormalFromPoint(vec3 p, OBB b, float playerY) {
+
+    vec3 pRel = p - b.c;
+    float xDot = round(dot(pRel, b.u[0]));
+    if(xDot == b.e.x && playerY != b.c.y + b.e.y) {
+        return b.u[0];
+    }
+    else if(xDot == -b.e.x && playerY != b.c.y + b.e.y) {
+        return b.u[0] * -1.0f;
+    }
+
+    float zDot = round(dot(pRel, b.u[2]));
+    if(zDot == b.e.z && playerY != b.c.y + b.e.y) {
+        return b.u[2];
+    }
+    else if(zDot == -b.e.z && playerY != b.c.y + b.e.y) {
+        return b.u[2] * -1.0f;
+    }
+
+    float yDot = round(dot(pRel, b.u[1]));
+    if(yDot == b.e.y) {
+        return b.u[1];
+    }
+    else if(yDot == -b.e.y) {
+        return b.u[1] * -1.0f;
+    }
+    return vec3();
+}
+
+Collider MakeAABBCollider(vec3 min, vec3 max) {
+    Collider result;
+    result.mType = COLLIDER_AABB;
+    result.mAABB.min = min;
+    result.mAABB.max = max;
+    result.mOBB.c = (min + max) * 0.5f;
+    result.mOBB.u[0] = vec3(1, 0, 0);
+    result.mOBB.u[1] = vec3(0, 1, 0);
+    result.mOBB.u[2] = vec3(0, 0, 1);
+    result.mOBB.e = (max - min) * 0.5f;
+    return result;
+}
+
+Collider MakeOBBCollider(OBB obb) {
+    Collider result;
+    result.mType = COLLIDER_OBB;
+    result.mOBB = obb;
+    // Enclosing AABB of the OBB, same idea as UpdateAABB for center-radius
+    for(int i = 0; i < 3; ++i) {
+        float r = 0.0f;
+        for(int j = 0; j < 3; ++j) {
+            r += fabsf(obb.u[j].v[i]) * obb.e.v[j];
+        }
+        result.mAABB.min.v[i] = obb.c.v[i] - r;
+        result.mAABB.max.v[i] = obb.c.v[i] + r;
+    }
+    return result;
+}
@@ -0,0 +1,80 @@
+#ifndef _COLLISION_H_
+#define _COLLISION_H_
+
+#include "Vec3.h"
+
+// Plane
+struct Plane {
+    vec3 n;  
+    vec3 p;
+};
+
+//Axis Allined Bounding Boxes
+struct AABB_min_max {
+    vec3 min;
+    vec3 max;
+};
+
+struct AABB_min_widths {
+    vec3 min;
+    float d[3];
+};
+
+struct AABB_center_radius {
+    vec3 center;
+    float r[3];
+};
+
+// Spheres
+struct Sphere {
+    vec3 c; // sphere center
+    float r; // sphere radius
+};
+
+struct OBB {
+    vec3 c;      // OBB center point
+    vec3 u[3];  // Local x-, y- and z-axes ( have to be normalized )
+    vec3 e;      // Positive halfwidth extents of OBB along each axis
+};
+
+// Scene colliders, mAABB always holds the world space bounds
+// so queries can reject a collider before running the exact test
+enum ColliderType {
+    COLLIDER_AABB,
+    COLLIDER_OBB
+};
+
+struct Collider {
+    ColliderType mType;
+    AABB_min_max mAABB;
+    OBB mOBB;
+};
+
+Collider MakeAABBCollider(vec3 min, vec3 max);
+Collider MakeOBBCollider(OBB obb);
+
+void SolveBarycentric(vec3 a, vec3 b, vec3 c, vec3 p, float &u, float &v, float &w);
+int IsConvexQuad(vec3 a, vec3 b, vec3 c, vec3 d);
+
+void UpdateAABB(AABB_min_max a, float m[3][3], float t[3], AABB_min_max &b);
+void UpdateAABB(AABB_center_radius a, float m[3][3], float t[3], AABB_center_radius &b);
+
+int TestSphereSphere(Sphere a, Sphere b);
+void MostSeparatedPointsOnAABB(int &min, int &max, vec3 pt[], int numPts);
+void SphereFromDistantPoints(Sphere &s, vec3 pt[], int numPts);
+void SphereOfSphereAndPt(Sphere &s, vec3 &p);
+void RitterSphere(Sphere &s, vec3 pt[], int numPts);
+
+float Variance(float x[], int n);
+void CovarianceMatrix(float cov[3][3], vec3 pt[], int numPts);
+
+void ClosestPtPointAABB(vec3 p, AABB_min_max b, vec3 &q);
+float SqDistPointAABB(vec3 p, AABB_min_max b);
+vec3 GetAABBNormalFromPoint(vec3 p, AABB_min_max b, float playerY);
+vec3 ClosestPtPointPlane(vec3 q, Plane plane);
+
+float SqDistPointOBB(vec3 p, OBB b);
+void ClosestPtPointOBB(vec3 p, OBB b, vec3 &q);
+vec3 GetOBBNormalFromPoint(vec3 p, OBB b, float playerY);
+
+#endif
@@ -0,0 +1,250 @@
+#include "CrossFadeController.h"
+#include "Profiler.h"
+
+#include <utility>
+#include <cmath>
+
+#define INERTIAL_EPSILON 0.00001f
+
+void InertialChannel::Initialize(vec3 axis, float x0, float v0, float duration) {
+    mAxis = axis;
+    mX0 = x0;
+    if(x0 < INERTIAL_EPSILON || duration <= 0.0f) {
+        mX0 = 0.0f;
+        mDuration = 0.0f;
+        return;
+    }
+    // Moving away from the target would overshoot, and a fast approach
+    // shortens the blend so the curve does not cross zero
+    if(v0 > 0.0f) {
+        v0 = 0.0f;
+    }
+    else if(v0 < 0.0f) {
+        float limit = -5.0f * x0 / v0;
+        if(limit < duration) duration = limit;
+    }
+    float t1 = duration;
+    float t2 = t1 * t1;
+    float a0 = (-8.0f * v0 * t1 - 20.0f * x0) / t2;
+    mV0 = v0;
+    mA0 = a0;
+    mA = -(a0 * t2 + 6.0f * v0 * t1 + 12.0f * x0) / (2.0f * t2 * t2 * t1);
+    mB = (3.0f * a0 * t2 + 16.0f * v0 * t1 + 30.0f * x0) / (2.0f * t2 * t2);
+    mC = -(3.0f * a0 * t2 + 12.0f * v0 * t1 + 20.0f * x0) / (2.0f * t2 * t1);
+    mDuration = duration;
+}
+
+float InertialChannel::Evaluate(float t) {
+    if(t >= mDuration) {
+        return 0.0f;
+    }
+    return ((((mA * t + mB) * t + mC) * t + 0.5f * mA0) * t + mV0) * t + mX0;
+}
+
+void CrossFadeController::Initialize(const Pose &restPose) {
+    mRestPose = restPose;
+    mPose = restPose;
+    for(unsigned int i = 0; i < CROSSFADE_MAX_TARGETS; ++i) {
+        mTargets[i].mPose = restPose;
+        mTargets[i].mClip = 0;
+    }
+    mTargetCount = 0;
+    mClip = 0;
+    mTime = 0.0f;
+    mMode = TRANSITION_CROSSFADE;
+    mPreviousPose = restPose;
+    mPreviousDt = 0.0f;
+    mTransitionPose = restPose;
+    mInertialElapsed = 0.0f;
+    mInertialDuration = 0.0f;
+    mInertializing = false;
+    mFollowing = false;
+}
+
+void CrossFadeController::Play(Clip *clip, float time) {
+    mTargetCount = 0;
+    mClip = clip;
+    mTime = time;
+    mPose = mRestPose;
+    mInertializing = false;
+    mFollowing = false;
+}
+
+void CrossFadeController::FadeTo(Clip *clip, float fadeTime) {
+    if(!mClip && !mFollowing) {
+        Play(clip, clip->mStartTime);
+        return;
+    }
+    if(mMode == TRANSITION_INERTIALIZE || mFollowing) {
+        if(mClip != clip || mTargetCount) {
+            InertializeTo(clip, clip->mStartTime, fadeTime);
+        }
+        return;
+    }
+    if(mTargetCount > 0) {
+        if(mTargets[mTargetCount - 1].mClip == clip) {
+            return;
+        }
+    }
+    else if(mClip == clip) {
+        return;
+    }
+    if(mTargetCount == CROSSFADE_MAX_TARGETS) {
+        Promote(0);
+    }
+    CrossFadeTarget *target = &mTargets[mTargetCount++];
+    target->mClip = clip;
+    target->mTime = clip->mStartTime;
+    target->mDuration = fadeTime;
+    target->mElapsed = 0.0f;
+}
+
+void CrossFadeController::Update(float dt) {
+    if(!mClip) {
+        return;
+    }
+    PROFILE_SCOPE("CrossFadeController::Update");
+    mPreviousPose = mPose;
+    mPreviousDt = dt;
+    // The newest finished fade becomes the clip everything else blends over
+    for(int i = (int)mTargetCount - 1; i >= 0; --i) {
+        if(mTargets[i].mElapsed >= mTargets[i].mDuration) {
+            Promote((unsigned int)i);
+            break;
+        }
+    }
+
+    mPose = mRestPose;
+    mTime = mClip->Sample(mPose, mTime + dt);
+    for(unsigned int i = 0; i < mTargetCount; ++i) {
+        CrossFadeTarget *target = &mTargets[i];
+        target->mPose = mRestPose;
+        target->mTime = target->mClip->Sample(target->mPose, target->mTime + dt);
+        target->mElapsed += dt;
+        float t = target->mDuration > 0.0f ? target->mElapsed / target->mDuration : 1.0f;
+        if(t > 1.0f) {
+            t = 1.0f;
+        }
+        Blend(mPose, mPose, target->mPose, t);
+    }
+
+    if(mInertializing) {
+        mInertialElapsed += dt;
+        if(mInertialElapsed >= mInertialDuration) {
+            mInertializing = false;
+        }
+        else {
+            ApplyInertialization();
+        }
+    }
+}
+
+Pose &CrossFadeController::GetCurrentPose() {
+    return mPose;
+}
+
+Clip *CrossFadeController::GetCurrentClip() {
+    return mClip;
+}
+
+void CrossFadeController::Promote(unsigned int index) {
+    mClip = mTargets[index].mClip;
+    mTime = mTargets[index].mTime;
+    std::swap(mPose, mTargets[index].mPose);
+    // Pose swaps only exchange the pooled buffers
+    unsigned int removed = index + 1;
+    for(unsigned int i = removed; i < mTargetCount; ++i) {
+        std::swap(mTargets[i - removed], mTargets[i]);
+    }
+    mTargetCount -= removed;
+}
+
+void CrossFadeController::InertializeTo(Clip *clip, float time, float blendTime) {
+    // The offsets are measured against the frame being jumped to
+    mTransitionPose = mRestPose;
+    time = clip->Sample(mTransitionPose, time);
+    StartInertialization(mTransitionPose, blendTime);
+    mTargetCount = 0;
+    mClip = clip;
+    mTime = time;
+    mFollowing = false;
+}
+
+void CrossFadeController::Follow(const Pose &pose, float dt, float blendTime) {
+    PROFILE_SCOPE("CrossFadeController::Follow");
+    if(!mFollowing) {
+        // Nothing shown yet has nothing to blend from
+        if(mClip) {
+            StartInertialization(pose, blendTime);
+        }
+        mTargetCount = 0;
+        mClip = 0;
+        mFollowing = true;
+    }
+    mPreviousPose = mPose;
+    mPreviousDt = dt;
+    mPose = pose;
+    if(mInertializing) {
+        mInertialElapsed += dt;
+        if(mInertialElapsed >= mInertialDuration) {
+            mInertializing = false;
+        }
+        else {
+            ApplyInertialization();
+        }
+    }
+}
+
+void CrossFadeController::StartInertialization(const Pose &destination, float blendTime) {
+    // The pose shown right now, which can be mid transition itself, is the source
+    unsigned int jointCount = mPose.Size();
+    float invDt = mPreviousDt > 0.0f ? 1.0f / mPreviousDt : 0.0f;
+    for(unsigned int i = 0; i < jointCount; ++i) {
+        const Transform &source = mPose.mJoints[i];
+        const Transform &previous = mPreviousPose.mJoints[i];
+        const Transform &target = destination.mJoints[i];
+
+        vec3 offset = source.mPosition - target.mPosition;
+        float x0 = len(offset);
+        vec3 axis = x0 > INERTIAL_EPSILON ? offset * (1.0f / x0) : vec3(1, 0, 0);
+        float xPrevious = dot(previous.mPosition - target.mPosition, axis);
+        mPositionOffsets[i].Initialize(axis, x0, (x0 - xPrevious) * invDt, blendTime);
+
+        quat rotation = source.mRotation * inverse(target.mRotation);
+        if(rotation.w < 0.0f) {
+            rotation = -rotation;
+        }
+        float s = sqrtf(rotation.x * rotation.x + rotation.y * rotation.y + rotation.z * rotation.z);
+        x0 = 2.0f * atan2f(s, rotation.w);
+        axis = s > INERTIAL_EPSILON ? vec3(rotation.x, rotation.y, rotation.z) * (1.0f / s) : vec3(1, 0, 0);
+        quat previousRotation = previous.mRotation * inverse(target.mRotation);
+        if(dot(previousRotation, rotation) < 0.0f) {
+            previousRotation = -previousRotation;
+        }
+        // Twist of last frame's offset around this frame's axis
+        xPrevious = 2.0f * atan2f(dot(vec3(previousRotation.x, previousRotation.y, previousRotation.z), axis), previousRotation.w);
+        mRotationOffsets[i].Initialize(axis, x0, (x0 - xPrevious) * invDt, blendTime);
+    }
+    mInertialElapsed = 0.0f;
+    mInertialDuration = blendTime;
+    mInertializing = true;
+}
+
+void CrossFadeController::ApplyInertialization() {
+    unsigned int jointCount = mPose.Size();
+    float t = mInertialElapsed;
+    for(unsigned int i = 0; i < jointCount; ++i) {
+        Transform &joint = mPose.mJoints[i];
+        InertialChannel &position = mPositionOffsets[i];
+        if(position.mX0 > 0.0f) {
+            joint.mPosition = joint.mPosition + position.mAxis * position.Evaluate(t);
+        }
+        InertialChannel &rotation = mRotationOffsets[i];
+        if(rotation.mX0 > 0.0f) {
+            float halfAngle = 0.5f * rotation.Evaluate(t);
+            float s = sinf(halfAngle);
+            quat offset(rotation.mAxis.x * s, rotation.mAxis.y * s, rotation.mAxis.z * s, cosf(halfAngle));
+            joint.mRotation = offset * joint.mRotation;
+        }
+    }
+}
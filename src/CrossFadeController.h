@@ -0,0 +1,91 @@
+#ifndef _CROSSFADECONTROLLER_H_
+#define _CROSSFADECONTROLLER_H_
+
+#include "Pose.h"
+#include "Clip.h"
+
+// Fades that can overlap, a new one past the limit finishes the oldest
+#define CROSSFADE_MAX_TARGETS 3
+
+enum TransitionMode {
+    // Samples both clips for the length of the fade and blends them
+    TRANSITION_CROSSFADE,
+    // Switches clips right away and decays the pose difference instead,
+    // only the new clip gets sampled
+    TRANSITION_INERTIALIZE
+};
+
+struct CrossFadeTarget {
+    Pose mPose;
+    Clip *mClip;
+    float mTime;
+    float mDuration;
+    float mElapsed;
+};
+
+// Offset along one axis decaying to zero with a quintic that starts at the
+// offset value and velocity and ends with no velocity and no acceleration
+struct InertialChannel {
+    vec3 mAxis;
+    float mX0;
+    float mV0;
+    float mA0;
+    float mA;
+    float mB;
+    float mC;
+    float mDuration;
+
+    void Initialize(vec3 axis, float x0, float v0, float duration);
+    float Evaluate(float t);
+};
+
+// Plays one clip and fades into the clips queued with FadeTo, blending each
+// target over the result with its weight. Every pose gets its pooled buffer
+// in Initialize, a transition only samples and blends and never allocates
+struct CrossFadeController {
+    CrossFadeTarget mTargets[CROSSFADE_MAX_TARGETS];
+    unsigned int mTargetCount;
+    Clip *mClip;
+    float mTime;
+    Pose mPose;
+    Pose mRestPose;
+
+    TransitionMode mMode;
+    // Last frame's pose, for the velocity of the offsets when a transition starts
+    Pose mPreviousPose;
+    float mPreviousDt;
+    Pose mTransitionPose;
+    InertialChannel mPositionOffsets[POSE_MAX_JOINTS];
+    InertialChannel mRotationOffsets[POSE_MAX_JOINTS];
+    float mInertialElapsed;
+    float mInertialDuration;
+    bool mInertializing;
+    // Showing a pose made outside the controller, see Follow
+    bool mFollowing;
+
+    void Initialize(const Pose &restPose);
+    // Switches right away and drops every fade in progress
+    void Play(Clip *clip, float time = 0.0f);
+    // Does nothing if the clip is already the one being faded to. How the
+    // transition looks depends on mMode
+    void FadeTo(Clip *clip, float fadeTime);
+    // Inertialized jump to any time of any clip, the same clip included
+    void InertializeTo(Clip *clip, float time, float blendTime);
+    // Shows pose, made by a blend space for example, in place of a clip. Call
+    // it every frame instead of Update. A pose made outside can not be sampled
+    // again to fade from, so going from a clip to a followed pose and back is
+    // always inertialized, over blendTime here and the fadeTime of FadeTo
+    void Follow(const Pose &pose, float dt, float blendTime);
+    void Update(float dt);
+    Pose &GetCurrentPose();
+    Clip *GetCurrentClip();
+
+private:
+    // Makes target index the current clip, the targets before it are fully covered by it
+    void Promote(unsigned int index);
+    // Offsets from the pose shown now to destination, decaying over blendTime
+    void StartInertialization(const Pose &destination, float blendTime);
+    void ApplyInertialization();
+};
+
+#endif
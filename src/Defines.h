@@ -2,6 +2,7 @@
 #define _DEFINES_H_
 
 #define TO_RAD(value) ((value)*(3.14159265359f/180.0f))
+#define TO_DEG(value) ((value)*(180.0f/3.14159265359f))
 
 #define ArrayCount(array) (sizeof(array)/sizeof((array)[0]))
 #define Assert(condition) if(!(condition)) { *(unsigned int*)0 = 0;}
@@ -0,0 +1,292 @@
+#include "Ecs.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "AllocTracker.h"
+
+#define CHUNK_COLUMN_ALIGN 16
+
+static const unsigned int gComponentSizes[COMPONENT_COUNT] = {
+    sizeof(Transform),
+    sizeof(VelocityComponent),
+    sizeof(AnimatorComponent),
+    sizeof(ColliderComponent),
+    sizeof(RenderableComponent)
+};
+
+static unsigned int AlignUp(unsigned int value, unsigned int align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+void EntityWorld::InitializeComponent(ComponentType type, void *dst) {
+    switch(type) {
+        case COMPONENT_TRANSFORM: {
+            Transform transform;
+            memcpy(dst, &transform, sizeof(Transform));
+        } break;
+        case COMPONENT_ANIMATOR: {
+            AnimatorComponent animator = {};
+            animator.mSpeed = 1.0f;
+            animator.mPose.mId = ECS_INVALID_INDEX;
+            animator.mPalette.mId = ECS_INVALID_INDEX;
+            // Allocated here so no frame has to, whatever level or cache path it takes
+            if(mRestPose.Size() > 0) {
+                AllocTagScope tag(ALLOC_TAG_ANIMATION);
+                animator.mPose = mPoses.AddComponent(mRestPose);
+                animator.mPalette = mPalettes.AddComponent(std::vector<mat4>(mRestPose.Size()));
+            }
+            memcpy(dst, &animator, sizeof(AnimatorComponent));
+        } break;
+        case COMPONENT_COLLIDER: {
+            ColliderComponent collider = {};
+            collider.mProxy = ECS_INVALID_INDEX;
+            memcpy(dst, &collider, sizeof(ColliderComponent));
+        } break;
+        default: {
+            memset(dst, 0, gComponentSizes[type]);
+        } break;
+    }
+}
+
+SlotmapKey *Chunk::Entities() {
+    return (SlotmapKey *)mData;
+}
+
+void *Chunk::Column(ComponentType type) {
+    unsigned int offset = mArchetype->mOffsets[type];
+    if(offset == ECS_INVALID_INDEX) {
+        return 0;
+    }
+    return mData + offset;
+}
+
+void EntityWorld::Initialize(const Pose &restPose) {
+    mRestPose = restPose;
+    mEntities.Initialize(1024);
+    mPoses.Initialize(1024);
+    mPalettes.Initialize(1024);
+    mPoseCache.Initialize();
+    mProxyEntities.clear();
+}
+
+void EntityWorld::Shutdown() {
+    for(unsigned int i = 0; i < mArchetypes.size(); ++i) {
+        Archetype *archetype = mArchetypes[i];
+        for(unsigned int j = 0; j < archetype->mChunks.size(); ++j) {
+            TrackedFree(archetype->mChunks[j]->mData);
+            delete archetype->mChunks[j];
+        }
+        delete archetype;
+    }
+    mArchetypes.clear();
+    mEntities.Initialize();
+    mPoses.Initialize();
+    mPalettes.Initialize();
+    mRestPose = Pose();
+    mPoseCache.Shutdown();
+    mBroadphase.Clear();
+    std::vector<Entity>().swap(mProxyEntities);
+}
+
+Archetype *EntityWorld::GetArchetype(unsigned int mask) {
+    AllocTagScope tag(ALLOC_TAG_ECS);
+    for(unsigned int i = 0; i < mArchetypes.size(); ++i) {
+        if(mArchetypes[i]->mMask == mask) {
+            return mArchetypes[i];
+        }
+    }
+
+    // The entity keys are the first column, every component column starts aligned
+    unsigned int bytesPerEntity = sizeof(SlotmapKey);
+    unsigned int columns = 1;
+    for(int type = 0; type < COMPONENT_COUNT; ++type) {
+        if(mask & COMPONENT_BIT(type)) {
+            bytesPerEntity += gComponentSizes[type];
+            ++columns;
+        }
+    }
+    unsigned int capacity = (unsigned int)(CHUNK_SIZE - columns * CHUNK_COLUMN_ALIGN) / bytesPerEntity;
+    assert(capacity > 0 && "components too big for a chunk");
+
+    Archetype *archetype = new Archetype;
+    archetype->mMask = mask;
+    archetype->mCapacity = capacity;
+    unsigned int offset = AlignUp(capacity * sizeof(SlotmapKey), CHUNK_COLUMN_ALIGN);
+    for(int type = 0; type < COMPONENT_COUNT; ++type) {
+        if(mask & COMPONENT_BIT(type)) {
+            archetype->mOffsets[type] = offset;
+            offset = AlignUp(offset + capacity * gComponentSizes[type], CHUNK_COLUMN_ALIGN);
+        }
+        else {
+            archetype->mOffsets[type] = ECS_INVALID_INDEX;
+        }
+    }
+    assert(offset <= CHUNK_SIZE);
+    mArchetypes.push_back(archetype);
+    return archetype;
+}
+
+EntityLocation EntityWorld::Allocate(Archetype *archetype, Entity entity) {
+    AllocTagScope tag(ALLOC_TAG_ECS);
+    if(archetype->mChunks.empty() || archetype->mChunks.back()->mCount == archetype->mCapacity) {
+        Chunk *chunk = new Chunk;
+        chunk->mArchetype = archetype;
+        chunk->mCount = 0;
+        chunk->mData = (unsigned char *)TrackedMalloc(CHUNK_SIZE, ALLOC_TAG_ECS);
+        archetype->mChunks.push_back(chunk);
+    }
+    EntityLocation location;
+    location.mArchetype = archetype;
+    location.mChunk = (unsigned int)archetype->mChunks.size() - 1;
+    Chunk *chunk = archetype->mChunks.back();
+    location.mIndex = chunk->mCount++;
+    chunk->Entities()[location.mIndex] = entity;
+    return location;
+}
+
+void EntityWorld::Free(EntityLocation location) {
+    Archetype *archetype = location.mArchetype;
+    Chunk *chunk = archetype->mChunks[location.mChunk];
+    unsigned int lastChunkIndex = (unsigned int)archetype->mChunks.size() - 1;
+    Chunk *lastChunk = archetype->mChunks[lastChunkIndex];
+    unsigned int lastIndex = lastChunk->mCount - 1;
+
+    // Move the last entity of the archetype into the hole
+    if(location.mChunk != lastChunkIndex || location.mIndex != lastIndex) {
+        for(int type = 0; type < COMPONENT_COUNT; ++type) {
+            if(archetype->mMask & COMPONENT_BIT(type)) {
+                unsigned int size = gComponentSizes[type];
+                unsigned char *dst = (unsigned char *)chunk->Column((ComponentType)type) + location.mIndex * size;
+                unsigned char *src = (unsigned char *)lastChunk->Column((ComponentType)type) + lastIndex * size;
+                memcpy(dst, src, size);
+            }
+        }
+        Entity moved = lastChunk->Entities()[lastIndex];
+        chunk->Entities()[location.mIndex] = moved;
+        *mEntities.GetComponent(moved) = location;
+    }
+
+    lastChunk->mCount--;
+    if(lastChunk->mCount == 0) {
+        TrackedFree(lastChunk->mData);
+        delete lastChunk;
+        archetype->mChunks.pop_back();
+    }
+}
+
+Entity EntityWorld::CreateEntity(unsigned int mask) {
+    AllocTagScope tag(ALLOC_TAG_ECS);
+    EntityLocation empty = {};
+    Entity entity = mEntities.AddComponent(empty);
+    Archetype *archetype = GetArchetype(mask);
+    EntityLocation location = Allocate(archetype, entity);
+    Chunk *chunk = archetype->mChunks[location.mChunk];
+    for(int type = 0; type < COMPONENT_COUNT; ++type) {
+        if(mask & COMPONENT_BIT(type)) {
+            unsigned int size = gComponentSizes[type];
+            InitializeComponent((ComponentType)type, (unsigned char *)chunk->Column((ComponentType)type) + location.mIndex * size);
+        }
+    }
+    *mEntities.GetComponent(entity) = location;
+    return entity;
+}
+
+void EntityWorld::DestroyEntity(Entity entity) {
+    EntityLocation *location = mEntities.GetComponent(entity);
+    if(!location) {
+        return;
+    }
+    ReleaseComponents(*location, location->mArchetype->mMask);
+    Free(*location);
+    mEntities.RemoveComponent(entity);
+}
+
+void EntityWorld::AddComponent(Entity entity, ComponentType type) {
+    EntityLocation *location = mEntities.GetComponent(entity);
+    if(!location || (location->mArchetype->mMask & COMPONENT_BIT(type))) {
+        return;
+    }
+    MoveEntity(entity, location->mArchetype->mMask | COMPONENT_BIT(type));
+}
+
+void EntityWorld::RemoveComponent(Entity entity, ComponentType type) {
+    EntityLocation *location = mEntities.GetComponent(entity);
+    if(!location || !(location->mArchetype->mMask & COMPONENT_BIT(type))) {
+        return;
+    }
+    // An entity without components has no archetype to live in
+    unsigned int newMask = location->mArchetype->mMask & ~COMPONENT_BIT(type);
+    if(newMask == 0) {
+        DestroyEntity(entity);
+        return;
+    }
+    MoveEntity(entity, newMask);
+}
+
+bool EntityWorld::HasComponent(Entity entity, ComponentType type) {
+    EntityLocation *location = mEntities.GetComponent(entity);
+    return location && (location->mArchetype->mMask & COMPONENT_BIT(type));
+}
+
+void *EntityWorld::GetComponent(Entity entity, ComponentType type) {
+    EntityLocation *location = mEntities.GetComponent(entity);
+    if(!location) {
+        return 0;
+    }
+    Chunk *chunk = location->mArchetype->mChunks[location->mChunk];
+    unsigned char *column = (unsigned char *)chunk->Column(type);
+    if(!column) {
+        return 0;
+    }
+    return column + location->mIndex * gComponentSizes[type];
+}
+
+unsigned int EntityWorld::EntityCount() {
+    return mEntities.Size();
+}
+
+// Releases the pooled data of the components in removed
+void EntityWorld::ReleaseComponents(EntityLocation location, unsigned int removed) {
+    Chunk *chunk = location.mArchetype->mChunks[location.mChunk];
+    if(removed & COMPONENT_BIT(COMPONENT_ANIMATOR)) {
+        AnimatorComponent *animator = (AnimatorComponent *)chunk->Column(COMPONENT_ANIMATOR) + location.mIndex;
+        if(mPoses.IsValid(animator->mPose)) mPoses.RemoveComponent(animator->mPose);
+        if(mPalettes.IsValid(animator->mPalette)) mPalettes.RemoveComponent(animator->mPalette);
+    }
+    if(removed & COMPONENT_BIT(COMPONENT_COLLIDER)) {
+        ColliderComponent *collider = (ColliderComponent *)chunk->Column(COMPONENT_COLLIDER) + location.mIndex;
+        if(collider->mProxy != ECS_INVALID_INDEX) {
+            mBroadphase.RemoveProxy(collider->mProxy);
+            mProxyEntities[collider->mProxy].mId = ECS_INVALID_INDEX;
+        }
+    }
+}
+
+void EntityWorld::MoveEntity(Entity entity, unsigned int newMask) {
+    // Removing the last component destroys the entity instead
+    assert(newMask != 0);
+    EntityLocation oldLocation = *mEntities.GetComponent(entity);
+    Archetype *oldArchetype = oldLocation.mArchetype;
+    Chunk *oldChunk = oldArchetype->mChunks[oldLocation.mChunk];
+    ReleaseComponents(oldLocation, oldArchetype->mMask & ~newMask);
+
+    Archetype *newArchetype = GetArchetype(newMask);
+    EntityLocation newLocation = Allocate(newArchetype, entity);
+    Chunk *newChunk = newArchetype->mChunks[newLocation.mChunk];
+    for(int type = 0; type < COMPONENT_COUNT; ++type) {
+        if(!(newMask & COMPONENT_BIT(type))) {
+            continue;
+        }
+        unsigned int size = gComponentSizes[type];
+        unsigned char *dst = (unsigned char *)newChunk->Column((ComponentType)type) + newLocation.mIndex * size;
+        if(oldArchetype->mMask & COMPONENT_BIT(type)) {
+            memcpy(dst, (unsigned char *)oldChunk->Column((ComponentType)type) + oldLocation.mIndex * size, size);
+        }
+        else {
+            InitializeComponent((ComponentType)type, dst);
+        }
+    }
+    Free(oldLocation);
+    *mEntities.GetComponent(entity) = newLocation;
+}
@@ -0,0 +1,170 @@
+#ifndef _ECS_H_
+#define _ECS_H_
+
+#include <vector>
+#include "Slotmap.h"
+#include "Transform.h"
+#include "Collision.h"
+#include "Pose.h"
+#include "SweepAndPrune.h"
+#include "PoseCache.h"
+#include "Defines.h"
+
+struct Mesh;
+struct Texture;
+
+// Components have to be trivially copyable, they are moved around with memcpy
+enum ComponentType {
+    COMPONENT_TRANSFORM,
+    COMPONENT_VELOCITY,
+    COMPONENT_ANIMATOR,
+    COMPONENT_COLLIDER,
+    COMPONENT_RENDERABLE,
+    COMPONENT_COUNT
+};
+
+#define COMPONENT_BIT(type) (1u << (type))
+#define ECS_INVALID_INDEX 0xFFFFFFFF
+
+struct VelocityComponent {
+    vec3 mVelocity;
+    vec3 mGravity;
+    bool mIsJumping;
+};
+
+// mPose and mPalette are keys into the pose and palette pools of the world,
+// both are created with the animator, sized to the rest pose of the world.
+// mLod is the level picked last update, clip time skipped by a lower update
+// rate waits in mPendingTime, mSampled tells the passes after the sampling
+// whether the pose changed this frame and mPosed is false until the first
+// sample. While mCacheEntry is not 0 the character is drawn with that entry
+// of the pose cache instead of mPalette
+struct AnimatorComponent {
+    unsigned int mClip;
+    float mPlayback;
+    float mSpeed;
+    SlotmapKey mPose;
+    SlotmapKey mPalette;
+    unsigned int mLod;
+    float mPendingTime;
+    bool mSampled;
+    bool mPosed;
+    unsigned int mCacheEntry;
+};
+
+// mLocalBounds is relative to the entity position, mProxy is the broadphase
+// proxy created by the collision system
+struct ColliderComponent {
+    AABB_min_max mLocalBounds;
+    unsigned int mProxy;
+};
+
+struct RenderableComponent {
+    Mesh *mMesh;
+    Texture *mTexture;
+};
+
+template <typename T> struct ComponentTypeOf;
+template <> struct ComponentTypeOf<Transform> { enum { Type = COMPONENT_TRANSFORM }; };
+template <> struct ComponentTypeOf<VelocityComponent> { enum { Type = COMPONENT_VELOCITY }; };
+template <> struct ComponentTypeOf<AnimatorComponent> { enum { Type = COMPONENT_ANIMATOR }; };
+template <> struct ComponentTypeOf<ColliderComponent> { enum { Type = COMPONENT_COLLIDER }; };
+template <> struct ComponentTypeOf<RenderableComponent> { enum { Type = COMPONENT_RENDERABLE }; };
+
+#define CHUNK_SIZE Kilobyte(16)
+
+struct Archetype;
+
+// Fixed size block holding mCapacity entities of one archetype,
+// every component type is stored as its own contiguous column
+struct Chunk {
+    Archetype *mArchetype;
+    unsigned int mCount;
+    unsigned char *mData;
+
+    SlotmapKey *Entities();
+    void *Column(ComponentType type);
+
+    template <typename T>
+    T *Column() {
+        return (T *)Column((ComponentType)ComponentTypeOf<T>::Type);
+    }
+};
+
+struct Archetype {
+    unsigned int mMask;
+    unsigned int mCapacity;
+    unsigned int mOffsets[COMPONENT_COUNT]; // column offsets inside a chunk
+    std::vector<Chunk *> mChunks;
+};
+
+struct EntityLocation {
+    Archetype *mArchetype;
+    unsigned int mChunk;
+    unsigned int mIndex;
+};
+
+typedef SlotmapKey Entity;
+
+// Entities with the same set of components share an archetype and are packed
+// in its chunks. Destroying an entity moves the last one of the archetype into
+// the hole, so only the last chunk of an archetype is ever partially filled
+struct EntityWorld {
+    Slotmap<EntityLocation> mEntities;
+    std::vector<Archetype *> mArchetypes;
+
+    // Non trivially copyable per entity data lives in pools referenced by key,
+    // an animator gets a copy of mRestPose and a palette of its size
+    Pose mRestPose;
+    Slotmap<Pose> mPoses;
+    Slotmap<std::vector<mat4> > mPalettes;
+    // Poses shared by the characters playing the same clip at the same time
+    PoseCache mPoseCache;
+
+    // Character against character broadphase, mProxyEntities maps proxies back to entities
+    SweepAndPrune mBroadphase;
+    std::vector<Entity> mProxyEntities;
+
+    void Initialize(const Pose &restPose);
+    void Shutdown();
+
+    Entity CreateEntity(unsigned int mask);
+    void DestroyEntity(Entity entity);
+    void AddComponent(Entity entity, ComponentType type);
+    void RemoveComponent(Entity entity, ComponentType type);
+    bool HasComponent(Entity entity, ComponentType type);
+    void *GetComponent(Entity entity, ComponentType type);
+    unsigned int EntityCount();
+
+    template <typename T>
+    T *GetComponent(Entity entity) {
+        return (T *)GetComponent(entity, (ComponentType)ComponentTypeOf<T>::Type);
+    }
+
+    // Calls f(Chunk *) for every non empty chunk that has all the components in mask
+    template <typename F>
+    void ForEachChunk(unsigned int mask, F f) {
+        for(unsigned int i = 0; i < mArchetypes.size(); ++i) {
+            Archetype *archetype = mArchetypes[i];
+            if((archetype->mMask & mask) != mask) {
+                continue;
+            }
+            for(unsigned int j = 0; j < archetype->mChunks.size(); ++j) {
+                Chunk *chunk = archetype->mChunks[j];
+                if(chunk->mCount > 0) {
+                    f(chunk);
+                }
+            }
+        }
+    }
+
+private:
+    Archetype *GetArchetype(unsigned int mask);
+    EntityLocation Allocate(Archetype *archetype, Entity entity);
+    void Free(EntityLocation location);
+    void MoveEntity(Entity entity, unsigned int newMask);
+    void ReleaseComponents(EntityLocation location, unsigned int removed);
+    void InitializeComponent(ComponentType type, void *dst);
+};
+
+#endif
@@ -5,378 +5,28 @@
 #include "Slotmap.h"
 #include "Input.h"
 #include "Defines.h"
+#include "Collision.h"
+#include "Systems.h"
+#include "Arena.h"
+#include "Platform.h"
+#include "Profiler.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <cmath>
 
 #include <assert.h>
 #include <glad/glad.h>
 
-
-
-
-//////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////
-// TODO: Collision Detection System...
-// -If it looks right it is right
-// -Nothing is faster than not having to perform a task
-
-// Barycentric Coords
-void SolveBarycentric(vec3 a, vec3 b, vec3 c, vec3 p, float &u, float &v, float &w) {
-    vec3 v0 = b - a;
-    vec3 v1 = c - a;
-    vec3 v2 = p - a;
-    float d00 = dot(v0, v0);
-    float d10 = dot(v1, v0);
-    float d11 = dot(v1, v1);
-    float d20 = dot(v2, v0);
-    float d21 = dot(v2, v1);
-    float denom = d00*d11 - d10*d10;
-    v = (d20*d11 - d10*d21) / denom;
-    w = (d00*d21 - d20*d10) / denom;
-    u = 1.0f - v - w;
-}
-
-// Plane
-struct Plane {
-    vec3 n;  
-    vec3 p;
-};
-
-
-// Polygones
-// Convex Check
-int IsConvexQuad(vec3 a, vec3 b, vec3 c, vec3 d) {
-    // Quad is nonconvex if Dot(Cross(bd, ba), Cross(bd, bc)) >= 0
-    vec3 bda = cross(d - b, a - b);
-    vec3 bdc = cross(d - b, c - b);
-    if(dot(bda, bdc) >= 0.0f) return 0;
-    // Quad is now convex if Dot(Cross(ac, ad), Cross(ac, ab)) < 0
-    vec3 acd = cross(c - a, d - a);
-    vec3 acb = cross(c - a, b - a);
-    return dot(acd, acb) < 0.0f;
-}
-
-
-//Axis Allined Bounding Boxes
-
-struct AABB_min_max {
-    vec3 min;
-    vec3 max;
-};
-
-struct AABB_min_widths {
-    vec3 min;
-    float d[3];
-};
-
-struct AABB_center_radius {
-    vec3 center;
-    float r[3];
-};
-///the function can be effectively implemented by simply stripping
-///the sign bit of the binary representation 
-
-
-// Computing an encompassing bounding box for a rotated AABB using min-max representation
-// Transform AABB a by the matrix m and translation t,
-// find the maximun extents, and store result into AABB b
-void UpdateAABB(AABB_min_max a, float m[3][3], float t[3], AABB_min_max &b) {
-    // For all three axes
-    for(int i = 0; i < 3; ++i) {
-        // start by adding in the translation
-        b.min.v[i] = b.max.v[i] = t[i];
-        // Form extent by summing smaller and larger terms respectively
-        for(int j = 0; j < 3; ++j) {
-            float e = m[i][j] * a.min.v[j];
-            float f = m[i][j] * a.max.v[j];
-            if(e < f) {
-                b.min.v[i] += e;
-                b.max.v[i] += f;
-            } else {
-                b.min.v[i] += f;
-                b.max.v[i] += e;
-            }
-        }
-    }
-}
-
-// the code for the center-radius AABB representation becomes
-// Transform AABB a by the matrix m and translation t,
-// find the maximun extents, and store result into AABB b
-void UpdateAABB(AABB_center_radius a, float m[3][3], float t[3], AABB_center_radius &b) {
-    for(int i = 0; i < 3; ++i) {
-        b.center.v[i] = t[i];
-        b.r[i] = 0.0f;
-        for(int j = 0; j < 3; ++j) {
-            b.center.v[i] += m[i][j] * a.center.v[j];
-            b.r[i] += fabsf(m[i][j]) * a.r[j];
-        }
-    }
-}
-
-// Spheres
-struct Sphere {
-    vec3 c; // sphere center
-    float r; // sphere radius
-};
-
-int TestSphereSphere(Sphere a, Sphere b) {
-    // Calculate the squared distance between centers
-    vec3 d = a.c - b.c;
-    float dist2 = dot(d, d);
-    float radSum = a.r + b.r;
-    return dist2 <= radSum * radSum;
-}
-
-// Computing the bounding Sphere
-// Compute indices to the two most separeted points of the (up to) six points
-// defining tha AAABB encompassing the point set. Return these as min and max
-void MostSeparatedPointsOnAABB(int &min, int &max, vec3 pt[], int numPts) {
-    int minx = 0, maxx = 0, miny = 0, maxy = 0, minz = 0, maxz = 0;
-    for(int i = 1; i < numPts; ++i) {
-        if(pt[i].x < pt[minx].x) minx = i;
-        if(pt[i].x > pt[maxx].x) maxx = i;
-        if(pt[i].y < pt[miny].y) miny = i;
-        if(pt[i].y > pt[maxy].y) maxy = i;
-        if(pt[i].z < pt[minz].z) minz = i;
-        if(pt[i].z > pt[maxz].z) maxz = i;
-    }
-    // Compute the squared distances for the three pairs of points
-    float dist2x = dot(pt[maxx] - pt[minx], pt[maxx] - pt[minx]);
-    float dist2y = dot(pt[maxy] - pt[miny], pt[maxy] - pt[miny]);
-    float dist2z = dot(pt[maxz] - pt[minz], pt[maxz] - pt[minz]);
-    min = minx;
-    max = maxx;
-    if(dist2y > dist2x && dist2y > dist2z) {
-        min = miny;
-        max = maxy;
-    }
-    if(dist2z > dist2x && dist2z > dist2y) {
-        min = minz;
-        max = maxz;
-    }
-}
-
-void SphereFromDistantPoints(Sphere &s, vec3 pt[], int numPts) {
-    // Find the most separated pair defining the encompassing AABB
-    int min, max;
-    MostSeparatedPointsOnAABB(min, max, pt, numPts);
-    // Set up the sphere to just encompase these two points
-    s.c = (pt[min] + pt[max]) * 0.5f;
-    s.r = dot(pt[max] - s.c, pt[max] - s.c);
-    s.r = sqrtf(s.r);
-}
-
-void SphereOfSphereAndPt(Sphere &s, vec3 &p) {
-    // Compute squared distance between point and sphere center
-    vec3 d = p - s.c;
-    float dist2 = dot(d, d);
-    // Only update s if point p is outside it
-    if(dist2 > s.r * s.r) {
-        float dist = sqrtf(dist2);
-        float newRadius = (s.r + dist) * 0.5f;
-        float k = (newRadius - s.r) / dist;
-        s.r = newRadius;
-        s.c = s.c + (d * k);
-    }
-}
-
-// The full Code for computing the approximate bounding sphere becomes
-void RitterSphere(Sphere &s, vec3 pt[], int numPts) {
-    // Get sphere encompassing two approximately most distant points
-    SphereFromDistantPoints(s, pt, numPts);
-    
-    // Grow sphere to include all points
-    for(int i = 0; i < numPts; ++i) {
-        SphereOfSphereAndPt(s, pt[i]);
-    }
-}
-
-// Compute variance of a set of 1D values
-float Variance(float x[], int n) {
-    float u = 0.0f;
-    for(int i = 0; i < n; ++i) {
-        u += x[i];
-    }
-    u /= n;
-    float s2 = 0.0f;
-    for(int i = 0; i < n; ++i) {
-        s2 += (x[i] - u) * (x[i] - u);
-    }
-    return s2 / n;
-}
-
-
-/*
-| 00 01 02 | 
-| 10 11 12 | 
-| 20 21 22 | 
-*/
-
-void CovarianceMatrix(float cov[3][3], vec3 pt[], int numPts) {
-    float oon = 1.0f / (float)numPts;
-    vec3 c = vec3(0, 0, 0);
-    float e00, e11, e22, e01, e02, e12;
-    // Compute the center of mass (centroid) of the points 
-    for(int i = 0; i < numPts; ++i) {
-        c = c + pt[i];
-    }
-    c = c * oon;
-    // Compute covariance elements;
-    e00 = e11 = e22 = e01 = e02 = e12 = 0.0f;
-    for(int i = 0; i < numPts; ++i) {
-        // translate points so center of mass is at origin
-        vec3 p = pt[i] - c;
-        // Compute covariance of traslated points
-        e00 += p.x * p.x;
-        e01 += p.x * p.y;
-        e02 += p.x * p.z;
-        e11 += p.y * p.y;
-        e12 += p.y * p.z;
-        e22 += p.z * p.z;
-    }
-    // Fill the covariance matrix elements
-    cov[0][0] = e00 * oon;
-    cov[1][1] = e11 * oon;
-    cov[2][2] = e22 * oon;
-    cov[0][1] = cov[1][0] = e01 * oon;
-    cov[0][2] = cov[2][0] = e02 * oon;
-    cov[1][2] = cov[2][1] = e12 * oon;
-}
-
-struct OBB {
-    vec3 c;      // OBB center point
-    vec3 u[3];  // Local x-, y- and z-axes ( have to be normalized )
-    vec3 e;      // Positive halfwidth extents of OBB along each axis
-};
-
-
-// Given point p, return the point q on or in AABB b that is closest to p
-void ClosestPtPointAABB(vec3 p, AABB_min_max b, vec3 &q) {
-    // For each coordinate axis, if the point coordinate value is
-    // outside box, clamp it to the box, else keep it as is
-    for(int i = 0; i < 3; ++i) {
-        float v = p.v[i];
-        if(v < b.min.v[i]) v = b.min.v[i];
-        if(v > b.max.v[i]) v = b.max.v[i];
-        q.v[i] = v;
-    }
-}
-
-// Computes the square distance between a point p and an AADD b
-float SqDistPointAABB(vec3 p, AABB_min_max b) {
-    float sqDist = 0.0f;
-    for(int i = 0; i < 3; ++i) {
-        float v = p.v[i];
-        if(v < b.min.v[i]) sqDist += (b.min.v[i] - v) * (b.min.v[i] - v);
-        if(v > b.max.v[i]) sqDist += (v - b.max.v[i]) * (v - b.max.v[i]);
-    }
-    return sqDist;
-}
-
-vec3 GetAABBNormalFromPoint(vec3 p, AABB_min_max b, float playerY) {
-    if(p.x == b.max.x && playerY != b.max.y) {
-        return vec3(1, 0, 0);
-    }
-    else if(p.x == b.min.x && playerY != b.max.y) {
-        return vec3(-1, 0, 0);
-    }
-    if(p.z == b.max.z && playerY != b.max.y) {
-        return vec3(0, 0, 1);
-    }
-    else if(p.z == b.min.z && playerY != b.max.y) {
-        return vec3(0, 0, -1);
-    }
-    if(p.y == b.max.y) {
-        return vec3(0, 1, 0);
-    }
-    else if(p.y == b.min.y) {
-        return vec3(0, -1, 0);
-    }
-    return vec3();
-}
-
-vec3 ClosestPtPointPlane(vec3 q, Plane plane)
-{
-    vec3 n = plane.n;
-    vec3 p = plane.p;
-    float t = dot(n, q - p) / dot(n , n);
-    vec3 r = q - (n * t);
-    return r;
-}
-
-float SqDistPointOBB(vec3 p, OBB b) {
-    vec3 v = p - b.c;
-    float sqDist = 0.0f;
-    for(int i = 0; i < 3; ++i) {
-        // Project vector from box center to p on each axis, getting the distance
-        // of p along that axis, and count any excess distance outside box extends
-        float d = dot(v, b.u[i]), excess = 0.0f;
-        if(d < -b.e.v[i]) {
-            excess = d + b.e.v[i];
-        }
-        else if (d > b.e.v[i]) {
-            excess = d - b.e.v[i];
-        }
-        sqDist += excess * excess;
-    }
-    return sqDist;
-}
-
-void ClosestPtPointOBB(vec3 p, OBB b, vec3 &q) {
-    vec3 d = p - b.c;
-    // start result at center of the box; make steps from there
-    q = b.c;
-    // For each OBB axis...
-    for(int i = 0; i < 3; ++i) {
-        // project d onto that axis to get the distance
-        // along the axis of d from the box center
-        float dist = dot(d, b.u[i]);
-        if(dist > b.e.v[i]) dist = b.e.v[i];
-        if(dist < -b.e.v[i]) dist = -b.e.v[i];
-        // Step that distance along the axis to get world coordinate
-        q = q + b.u[i] * dist;
-    }
-}
-
-vec3 GetOBBNormalFromPoint(vec3 p, OBB b, float playerY) {
-
-    vec3 pRel = p - b.c;
-    float xDot = round(dot(pRel, b.u[0]));
-    if(xDot == b.e.x && playerY != b.c.y + b.e.y) {
-        return b.u[0];
-    }
-    else if(xDot == -b.e.x && playerY != b.c.y + b.e.y) {
-        return b.u[0] * -1.0f;
-    }
-
-    float zDot = round(dot(pRel, b.u[2]));
-    if(zDot == b.e.z && playerY != b.c.y + b.e.y) {
-        return b.u[2];
-    }
-    else if(zDot == -b.e.z && playerY != b.c.y + b.e.y) {
-        return b.u[2] * -1.0f;
-    }
-
-    float yDot = round(dot(pRel, b.u[1]));
-    if(yDot == b.e.y) {
-        return b.u[1];
-    }
-    else if(yDot == -b.e.y) {
-        return b.u[1] * -1.0f;
-    }
-    return vec3();
-}
-
-
-//////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////
-
-
-
+#define CROWD_ROWS 4
+#define CROWD_COLUMNS 8
+#define PLAYER_CROSSFADE_TIME 0.2f
+#define PLAYER_WALK_SPEED 6.0f
+// How fast the locomotion speed follows the input, per second
+#define PLAYER_SPEED_EASE 10.0f
 
 void Game::Initialize() {
+    PROFILE_SCOPE("Game::Initialize");
     // Initialize
     mRenderer.Initialize();
     mShader.Initialize("../src/shaders/Vertex.glsl", "../src/shaders/Fragment.glsl");
@@ -410,17 +60,33 @@ void Game::Initialize() {
     mBindPose = LoadBindPose(CloneModel);
     mSkeleton.SetPoses(mRestPose, mBindPose);
     mClips = LoadClips(CloneModel);
-    mPlayback = 0.0f;
-    mAnimatedPose = mRestPose;
+    // The player is moved by the clips, the walk cycle sets its speed
+    int hips = FindJointIndex(CloneModel, "mixamorig:Hips");
+    int leftFoot = FindJointIndex(CloneModel, "mixamorig:LeftFoot");
+    int rightFoot = FindJointIndex(CloneModel, "mixamorig:RightFoot");
+    if(hips >= 0 && leftFoot >= 0 && rightFoot >= 0) {
+        for(unsigned int i = 0; i < (unsigned int)mClips.size(); ++i) {
+            mClips[i].ExtractRootMotion(mRestPose, (unsigned int)hips, (unsigned int)leftFoot, (unsigned int)rightFoot);
+        }
+    }
+    mFadeController.Initialize(mRestPose);
+    // Only the clip being switched to gets sampled during a transition
+    mFadeController.mMode = TRANSITION_INERTIALIZE;
+    // Idle to walk by speed, the clips outside it go through the fade controller
+    mLocomotion.Initialize(mRestPose, false);
+    mLocomotion.AddClip(&mClips[1], vec2(0.0f, 0.0f));
+    mLocomotion.AddClip(&mClips[3], vec2(PLAYER_WALK_SPEED, 0.0f));
+    mLocomotion.Build();
+    mFootRig.Initialize(CloneModel);
+    mAnimationLod.Initialize(CloneModel, mRestPose, mTest.mBounds, mClips);
     
     FreeGLTFFile(CloneModel);
     
     // Set Uniforms
-#if 0
-    mat4 projection = perspective(60.0f, 1920.0f/1080.0f, 0.01f, 100.0f);
-#else
-    mat4 projection = perspective(60.0f, 1280.0f/720.0f, 0.01f, 100.0f);
-#endif
+    int windowWidth, windowHeight;
+    PlatformGetWindowSize(&windowWidth, &windowHeight);
+    mat4 projection = perspective(60.0f, (float)windowWidth/(float)windowHeight, 0.01f, 100.0f);
+    mAnimationLod.SetProjection(60.0f, (float)windowWidth/(float)windowHeight, 100.0f);
 
     mShader.UpdateMat4("projection", projection);
     mCamera.Initialize(vec3(0, 6, -10), vec3(0, 3, 0));
@@ -451,22 +117,112 @@ void Game::Initialize() {
     mCloneRotOffset = 0.0f;
     mCloneGravity = vec3(0, -9.8f*3.0f, 0);
     mCloneVelocity = vec3(0, 0, 0); 
+    mCloneSpeed = 0.0f;
 
     mCubemapShader.UpdateMat4("model", mat4());
-}
 
+    // Scene colliders, shared by the player collision and the ray queries
+    mColliders.push_back(MakeAABBCollider(vec3(-2, 0, -2), vec3(2, 4, 2)));
+    mColliders.push_back(MakeAABBCollider(vec3(5, 0, 5), vec3(15, 6, 15)));
+    OBB cubeOBB;
+    cubeOBB.c = vec3(10, 3, 20);
+    mat4 rotationMatrix = quatToMat4(angleAxis(TO_RAD(45.0f), vec3(0, 1, 0)));
+    cubeOBB.u[0] = normalized(transformVector(rotationMatrix, vec3(1, 0, 0)));
+    cubeOBB.u[1] = normalized(transformVector(rotationMatrix, vec3(0, 1, 0)));
+    cubeOBB.u[2] = normalized(transformVector(rotationMatrix, vec3(0, 0, 1)));
+    cubeOBB.e = vec3(10.0f, 3.0f, 10.0f);
+    mColliders.push_back(MakeOBBCollider(cubeOBB));
+    mColliders.push_back(MakeAABBCollider(vec3(-500, -4, -500), vec3(500, 0.5f, 500)));
+    mRaycastWorld.Build(&mColliders[0], (int)mColliders.size());
+    mRaycastWorld.StartWorkers(0);
+
+    // Crowd of clones driven by the entity systems
+    mWorld.Initialize(mRestPose);
+    unsigned int cloneMask = COMPONENT_BIT(COMPONENT_TRANSFORM) |
+                             COMPONENT_BIT(COMPONENT_VELOCITY) |
+                             COMPONENT_BIT(COMPONENT_ANIMATOR) |
+                             COMPONENT_BIT(COMPONENT_COLLIDER) |
+                             COMPONENT_BIT(COMPONENT_RENDERABLE);
+    for(int z = 0; z < CROWD_ROWS; ++z) {
+        for(int x = 0; x < CROWD_COLUMNS; ++x) {
+            Entity clone = mWorld.CreateEntity(cloneMask);
+            Transform *transform = mWorld.GetComponent<Transform>(clone);
+            transform->mPosition = vec3(-10.0f - x * 3.0f, 2.5f, -6.0f + z * 3.0f);
+            transform->mRotation = angleAxis(TO_RAD(90.0f), vec3(0, 1, 0));
+            VelocityComponent *velocity = mWorld.GetComponent<VelocityComponent>(clone);
+            velocity->mGravity = vec3(0, -9.8f*3.0f, 0);
+            velocity->mIsJumping = true;
+            AnimatorComponent *animator = mWorld.GetComponent<AnimatorComponent>(clone);
+            animator->mClip = 1;
+            animator->mPlayback = (x * CROWD_ROWS + z) * 0.37f;
+            animator->mSpeed = 0.8f + 0.05f * (float)((x + z) % 8);
+            ColliderComponent *collider = mWorld.GetComponent<ColliderComponent>(clone);
+            collider->mLocalBounds.min = vec3(-0.5f, 0.0f, -0.5f);
+            collider->mLocalBounds.max = vec3(0.5f, 3.5f, 0.5f);
+            RenderableComponent *renderable = mWorld.GetComponent<RenderableComponent>(clone);
+            renderable->mMesh = &mTest;
+            renderable->mTexture = &mTexture;
+        }
+    }
 
-void Game::Update(float dt) {
-    mCamera.UpdateFollowCamera(&mCloneTransform);
-    mCamera.UpdateCameraInShader(&mShader);
-    mCamera.UpdateCameraInShader(&mStaticShader);
-    mCamera.UpdateCameraInShader(&mCubemapShader);
+    mCubemapTimer = 0.0f;
+    mSnapshots.Initialize();
+}
 
 
-    mPlayback = mClips[mCurrentAnim].Sample(mAnimatedPose, mPlayback + dt); 
+void Game::Update(float dt) {
+    PROFILE_SCOPE("Game::Update");
+    // Rewinding replays the stored frame with no time passing and does not record it again
+    bool rewinding = false;
+#ifdef _APP_DEBUG
+    if(KeyboardGetKeyDown(KEYBOARD_KEY_R) && mSnapshots.Count() > 1) {
+        GameSnapshot *snapshot = GetFrameArena()->Current()->PushArray<GameSnapshot>(1);
+        mSnapshots.Rewind(1, snapshot);
+        LoadSnapshot(snapshot);
+        rewinding = true;
+        dt = 0.0f;
+    }
+#endif
+    {
+        PROFILE_SCOPE("Camera");
+        mCamera.UpdateSpringArmCamera(&mCloneTransform, &mColliders[0], (int)mColliders.size(), dt);
+        mCamera.UpdateCameraInShader(&mShader);
+        mCamera.UpdateCameraInShader(&mStaticShader);
+        mCamera.UpdateCameraInShader(&mCubemapShader);
+    }
+
+    bool locomotion = mLocomotion.Contains(&mClips[mCurrentAnim]);
+    {
+        PROFILE_SCOPE("Animation sample");
+        if(locomotion) {
+            // Eases toward the speed of the state picked last frame
+            float targetSpeed = mCurrentAnim == 1 ? 0.0f : PLAYER_WALK_SPEED;
+            mCloneSpeed += (targetSpeed - mCloneSpeed) * fminf(dt * PLAYER_SPEED_EASE, 1.0f);
+            mLocomotion.mParameter = vec2(mCloneSpeed, 0.0f);
+            mLocomotion.Update(dt);
+            // Shown through the fade controller so leaving the jump blends into it
+            mFadeController.Follow(mLocomotion.GetCurrentPose(), dt, PLAYER_CROSSFADE_TIME);
+        }
+        else {
+            mFadeController.FadeTo(&mClips[mCurrentAnim], PLAYER_CROSSFADE_TIME);
+            mFadeController.Update(dt);
+        }
+    }
     
-    mAnimatedPose.GetMatrixPalette(mPosePalette);
-    mShader.UpdateMat4Array("pose", (int)mPosePalette.size(), &mPosePalette[0]);
+    {
+        PROFILE_SCOPE("Palette");
+        // The palette is only needed until it is uploaded, it goes to the frame arena
+        // A copy, the controllers keep the clean pose for the next frame
+        Pose pose = mFadeController.GetCurrentPose();
+        FootPlacement placement;
+        placement.mPose = &pose;
+        placement.mModel = mCloneTransform;
+        placement.mWeight = mCloneIsJumping ? 0.0f : 1.0f;
+        SolveFootPlacement(&mRaycastWorld, mFootRig, &placement, 1);
+        mat4 *posePalette = GetFrameArena()->Current()->PushArray<mat4>(pose.Size());
+        pose.GetMatrixPalette(posePalette);
+        mShader.UpdateMat4Array("pose", (int)pose.Size(), posePalette);
+    }
     
     if(mCloneIsJumping) { 
         mCloneVelocity = mCloneVelocity + mCloneGravity * dt;
@@ -476,7 +232,6 @@ void Game::Update(float dt) {
     }
 
     // TODO improve this a lot....
-    float speed = 6.0f;
     if(MouseGetButtonDown(MOUSE_BUTTON_RIGHT)) {
         mCloneRotOffset = 0.0f;
         mCloneDirection = normalized(vec3(mCamera.mFront.x, 0.0f, mCamera.mFront.z));
@@ -485,193 +240,278 @@ void Game::Update(float dt) {
     
         if(MouseGetButtonDown(MOUSE_BUTTON_LEFT) && mCloneJumping == false) {
             mCurrentAnim = 3;
-            mCloneTransform.mPosition = mCloneTransform.mPosition + (mCloneDirection * speed) * dt;
         }
     }
-    if(KeyboardGetKeyDown(KEYBOARD_KEY_W) && mCloneJumping == false) {
-        mCloneRotOffset = 0.0f;
-        mCurrentAnim = 3;
-        mCloneTransform.mPosition = mCloneTransform.mPosition + (mCloneDirection * speed) * dt;
-    }
-    if(KeyboardGetKeyDown(KEYBOARD_KEY_S) && mCloneJumping == false) {
-        mCurrentAnim = 3;
-        mCloneRotOffset = 180.0f;
-        mCloneTransform.mPosition = mCloneTransform.mPosition - (mCloneDirection * speed) * dt;
-    }
-    if(KeyboardGetKeyDown(KEYBOARD_KEY_A) && mCloneJumping == false) { 
-        mCurrentAnim = 3;
-        mCloneRotOffset = -90.0f;
-        mCloneTransform.mPosition = mCloneTransform.mPosition + (mCloneRight * speed) * dt;
-    }
-    if(KeyboardGetKeyDown(KEYBOARD_KEY_D) && mCloneJumping == false) {
-        mCurrentAnim = 3;
-        mCloneRotOffset = 90.0f;
-        mCloneTransform.mPosition = mCloneTransform.mPosition - (mCloneRight * speed) * dt; 
-    }
-    if(KeyboardGetKeyUp(KEYBOARD_KEY_W) &&
-       KeyboardGetKeyUp(KEYBOARD_KEY_S) &&
-       KeyboardGetKeyUp(KEYBOARD_KEY_A) &&
-       KeyboardGetKeyUp(KEYBOARD_KEY_D) &&
-       mCloneJumping == false) {
-        mCurrentAnim = 1;
+    // The held keys add up to the way the model faces, W and A walk
+    // diagonally and opposite keys cancel out
+    float keyRight = 0.0f;
+    float keyForward = 0.0f;
+    if(KeyboardGetKeyDown(KEYBOARD_KEY_W)) keyForward += 1.0f;
+    if(KeyboardGetKeyDown(KEYBOARD_KEY_S)) keyForward -= 1.0f;
+    if(KeyboardGetKeyDown(KEYBOARD_KEY_A)) keyRight -= 1.0f;
+    if(KeyboardGetKeyDown(KEYBOARD_KEY_D)) keyRight += 1.0f;
+    if(mCloneJumping == false) {
+        if(keyRight != 0.0f || keyForward != 0.0f) {
+            mCloneRotOffset = TO_DEG(atan2f(keyRight, keyForward));
+            mCurrentAnim = 3;
+        }
+        else {
+            mCurrentAnim = 1;
+        }
     }
-    if(MouseGetButtonDown(MOUSE_BUTTON_RIGHT) && MouseGetButtonDown(MOUSE_BUTTON_LEFT)) {
+    if(MouseGetButtonDown(MOUSE_BUTTON_RIGHT) && MouseGetButtonDown(MOUSE_BUTTON_LEFT) && mCloneJumping == false) {
         mCurrentAnim = 3;
     }
-#if 0
-    static float timer = 0.0f;
-    if(KeyboardGetKeyJustDown(KEYBOARD_KEY_SPACE) && timer == 0.0f) {
-        mCloneJumping = true;
-        mPlayback = 0.0f;
-    }
-    if(mCloneJumping) {
-        mCurrentAnim = 2;
-        timer += dt; 
+    if(locomotion && mCloneJumping == false) {
+        // Root motion of this frame's samples, turned to the way the keys face the model
+        quat facing = angleAxis(-(mCloneRotation + TO_RAD(90.0f + mCloneRotOffset)), vec3(0, 1, 0));
+        mCloneTransform.mPosition = mCloneTransform.mPosition + facing * mLocomotion.mRootTranslation;
+        mCloneRotation -= mLocomotion.mRootYaw;
     }
-
-    if(timer > 2.4f) {
-        mCloneJumping = false;
-        timer = 0.0f;
-    }
-#else
     if(KeyboardGetKeyJustDown(KEYBOARD_KEY_SPACE) && mCloneIsJumping == false) {
         mCloneVelocity.y += 1000.0f * dt; 
         mCloneIsJumping = true;
+        // The jump clip fades in next frame and plays until the player lands
+        mCloneJumping = true;
+        mCurrentAnim = 2;
     }
-#endif
     mCloneTransform.mPosition = mCloneTransform.mPosition + mCloneVelocity * dt;
 
-    // TODO: try to create a first implementation of axis align collision detection and resolution
-    // TODO: try to create a first implementation of oriented bounding box collision detection and resolution
-    ////////////////////////////////////////////////////////////////////////////////////////////////////
-    // Create tha AABB for the cube to be tested
-    bool dirtyFlag = false;
+    {
+        PROFILE_SCOPE("Player collision");
+        // TODO: try to create a first implementation of axis align collision detection and resolution
+        // TODO: try to create a first implementation of oriented bounding box collision detection and resolution
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        // Create tha AABB for the cube to be tested
+        bool dirtyFlag = false;
     
-    AABB_min_max greenCubeAABB;
-    greenCubeAABB.min.x = -2.0f;
-    greenCubeAABB.min.y = 0.0f;
-    greenCubeAABB.min.z = -2.0f;
-    greenCubeAABB.max.x = 2.0f;
-    greenCubeAABB.max.y = 4.0f;
-    greenCubeAABB.max.z = 2.0f;
-    float distanceFromBox = SqDistPointAABB(mCloneTransform.mPosition, greenCubeAABB);
-    if(distanceFromBox > 0.0f) {
-        ClosestPtPointAABB(mCloneTransform.mPosition, greenCubeAABB, mCollisionPoint);
-        if(mCloneTransform.mPosition.y > mCollisionPoint.y) {
-            mCloneIsJumping = true;
+        AABB_min_max greenCubeAABB = mColliders[0].mAABB;
+        float distanceFromBox = SqDistPointAABB(mCloneTransform.mPosition, greenCubeAABB);
+        if(distanceFromBox > 0.0f) {
+            ClosestPtPointAABB(mCloneTransform.mPosition, greenCubeAABB, mCollisionPoint);
+            if(mCloneTransform.mPosition.y > mCollisionPoint.y) {
+                mCloneIsJumping = true;
+            }
         }
-    }
-    if(distanceFromBox <= 0.0f){
-        vec3 collisionNormal = GetAABBNormalFromPoint(mCollisionPoint, greenCubeAABB, mCloneTransform.mPosition.y);
-        Plane collisionPlane;
-        collisionPlane.n = normalized(collisionNormal);
-        collisionPlane.p = mCollisionPoint;
-        mCloneTransform.mPosition = ClosestPtPointPlane(mCloneTransform.mPosition, collisionPlane);
-        if(collisionNormal.y) {
-            mCloneIsJumping = false;
-            mCloneVelocity.y = 0.0f; 
-            dirtyFlag = true;
+        if(distanceFromBox <= 0.0f){
+            vec3 collisionNormal = GetAABBNormalFromPoint(mCollisionPoint, greenCubeAABB, mCloneTransform.mPosition.y);
+            Plane collisionPlane;
+            collisionPlane.n = normalized(collisionNormal);
+            collisionPlane.p = mCollisionPoint;
+            mCloneTransform.mPosition = ClosestPtPointPlane(mCloneTransform.mPosition, collisionPlane);
+            if(collisionNormal.y) {
+                mCloneIsJumping = false;
+                mCloneVelocity.y = 0.0f; 
+                dirtyFlag = true;
+            }
         }
-    }
 
-    greenCubeAABB.min.x = 5.0f;
-    greenCubeAABB.min.y = 0.0f;
-    greenCubeAABB.min.z = 5.0f;
-    greenCubeAABB.max.x = 15.0f;
-    greenCubeAABB.max.y = 6.0f;
-    greenCubeAABB.max.z = 15.0f;
-    distanceFromBox = SqDistPointAABB(mCloneTransform.mPosition, greenCubeAABB);
-    if(distanceFromBox > 0.0f) {
-        ClosestPtPointAABB(mCloneTransform.mPosition, greenCubeAABB, mOtherCollisionPoint);
-        if(mCloneTransform.mPosition.y > mOtherCollisionPoint.y) {
-            mCloneIsJumping = true;
+        greenCubeAABB = mColliders[1].mAABB;
+        distanceFromBox = SqDistPointAABB(mCloneTransform.mPosition, greenCubeAABB);
+        if(distanceFromBox > 0.0f) {
+            ClosestPtPointAABB(mCloneTransform.mPosition, greenCubeAABB, mOtherCollisionPoint);
+            if(mCloneTransform.mPosition.y > mOtherCollisionPoint.y) {
+                mCloneIsJumping = true;
+            }
         }
-    }
-    if(distanceFromBox <= 0.0f){
-        vec3 collisionNormal = GetAABBNormalFromPoint(mOtherCollisionPoint, greenCubeAABB, mCloneTransform.mPosition.y);
-        Plane collisionPlane;
-        collisionPlane.n = normalized(collisionNormal);
-        collisionPlane.p = mOtherCollisionPoint;
-        mCloneTransform.mPosition = ClosestPtPointPlane(mCloneTransform.mPosition, collisionPlane);
-        if(collisionNormal.y) {
-            mCloneIsJumping = false;
-            mCloneVelocity.y = 0.0f; 
-            dirtyFlag = true;
+        if(distanceFromBox <= 0.0f){
+            vec3 collisionNormal = GetAABBNormalFromPoint(mOtherCollisionPoint, greenCubeAABB, mCloneTransform.mPosition.y);
+            Plane collisionPlane;
+            collisionPlane.n = normalized(collisionNormal);
+            collisionPlane.p = mOtherCollisionPoint;
+            mCloneTransform.mPosition = ClosestPtPointPlane(mCloneTransform.mPosition, collisionPlane);
+            if(collisionNormal.y) {
+                mCloneIsJumping = false;
+                mCloneVelocity.y = 0.0f; 
+                dirtyFlag = true;
+            }
         }
-    }
 
-    OBB cubeOBB;
-    cubeOBB.c = vec3(10, 3, 20);
-    mat4 rotationMatrix = quatToMat4(angleAxis(TO_RAD(45.0f), vec3(0, 1, 0)));
-    cubeOBB.u[0] = normalized(transformVector(rotationMatrix, vec3(1, 0, 0)));
-    cubeOBB.u[1] = normalized(transformVector(rotationMatrix, vec3(0, 1, 0)));
-    cubeOBB.u[2] = normalized(transformVector(rotationMatrix, vec3(0, 0, 1)));
-    cubeOBB.e.x = 10.0f;
-    cubeOBB.e.y = 3.0f;
-    cubeOBB.e.z = 10.0f;
-    distanceFromBox = SqDistPointOBB(mCloneTransform.mPosition, cubeOBB);
-    if(distanceFromBox > 0.0f) {
-        ClosestPtPointOBB(mCloneTransform.mPosition, cubeOBB, mOBBCollisionPoint);
-        if(mCloneTransform.mPosition.y > mOBBCollisionPoint.y) {
-            mCloneIsJumping = true;
+        OBB cubeOBB = mColliders[2].mOBB;
+        distanceFromBox = SqDistPointOBB(mCloneTransform.mPosition, cubeOBB);
+        if(distanceFromBox > 0.0f) {
+            ClosestPtPointOBB(mCloneTransform.mPosition, cubeOBB, mOBBCollisionPoint);
+            if(mCloneTransform.mPosition.y > mOBBCollisionPoint.y) {
+                mCloneIsJumping = true;
+            }
         }
-    }
-    if(distanceFromBox <= 0.0f) {
-        vec3 collisionNormal = GetOBBNormalFromPoint(mOBBCollisionPoint, cubeOBB, mCloneTransform.mPosition.y);
-        Plane collisionPlane;
-        collisionPlane.n = normalized(collisionNormal);
-        collisionPlane.p = mOBBCollisionPoint;
-        mCloneTransform.mPosition = ClosestPtPointPlane(mCloneTransform.mPosition, collisionPlane);
-        if(collisionNormal.y) {
-            mCloneIsJumping = false;
-            mCloneVelocity.y = 0.0f; 
-            dirtyFlag = true;
+        if(distanceFromBox <= 0.0f) {
+            vec3 collisionNormal = GetOBBNormalFromPoint(mOBBCollisionPoint, cubeOBB, mCloneTransform.mPosition.y);
+            Plane collisionPlane;
+            collisionPlane.n = normalized(collisionNormal);
+            collisionPlane.p = mOBBCollisionPoint;
+            mCloneTransform.mPosition = ClosestPtPointPlane(mCloneTransform.mPosition, collisionPlane);
+            if(collisionNormal.y) {
+                mCloneIsJumping = false;
+                mCloneVelocity.y = 0.0f; 
+                dirtyFlag = true;
+            }
         }
-    }
 
-    // TODO: add colision with the floor, gravity and a jump
-    // floor collision test and resolution
-    AABB_min_max floorAABB;
-    floorAABB.min.x = -500.0f;
-    floorAABB.min.y = -4.0f;
-    floorAABB.min.z = -500.0f;
-    floorAABB.max.x = 500.0f;
-    floorAABB.max.y = 0.5f;
-    floorAABB.max.z = 500.0f;
-    float distanceFromFloor = SqDistPointAABB(mCloneTransform.mPosition, floorAABB);
-    if(distanceFromFloor > 0.0f) {
-        ClosestPtPointAABB(mCloneTransform.mPosition, floorAABB, mFloorCollisionPont);
-        if(mCloneTransform.mPosition.y > mFloorCollisionPont.y) {
-            if(!dirtyFlag) mCloneIsJumping = true;
-        }
+        // TODO: add colision with the floor, gravity and a jump
+        // floor collision test and resolution
+        AABB_min_max floorAABB = mColliders[3].mAABB;
+        float distanceFromFloor = SqDistPointAABB(mCloneTransform.mPosition, floorAABB);
+        if(distanceFromFloor > 0.0f) {
+            ClosestPtPointAABB(mCloneTransform.mPosition, floorAABB, mFloorCollisionPont);
+            if(mCloneTransform.mPosition.y > mFloorCollisionPont.y) {
+                if(!dirtyFlag) mCloneIsJumping = true;
+            }
 
-    }
-    if(distanceFromFloor <= 0.0f){
-        vec3 collisionNormal = GetAABBNormalFromPoint(mFloorCollisionPont, floorAABB, mCloneTransform.mPosition.y);
-        Plane collisionPlane;
-        collisionPlane.n = normalized(collisionNormal);
-        collisionPlane.p = mFloorCollisionPont;
-        mCloneTransform.mPosition = ClosestPtPointPlane(mCloneTransform.mPosition, collisionPlane);
-        if(collisionNormal.y) {
-            mCloneIsJumping = false;
-            mCloneVelocity.y = 0.0f; 
         }
+        if(distanceFromFloor <= 0.0f){
+            vec3 collisionNormal = GetAABBNormalFromPoint(mFloorCollisionPont, floorAABB, mCloneTransform.mPosition.y);
+            Plane collisionPlane;
+            collisionPlane.n = normalized(collisionNormal);
+            collisionPlane.p = mFloorCollisionPont;
+            mCloneTransform.mPosition = ClosestPtPointPlane(mCloneTransform.mPosition, collisionPlane);
+            if(collisionNormal.y) {
+                mCloneIsJumping = false;
+                mCloneVelocity.y = 0.0f; 
+            }
+        }
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+    }
+    if(mCloneJumping && mCloneIsJumping == false) {
+        mCloneJumping = false;
+        mCurrentAnim = 1;
     }
-    ////////////////////////////////////////////////////////////////////////////////////////////////////
-
 
     mCloneTransform.mRotation = angleAxis(-(mCloneRotation + TO_RAD(90.0f + mCloneRotOffset)), vec3(0, 1, 0));
     mShader.UpdateMat4("model", transformToMat4(mCloneTransform));
 
+    MovementSystem(&mWorld, dt);
+    CollisionSystem(&mWorld, &mColliders[0], (int)mColliders.size());
+    mAnimationLod.SetView(mCamera.mPosition, mCamera.mFront);
+    AnimationSystem(&mWorld, mClips, mRestPose, dt, &mRaycastWorld, &mFootRig, &mAnimationLod);
+
     
-    static float cubemapTimer = 0.0f;
     Transform cubemapTransform;
-    cubemapTransform.mRotation = angleAxis(cubemapTimer, vec3(0, 1, 0));
+    cubemapTransform.mRotation = angleAxis(mCubemapTimer, vec3(0, 1, 0));
     mCubemapShader.UpdateMat4("model", transformToMat4(cubemapTransform));
-    cubemapTimer += dt * 0.02f;
+    mCubemapTimer += dt * 0.02f;
+
+    if(!rewinding) {
+        PROFILE_SCOPE("Snapshot");
+        GameSnapshot *snapshot = GetFrameArena()->Current()->PushArray<GameSnapshot>(1);
+        SaveSnapshot(snapshot);
+        mSnapshots.Push(snapshot);
+    }
+}
+
+void Game::SaveSnapshot(GameSnapshot *snapshot) {
+    // Zeroed first so padding and unused slots never show up in the deltas
+    memset((void *)snapshot, 0, sizeof(GameSnapshot));
+    snapshot->mPlayerTransform = mCloneTransform;
+    snapshot->mPlayerVelocity = mCloneVelocity;
+    snapshot->mPlayerDirection = mCloneDirection;
+    snapshot->mPlayerRight = mCloneRight;
+    snapshot->mPlayerRotation = mCloneRotation;
+    snapshot->mPlayerRotOffset = mCloneRotOffset;
+    snapshot->mPlayerJumping = mCloneJumping;
+    snapshot->mPlayerIsJumping = mCloneIsJumping;
+    snapshot->mCurrentAnim = mCurrentAnim;
+    snapshot->mPlayerSpeed = mCloneSpeed;
+    snapshot->mLocomotionPhase = mLocomotion.mPhase;
+    // The fade controller has no clip while it follows the locomotion blend space
+    snapshot->mFade.mClip = mFadeController.mClip ? (unsigned int)(mFadeController.mClip - &mClips[0]) : SNAPSHOT_NO_CLIP;
+    snapshot->mFade.mTime = mFadeController.mTime;
+    snapshot->mFade.mTargetCount = mFadeController.mTargetCount;
+    for(unsigned int i = 0; i < mFadeController.mTargetCount; ++i) {
+        CrossFadeTarget *target = &mFadeController.mTargets[i];
+        snapshot->mFade.mTargets[i].mClip = (unsigned int)(target->mClip - &mClips[0]);
+        snapshot->mFade.mTargets[i].mTime = target->mTime;
+        snapshot->mFade.mTargets[i].mDuration = target->mDuration;
+        snapshot->mFade.mTargets[i].mElapsed = target->mElapsed;
+    }
+    snapshot->mCollisionPoints[0] = mCollisionPoint;
+    snapshot->mCollisionPoints[1] = mFloorCollisionPont;
+    snapshot->mCollisionPoints[2] = mOtherCollisionPoint;
+    snapshot->mCollisionPoints[3] = mOBBCollisionPoint;
+    snapshot->mCamera = mCamera;
+    snapshot->mCubemapTimer = mCubemapTimer;
+
+    unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) |
+                        COMPONENT_BIT(COMPONENT_VELOCITY) |
+                        COMPONENT_BIT(COMPONENT_ANIMATOR);
+    mWorld.ForEachChunk(mask, [&](Chunk *chunk) {
+        Entity *entities = chunk->Entities();
+        Transform *transforms = chunk->Column<Transform>();
+        VelocityComponent *velocities = chunk->Column<VelocityComponent>();
+        AnimatorComponent *animators = chunk->Column<AnimatorComponent>();
+        for(unsigned int i = 0; i < chunk->mCount; ++i) {
+            assert(snapshot->mCharacterCount < GAME_SNAPSHOT_MAX_CHARACTERS && "too many characters for a snapshot");
+            CharacterSnapshot *character = &snapshot->mCharacters[snapshot->mCharacterCount++];
+            character->mEntity = entities[i];
+            character->mTransform = transforms[i];
+            character->mVelocity = velocities[i].mVelocity;
+            character->mIsJumping = velocities[i].mIsJumping;
+            character->mClip = animators[i].mClip;
+            character->mPlayback = animators[i].mPlayback;
+            character->mSpeed = animators[i].mSpeed;
+            character->mPendingTime = animators[i].mPendingTime;
+        }
+    });
+}
+
+void Game::LoadSnapshot(const GameSnapshot *snapshot) {
+    mCloneTransform = snapshot->mPlayerTransform;
+    mCloneVelocity = snapshot->mPlayerVelocity;
+    mCloneDirection = snapshot->mPlayerDirection;
+    mCloneRight = snapshot->mPlayerRight;
+    mCloneRotation = snapshot->mPlayerRotation;
+    mCloneRotOffset = snapshot->mPlayerRotOffset;
+    mCloneJumping = snapshot->mPlayerJumping != 0;
+    mCloneIsJumping = snapshot->mPlayerIsJumping != 0;
+    mCurrentAnim = snapshot->mCurrentAnim;
+    mCloneSpeed = snapshot->mPlayerSpeed;
+    mLocomotion.mPhase = snapshot->mLocomotionPhase;
+    // Poses are sampled again on the next update, only the clips and times
+    // matter. An inertialized transition in progress snaps to its clip, and
+    // a clip being left for the blend space has no pose to blend from
+    Clip *fadeClip = snapshot->mFade.mClip != SNAPSHOT_NO_CLIP ? &mClips[snapshot->mFade.mClip] : 0;
+    if(mLocomotion.Contains(&mClips[mCurrentAnim])) {
+        fadeClip = 0;
+    }
+    mFadeController.Play(fadeClip, snapshot->mFade.mTime);
+    mFadeController.mTargetCount = snapshot->mFade.mTargetCount;
+    for(unsigned int i = 0; i < snapshot->mFade.mTargetCount; ++i) {
+        CrossFadeTarget *target = &mFadeController.mTargets[i];
+        target->mClip = &mClips[snapshot->mFade.mTargets[i].mClip];
+        target->mTime = snapshot->mFade.mTargets[i].mTime;
+        target->mDuration = snapshot->mFade.mTargets[i].mDuration;
+        target->mElapsed = snapshot->mFade.mTargets[i].mElapsed;
+    }
+    mCollisionPoint = snapshot->mCollisionPoints[0];
+    mFloorCollisionPont = snapshot->mCollisionPoints[1];
+    mOtherCollisionPoint = snapshot->mCollisionPoints[2];
+    mOBBCollisionPoint = snapshot->mCollisionPoints[3];
+    mCamera = snapshot->mCamera;
+    mCubemapTimer = snapshot->mCubemapTimer;
+
+    // Characters destroyed since the snapshot are skipped
+    for(unsigned int i = 0; i < snapshot->mCharacterCount; ++i) {
+        const CharacterSnapshot *character = &snapshot->mCharacters[i];
+        Transform *transform = mWorld.GetComponent<Transform>(character->mEntity);
+        VelocityComponent *velocity = mWorld.GetComponent<VelocityComponent>(character->mEntity);
+        AnimatorComponent *animator = mWorld.GetComponent<AnimatorComponent>(character->mEntity);
+        if(!transform || !velocity || !animator) {
+            continue;
+        }
+        *transform = character->mTransform;
+        velocity->mVelocity = character->mVelocity;
+        velocity->mIsJumping = character->mIsJumping != 0;
+        animator->mClip = character->mClip;
+        animator->mPlayback = character->mPlayback;
+        animator->mSpeed = character->mSpeed;
+        animator->mPendingTime = character->mPendingTime;
+        // Counts as coming into view, so it is sampled on the next update whatever its level
+        animator->mLod = ANIMATION_LOD_CULLED;
+    }
 }
 
 void Game::Render() {
+    PROFILE_SCOPE("Game::Render");
 
 #if 1
     glDisable(GL_DEPTH_TEST);
@@ -687,6 +527,9 @@ void Game::Render() {
     mTest.Bind();
     mShader.Bind();
     mRenderer.DrawIndex(mTest.mIndicesCount);
+
+    // The crowd overwrites model and pose, Update sets the player ones again
+    RenderSystem(&mWorld, &mShader, &mRenderer);
     
     Transform floorModel;
     floorModel.mPosition = vec3(0, 0, 0);
@@ -775,6 +618,10 @@ void Game::Shutdown() {
 
     mTest.Unbind();
     mShader.Unbind();
+
+    mSnapshots.Shutdown();
+    mWorld.Shutdown();
+    mRaycastWorld.StopWorkers();
     
     mMesh.Shutdown();
     mCubemap.Shutdown();
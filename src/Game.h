@@ -9,6 +9,14 @@
 #include "Clip.h"
 #include "Transform.h"
 #include "Camera.h"
+#include "Collision.h"
+#include "Raycast.h"
+#include "Ecs.h"
+#include "Snapshot.h"
+#include "CrossFadeController.h"
+#include "BlendSpace.h"
+#include "IK.h"
+#include "AnimationLod.h"
 
 struct Game {
     Renderer mRenderer;
@@ -26,11 +34,12 @@ struct Game {
     Mesh mTest;
     Pose mRestPose;
     Pose mBindPose;
-    std::vector<mat4> mPosePalette;
     Skeleton mSkeleton;
     std::vector<Clip> mClips;
-    float mPlayback;
-    Pose mAnimatedPose;
+    CrossFadeController mFadeController;
+    BlendSpace mLocomotion;
+    FootIKRig mFootRig;
+    AnimationLod mAnimationLod;
 
     Camera mCamera;
     unsigned int mCurrentAnim;
@@ -39,6 +48,8 @@ struct Game {
     vec3 mCloneRight;
     float mCloneRotation;
     float mCloneRotOffset;
+    // Eased speed driving the locomotion blend space
+    float mCloneSpeed;
     bool mCloneJumping;
 
     vec3 mCollisionPoint;
@@ -50,10 +61,22 @@ struct Game {
     vec3 mCloneGravity;
     bool mCloneIsJumping;
 
+    std::vector<Collider> mColliders;
+    RaycastWorld mRaycastWorld;
+
+    EntityWorld mWorld;
+
+    float mCubemapTimer;
+    // Last frames of the simulation, holding R in debug builds walks back through them
+    SnapshotRing mSnapshots;
+
     void Initialize();
     void Update(float dt);
     void Render();
     void Shutdown();
+
+    void SaveSnapshot(GameSnapshot *snapshot);
+    void LoadSnapshot(const GameSnapshot *snapshot);
 };
 
 #endif
@@ -0,0 +1,680 @@
+// Headless entry point: runs the full game loop with a fixed dt and no
+// window. OpenGL calls go to stubs that only record what would be drawn,
+// so the timings measure the CPU side of the game. Run it from a directory
+// next to src and assets, like the Win32 build
+#ifndef _WIN32
+
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "Defines.h"
+#include "Game.h"
+#include "Input.h"
+#include "Arena.h"
+#include "AllocTracker.h"
+#include "Platform.h"
+#include "Profiler.h"
+#include "InputRecorder.h"
+#include "MotionMatching.h"
+#include "PoseCache.h"
+#include "SweepAndPrune.h"
+#include "SpatialHash.h"
+
+#define HEADLESS_WIDTH 1280
+#define HEADLESS_HEIGHT 720
+#define HEADLESS_DEFAULT_FRAMES 1000
+#define HEADLESS_DEFAULT_DT (1.0f / 60.0f)
+#define HEADLESS_MOTION_QUERIES 1000
+#define HEADLESS_CACHE_FRAMES 120
+// The demo crowd is 4 rows of 8, its phases and speeds follow the grid position
+#define HEADLESS_CROWD_ROWS 4
+#define HEADLESS_CROWD_SIZE 32
+#define HEADLESS_BROADPHASE_FRAMES 120
+// --walk holds W from this many frames after the warm up, and A on top of it
+// every other HEADLESS_WALK_TURN frames, so the first steps run in the steady state
+#define HEADLESS_WALK_DELAY 10
+#define HEADLESS_WALK_TURN 90
+
+struct HeadlessRenderStats {
+    unsigned int mDrawCalls;
+    unsigned long long mIndices;
+    unsigned long long mVertices;
+    unsigned int mUniformUploads;
+};
+
+static HeadlessRenderStats gRenderStats;
+static unsigned int gNextObjectId = 1;
+static InputRecorder gRecorder;
+static InputReplay gReplay;
+
+// Platform layer
+
+FileResult PlatformReadFile(const char *path) {
+    FileResult result = {};
+    FILE *file = fopen(path, "rb");
+    if(!file) {
+        return result;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    result.data = TrackedMalloc((size_t)size + 1, AllocTagCurrent());
+    result.size = (size_t)size;
+    if(fread(result.data, 1, result.size, file) != result.size) {
+        TrackedFree(result.data);
+        FileResult zeroResult = {};
+        fclose(file);
+        return zeroResult;
+    }
+    ((unsigned char *)result.data)[result.size] = 0;
+    fclose(file);
+    return result;
+}
+
+void PlatformFreeFile(FileResult *file) {
+    if(file->data) TrackedFree(file->data);
+    file->data = 0;
+    file->size = 0;
+}
+
+double PlatformGetSeconds() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+void PlatformGetWindowSize(int *width, int *height) {
+    *width = HEADLESS_WIDTH;
+    *height = HEADLESS_HEIGHT;
+}
+
+void PlatformSwapBuffers() {
+}
+
+bool PlatformProcessInput() {
+    // No devices, the input stays at rest
+    gInput.mMouseWheel = 0;
+    InputUpdateWasDown(&gInput, &gLastInput);
+    return true;
+}
+
+// OpenGL stubs
+
+static const GLubyte *APIENTRY StubGetString(GLenum name) {
+    if(name == GL_VERSION) return (const GLubyte *)"3.3.0 headless";
+    if(name == GL_RENDERER) return (const GLubyte *)"headless";
+    return (const GLubyte *)"";
+}
+static const GLubyte *APIENTRY StubGetStringi(GLenum name, GLuint index) {
+    return (const GLubyte *)"GL_HEADLESS_stub";
+}
+static void APIENTRY StubGetIntegerv(GLenum pname, GLint *data) {
+    *data = pname == GL_NUM_EXTENSIONS ? 1 : 0;
+}
+static void APIENTRY StubGenObjects(GLsizei n, GLuint *ids) {
+    for(GLsizei i = 0; i < n; ++i) ids[i] = gNextObjectId++;
+}
+static void APIENTRY StubDeleteObjects(GLsizei n, const GLuint *ids) { }
+static GLboolean APIENTRY StubIsObject(GLuint id) { return GL_TRUE; }
+static GLuint APIENTRY StubCreateShader(GLenum type) { return gNextObjectId++; }
+static GLuint APIENTRY StubCreateProgram() { return gNextObjectId++; }
+static void APIENTRY StubDeleteObject(GLuint id) { }
+static void APIENTRY StubShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length) { }
+static void APIENTRY StubObject(GLuint id) { }
+static void APIENTRY StubAttachShader(GLuint program, GLuint shader) { }
+static void APIENTRY StubGetObjectiv(GLuint id, GLenum pname, GLint *params) { *params = GL_TRUE; }
+static void APIENTRY StubGetInfoLog(GLuint id, GLsizei bufSize, GLsizei *length, GLchar *infoLog) {
+    if(length) *length = 0;
+    if(bufSize > 0) infoLog[0] = 0;
+}
+static GLint APIENTRY StubGetUniformLocation(GLuint program, const GLchar *name) { return 0; }
+static void APIENTRY StubUniform1i(GLint location, GLint v0) { gRenderStats.mUniformUploads++; }
+static void APIENTRY StubUniformiv(GLint location, GLsizei count, const GLint *value) { gRenderStats.mUniformUploads++; }
+static void APIENTRY StubUniformfv(GLint location, GLsizei count, const GLfloat *value) { gRenderStats.mUniformUploads++; }
+static void APIENTRY StubUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) { gRenderStats.mUniformUploads++; }
+static void APIENTRY StubBindObject(GLenum target, GLuint id) { }
+static void APIENTRY StubBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) { }
+static void APIENTRY StubEnum(GLenum value) { }
+static void APIENTRY StubFloat(GLfloat value) { }
+static void APIENTRY StubNoArgs() { }
+static void APIENTRY StubClear(GLbitfield mask) { }
+static void APIENTRY StubClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) { }
+static void APIENTRY StubViewport(GLint x, GLint y, GLsizei width, GLsizei height) { }
+static void APIENTRY StubTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                                    GLint border, GLenum format, GLenum type, const void *pixels) { }
+static void APIENTRY StubTexParameteri(GLenum target, GLenum pname, GLint param) { }
+static void APIENTRY StubVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                             GLsizei stride, const void *pointer) { }
+static void APIENTRY StubVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void *pointer) { }
+static void APIENTRY StubDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    gRenderStats.mDrawCalls++;
+    gRenderStats.mVertices += (unsigned long long)count;
+}
+static void APIENTRY StubDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices) {
+    gRenderStats.mDrawCalls++;
+    gRenderStats.mIndices += (unsigned long long)count;
+}
+
+struct GLStub {
+    const char *mName;
+    void *mProc;
+};
+
+static GLStub gGLStubs[] = {
+    { "glGetString", (void *)StubGetString },
+    { "glGetStringi", (void *)StubGetStringi },
+    { "glGetIntegerv", (void *)StubGetIntegerv },
+    { "glGenBuffers", (void *)StubGenObjects },
+    { "glGenTextures", (void *)StubGenObjects },
+    { "glGenVertexArrays", (void *)StubGenObjects },
+    { "glDeleteBuffers", (void *)StubDeleteObjects },
+    { "glDeleteTextures", (void *)StubDeleteObjects },
+    { "glDeleteVertexArrays", (void *)StubDeleteObjects },
+    { "glIsBuffer", (void *)StubIsObject },
+    { "glIsVertexArray", (void *)StubIsObject },
+    { "glCreateShader", (void *)StubCreateShader },
+    { "glCreateProgram", (void *)StubCreateProgram },
+    { "glDeleteShader", (void *)StubDeleteObject },
+    { "glDeleteProgram", (void *)StubDeleteObject },
+    { "glShaderSource", (void *)StubShaderSource },
+    { "glCompileShader", (void *)StubObject },
+    { "glLinkProgram", (void *)StubObject },
+    { "glUseProgram", (void *)StubObject },
+    { "glEnableVertexAttribArray", (void *)StubObject },
+    { "glBindVertexArray", (void *)StubObject },
+    { "glAttachShader", (void *)StubAttachShader },
+    { "glGetShaderiv", (void *)StubGetObjectiv },
+    { "glGetProgramiv", (void *)StubGetObjectiv },
+    { "glGetShaderInfoLog", (void *)StubGetInfoLog },
+    { "glGetProgramInfoLog", (void *)StubGetInfoLog },
+    { "glGetUniformLocation", (void *)StubGetUniformLocation },
+    { "glUniform1i", (void *)StubUniform1i },
+    { "glUniform1iv", (void *)StubUniformiv },
+    { "glUniform3fv", (void *)StubUniformfv },
+    { "glUniform4fv", (void *)StubUniformfv },
+    { "glUniformMatrix4fv", (void *)StubUniformMatrix4fv },
+    { "glBindBuffer", (void *)StubBindObject },
+    { "glBindTexture", (void *)StubBindObject },
+    { "glBufferData", (void *)StubBufferData },
+    { "glActiveTexture", (void *)StubEnum },
+    { "glEnable", (void *)StubEnum },
+    { "glDisable", (void *)StubEnum },
+    { "glGenerateMipmap", (void *)StubEnum },
+    { "glPointSize", (void *)StubFloat },
+    { "glFinish", (void *)StubNoArgs },
+    { "glClear", (void *)StubClear },
+    { "glClearColor", (void *)StubClearColor },
+    { "glViewport", (void *)StubViewport },
+    { "glTexImage2D", (void *)StubTexImage2D },
+    { "glTexParameteri", (void *)StubTexParameteri },
+    { "glVertexAttribPointer", (void *)StubVertexAttribPointer },
+    { "glVertexAttribIPointer", (void *)StubVertexAttribIPointer },
+    { "glDrawArrays", (void *)StubDrawArrays },
+    { "glDrawElements", (void *)StubDrawElements },
+};
+
+// Functions without a stub stay null, calling one crashes right where a stub is missing
+static void *HeadlessGetProcAddress(const char *name) {
+    for(unsigned int i = 0; i < ArrayCount(gGLStubs); ++i) {
+        if(strcmp(gGLStubs[i].mName, name) == 0) {
+            return gGLStubs[i].mProc;
+        }
+    }
+    return 0;
+}
+
+// Timing statistics
+
+static double Percentile(std::vector<double> &sorted, double p) {
+    size_t index = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+static void PrintTimings(const char *name, std::vector<double> &times) {
+    if(times.empty()) {
+        printf("%-8s no frames measured\n", name);
+        return;
+    }
+    std::sort(times.begin(), times.end());
+    double total = 0.0;
+    for(size_t i = 0; i < times.size(); ++i) {
+        total += times[i];
+    }
+    printf("%-8s min %8.3f  avg %8.3f  p50 %8.3f  p99 %8.3f  max %8.3f ms\n", name,
+           times.front() * 1000.0, total / (double)times.size() * 1000.0,
+           Percentile(times, 0.5) * 1000.0, Percentile(times, 0.99) * 1000.0, times.back() * 1000.0);
+}
+
+static void PrintUsage(const char *program) {
+    printf("usage: %s [--frames N] [--dt SECONDS] [--warmup N] [--trace FILE] [--record FILE] [--replay FILE] [--walk] [--motion-bench] [--pose-cache-bench] [--broadphase-bench]\n", program);
+}
+
+// Motion matching search cost
+
+static float Jitter() {
+    return ((float)rand() / (float)RAND_MAX - 0.5f) * 0.2f;
+}
+
+// Builds the database from the player clips, then grows it with jittered
+// copies of its rows to time both searches against the database size
+static void RunMotionBenchmark() {
+    cgltf_data *data = LoadGLTFFile("../assets/clone2/clone.gltf");
+    if(!data) {
+        return;
+    }
+    Pose restPose = LoadRestPose(data);
+    std::vector<Clip> clips = LoadClips(data);
+    int leftFoot = FindJointIndex(data, "mixamorig:LeftFoot");
+    int rightFoot = FindJointIndex(data, "mixamorig:RightFoot");
+    int hips = FindJointIndex(data, "mixamorig:Hips");
+    FreeGLTFFile(data);
+    if(restPose.Size() == 0) {
+        return;
+    }
+    if(leftFoot < 0 || rightFoot < 0 || hips < 0) {
+        printf("Motion bench: the model has no feet or hips\n");
+        return;
+    }
+
+    MotionDatabase source;
+    double buildStart = PlatformGetSeconds();
+    source.Build(clips, restPose, leftFoot, rightFoot, hips);
+    printf("Motion database: %u frames from %zu clips in %.3f ms\n", source.FrameCount(), clips.size(),
+           (PlatformGetSeconds() - buildStart) * 1000.0);
+    printf("%8s %12s %12s %10s\n", "frames", "scan us", "kd-tree us", "mismatch");
+
+    srand(1);
+    MotionDatabase database = source;
+    std::vector<float> queries(HEADLESS_MOTION_QUERIES * MOTION_FEATURE_STRIDE);
+    for(unsigned int size = 1024; size <= 262144; size *= 4) {
+        database.mFeatures.clear();
+        database.mFrames.clear();
+        for(unsigned int i = 0; i < size; ++i) {
+            unsigned int frame = i % source.FrameCount();
+            const float *row = source.GetFeatures(frame);
+            for(unsigned int k = 0; k < MOTION_FEATURE_STRIDE; ++k) {
+                database.mFeatures.push_back(k < MOTION_FEATURE_COUNT ? row[k] + Jitter() : 0.0f);
+            }
+            database.mFrames.push_back(source.mFrames[frame]);
+        }
+        database.BuildTree();
+        for(unsigned int q = 0; q < HEADLESS_MOTION_QUERIES; ++q) {
+            const float *row = source.GetFeatures((unsigned int)rand() % source.FrameCount());
+            for(unsigned int k = 0; k < MOTION_FEATURE_STRIDE; ++k) {
+                queries[q * MOTION_FEATURE_STRIDE + k] = k < MOTION_FEATURE_COUNT ? row[k] + Jitter() : 0.0f;
+            }
+        }
+
+        std::vector<float> scanDistances(HEADLESS_MOTION_QUERIES);
+        double start = PlatformGetSeconds();
+        for(unsigned int q = 0; q < HEADLESS_MOTION_QUERIES; ++q) {
+            database.Search(&queries[q * MOTION_FEATURE_STRIDE], &scanDistances[q]);
+        }
+        double scanTime = PlatformGetSeconds() - start;
+        unsigned int mismatches = 0;
+        start = PlatformGetSeconds();
+        for(unsigned int q = 0; q < HEADLESS_MOTION_QUERIES; ++q) {
+            float distance;
+            database.SearchTree(&queries[q * MOTION_FEATURE_STRIDE], &distance);
+            if(distance != scanDistances[q]) mismatches++;
+        }
+        double treeTime = PlatformGetSeconds() - start;
+        printf("%8u %12.2f %12.2f %10u\n", size, scanTime / HEADLESS_MOTION_QUERIES * 1e6,
+               treeTime / HEADLESS_MOTION_QUERIES * 1e6, mismatches);
+    }
+}
+
+// Pose cache against the demo crowd
+
+// A crowd playing the idle clip with the phases and speeds the game gives
+// its crowd, sampled and skinned per character and then through the pose cache
+static void RunPoseCacheBenchmark() {
+    cgltf_data *data = LoadGLTFFile("../assets/clone2/clone.gltf");
+    if(!data) {
+        return;
+    }
+    Pose restPose = LoadRestPose(data);
+    std::vector<Clip> clips = LoadClips(data);
+    FreeGLTFFile(data);
+    if(restPose.Size() == 0 || clips.empty()) {
+        return;
+    }
+    unsigned int clipIndex = clips.size() > 1 ? 1 : 0;
+    Clip &clip = clips[clipIndex];
+
+    printf("%10s %14s %14s %16s %10s\n", "characters", "per char ms", "cached ms", "samples / frame", "hit rate");
+    PoseCache *cache = new PoseCache();
+    // The demo crowd itself and then bigger ones
+    unsigned int counts[] = { HEADLESS_CROWD_SIZE, 256, 1024, 4096 };
+    for(unsigned int c = 0; c < ArrayCount(counts); ++c) {
+        unsigned int count = counts[c];
+        std::vector<float> times(count);
+        std::vector<float> speeds(count);
+        for(unsigned int i = 0; i < count; ++i) {
+            // Filled row by row like Game::Initialize
+            unsigned int x = i / HEADLESS_CROWD_ROWS;
+            unsigned int z = i % HEADLESS_CROWD_ROWS;
+            times[i] = clip.mStartTime + (float)(x * HEADLESS_CROWD_ROWS + z) * 0.37f;
+            speeds[i] = 0.8f + 0.05f * (float)((x + z) % 8);
+        }
+        std::vector<Pose> poses(count, restPose);
+        std::vector<std::vector<mat4> > palettes(count);
+        const float dt = 1.0f / 60.0f;
+
+        double start = PlatformGetSeconds();
+        for(unsigned int frame = 0; frame < HEADLESS_CACHE_FRAMES; ++frame) {
+            for(unsigned int i = 0; i < count; ++i) {
+                clip.Sample(poses[i], clip.AdjustTimeToFitRange(times[i] + frame * dt * speeds[i]));
+                poses[i].GetMatrixPalette(palettes[i]);
+            }
+        }
+        double plainTime = PlatformGetSeconds() - start;
+
+        cache->Initialize();
+        unsigned long long samples = 0;
+        start = PlatformGetSeconds();
+        for(unsigned int frame = 0; frame < HEADLESS_CACHE_FRAMES; ++frame) {
+            cache->BeginFrame(1);
+            for(unsigned int i = 0; i < count; ++i) {
+                float time = clip.AdjustTimeToFitRange(times[i] + frame * dt * speeds[i]);
+                unsigned int entry = cache->Acquire(clip, clipIndex, time, 0, 0, restPose);
+                if(entry) {
+                    cache->GetPalette(entry);
+                }
+                else {
+                    // A full cache leaves the character to sample its own pose
+                    clip.Sample(poses[i], time);
+                    poses[i].GetMatrixPalette(palettes[i]);
+                }
+            }
+            samples += cache->mMisses + cache->mBypasses;
+        }
+        double cachedTime = PlatformGetSeconds() - start;
+        printf("%10u %14.3f %14.3f %16.1f %9.1f%%\n", count, plainTime / HEADLESS_CACHE_FRAMES * 1000.0,
+               cachedTime / HEADLESS_CACHE_FRAMES * 1000.0, (double)samples / HEADLESS_CACHE_FRAMES,
+               cache->HitRate() * 100.0f);
+    }
+    cache->Shutdown();
+    delete cache;
+}
+
+// Character broadphases
+
+static bool BoxesOverlap(const AABB_min_max &a, const AABB_min_max &b) {
+    return a.max.x >= b.min.x && a.min.x <= b.max.x &&
+           a.max.y >= b.min.y && a.min.y <= b.max.y &&
+           a.max.z >= b.min.z && a.min.z <= b.max.z;
+}
+
+// Characters walking around a square at the density of the demo crowd, paired
+// every frame by the sweep and prune the game uses and by the spatial hash
+// rebuilt and queried with the box of each character. Both have to find the
+// same number of pairs
+static void RunBroadphaseBenchmark() {
+    // The box of a crowd character and the sphere around it the hash stores
+    vec3 localMin(-0.5f, 0.0f, -0.5f);
+    vec3 localMax(0.5f, 3.5f, 0.5f);
+    vec3 localCenter = (localMin + localMax) * 0.5f;
+    float radius = len(localMax - localCenter);
+    const float dt = 1.0f / 60.0f;
+
+    printf("%10s %12s %12s %10s %10s\n", "characters", "sap ms", "hash ms", "pairs", "mismatch");
+    srand(1);
+    for(unsigned int count = 256; count <= 4096; count *= 4) {
+        // Four square units per character, like the rows of the demo crowd
+        float half = sqrtf((float)count * 4.0f) * 0.5f;
+        std::vector<vec3> positions(count);
+        std::vector<vec3> velocities(count);
+        std::vector<AABB_min_max> boxes(count);
+        std::vector<vec3> centers(count);
+        std::vector<float> radii(count, radius);
+        std::vector<unsigned int> found(count);
+        for(unsigned int i = 0; i < count; ++i) {
+            positions[i] = vec3(((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) * half, 0.0f,
+                                ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) * half);
+            velocities[i] = vec3((float)rand() / (float)RAND_MAX * 3.0f - 1.5f, 0.0f,
+                                 (float)rand() / (float)RAND_MAX * 3.0f - 1.5f);
+        }
+
+        SweepAndPrune *sap = new SweepAndPrune();
+        std::vector<unsigned int> proxies(count);
+        SpatialHash *hash = new SpatialHash();
+        hash->Initialize(2.0f * radius);
+        double sapTime = 0.0;
+        double hashTime = 0.0;
+        unsigned long long pairs = 0;
+        unsigned int mismatches = 0;
+        for(int frame = -1; frame < HEADLESS_BROADPHASE_FRAMES; ++frame) {
+            for(unsigned int i = 0; i < count; ++i) {
+                positions[i] = positions[i] + velocities[i] * dt;
+                if(fabsf(positions[i].x) > half) velocities[i].x = -velocities[i].x;
+                if(fabsf(positions[i].z) > half) velocities[i].z = -velocities[i].z;
+                boxes[i].min = positions[i] + localMin;
+                boxes[i].max = positions[i] + localMax;
+                centers[i] = positions[i] + localCenter;
+            }
+
+            double start = PlatformGetSeconds();
+            for(unsigned int i = 0; i < count; ++i) {
+                if(frame < 0) {
+                    proxies[i] = sap->AddProxy(boxes[i], (int)i);
+                }
+                else {
+                    sap->UpdateProxy(proxies[i], boxes[i]);
+                }
+            }
+            sap->Update();
+            sap->ClearPairChanges();
+            unsigned int sapPairs = (unsigned int)sap->PairCount();
+            double sapFrame = PlatformGetSeconds() - start;
+
+            start = PlatformGetSeconds();
+            hash->Build(&centers[0], &radii[0], count);
+            unsigned int hashPairs = 0;
+            for(unsigned int i = 0; i < count; ++i) {
+                int n = hash->QueryBox(boxes[i], &found[0], (int)count);
+                for(int k = 0; k < n; ++k) {
+                    if(found[k] > i && BoxesOverlap(boxes[i], boxes[found[k]])) {
+                        hashPairs++;
+                    }
+                }
+            }
+            double hashFrame = PlatformGetSeconds() - start;
+
+            // The first frame fills the sweep and prune from scratch, it is not timed
+            if(frame >= 0) {
+                sapTime += sapFrame;
+                hashTime += hashFrame;
+                pairs += sapPairs;
+                if(sapPairs != hashPairs) mismatches++;
+            }
+        }
+        printf("%10u %12.3f %12.3f %10.1f %10u\n", count, sapTime / HEADLESS_BROADPHASE_FRAMES * 1000.0,
+               hashTime / HEADLESS_BROADPHASE_FRAMES * 1000.0, (double)pairs / HEADLESS_BROADPHASE_FRAMES, mismatches);
+        delete hash;
+        delete sap;
+    }
+}
+
+int main(int argc, char **argv) {
+    int frames = HEADLESS_DEFAULT_FRAMES;
+    int warmup = 0;
+    float dt = HEADLESS_DEFAULT_DT;
+    const char *tracePath = 0;
+    const char *recordPath = 0;
+    const char *replayPath = 0;
+    bool framesSet = false;
+    bool walk = false;
+    bool motionBench = false;
+    bool cacheBench = false;
+    bool broadphaseBench = false;
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+            framesSet = true;
+        }
+        else if(strcmp(argv[i], "--dt") == 0 && i + 1 < argc) {
+            dt = (float)atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--walk") == 0) {
+            walk = true;
+        }
+        else if(strcmp(argv[i], "--motion-bench") == 0) {
+            motionBench = true;
+        }
+        else if(strcmp(argv[i], "--pose-cache-bench") == 0) {
+            cacheBench = true;
+        }
+        else if(strcmp(argv[i], "--broadphase-bench") == 0) {
+            broadphaseBench = true;
+        }
+        else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if(replayPath) {
+        if(!gReplay.Load(replayPath)) {
+            return 1;
+        }
+        // A replay runs the whole session at the recorded dt unless told otherwise
+        if(!framesSet) {
+            frames = (int)gReplay.mFrameCount - warmup;
+        }
+        printf("Replaying %u frames from %s\n", gReplay.mFrameCount, replayPath);
+    }
+    if(frames <= 0) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    if(recordPath && !gRecorder.Begin(recordPath)) {
+        return 1;
+    }
+
+    gladLoadGLLoader(HeadlessGetProcAddress);
+    printf("OpenGL Version %d.%d (stubbed)\n", GLVersion.major, GLVersion.minor);
+
+    MemoryInitialize();
+    ProfilerInitialize();
+    ProfilerSetThreadName("main");
+    if(motionBench || cacheBench || broadphaseBench) {
+        if(motionBench) RunMotionBenchmark();
+        if(cacheBench) RunPoseCacheBenchmark();
+        if(broadphaseBench) RunBroadphaseBenchmark();
+        ProfilerShutdown();
+        MemoryShutdown();
+        return 0;
+    }
+
+    Game *game = new Game();
+    double loadStart = PlatformGetSeconds();
+    game->Initialize();
+    printf("Initialize: %.3f ms\n", (PlatformGetSeconds() - loadStart) * 1000.0);
+
+    std::vector<double> frameTimes;
+    std::vector<double> updateTimes;
+    std::vector<double> renderTimes;
+    frameTimes.reserve(frames);
+    updateTimes.reserve(frames);
+    renderTimes.reserve(frames);
+    HeadlessRenderStats measuredStats = {};
+    unsigned long long animationSamples = 0;
+
+    for(int frame = 0; frame < warmup + frames; ++frame) {
+        bool measured = frame >= warmup;
+        if(frame == warmup) {
+            gRenderStats = HeadlessRenderStats();
+            // Same rule as the windowed game, once warm no frame touches the heap
+            if(warmup > 0) AllocTrackerSetSteadyState(true);
+        }
+        PROFILE_SCOPE("Frame");
+        AllocTrackerBeginFrame();
+        double frameStart = PlatformGetSeconds();
+        PlatformProcessInput();
+        float frameDt = dt;
+        if(gReplay.IsReplaying() && !gReplay.NextFrame(&gInput, &gLastInput, &frameDt)) {
+            break;
+        }
+        if(walk && frame >= warmup + HEADLESS_WALK_DELAY) {
+            int walked = frame - warmup - HEADLESS_WALK_DELAY;
+            gInput.mKeys[KEYBOARD_KEY_W].mIsDown = true;
+            gInput.mKeys[KEYBOARD_KEY_A].mIsDown = (walked / HEADLESS_WALK_TURN) % 2 == 1;
+        }
+        gRecorder.RecordFrame(&gInput, frameDt);
+        game->Update(frameDt);
+        double updateEnd = PlatformGetSeconds();
+        game->Render();
+        PlatformSwapBuffers();
+        GetFrameArena()->EndFrame();
+        double frameEnd = PlatformGetSeconds();
+        AllocTrackerEndFrame();
+        gLastInput = gInput;
+
+        if(measured) {
+            frameTimes.push_back(frameEnd - frameStart);
+            updateTimes.push_back(updateEnd - frameStart);
+            renderTimes.push_back(frameEnd - updateEnd);
+            animationSamples += game->mAnimationLod.mSampledCount;
+        }
+    }
+    measuredStats = gRenderStats;
+    AllocTrackerSetSteadyState(false);
+    gRecorder.End();
+    gReplay.Shutdown();
+
+    // A replay that ends early measures fewer frames
+    frames = std::max((int)frameTimes.size(), 1);
+    if(replayPath) {
+        printf("%d frames at the recorded dt (%d warm up)\n", (int)frameTimes.size(), warmup);
+    }
+    else {
+        printf("%d frames at dt %.4f (%d warm up)\n", (int)frameTimes.size(), dt, warmup);
+    }
+    PrintTimings("frame", frameTimes);
+    PrintTimings("update", updateTimes);
+    PrintTimings("render", renderTimes);
+    printf("per frame: %.1f draw calls, %.0f indices, %.0f vertices, %.1f uniform uploads\n",
+           (double)measuredStats.mDrawCalls / frames, (double)measuredStats.mIndices / frames,
+           (double)measuredStats.mVertices / frames, (double)measuredStats.mUniformUploads / frames);
+    const unsigned int *levels = game->mAnimationLod.mLevelCounts;
+    printf("animation lod: %.1f characters sampled per frame, last frame %u / %u / %u by level and %u culled\n",
+           (double)animationSamples / frames, levels[0], levels[1], levels[2], levels[ANIMATION_LOD_CULLED]);
+    PoseCache *cache = &game->mWorld.mPoseCache;
+    printf("pose cache: %.1f%% hits, %llu hits %llu misses %llu bypassed\n", cache->HitRate() * 100.0f,
+           cache->mTotalHits, cache->mTotalMisses, cache->mTotalBypasses);
+    // Runs of the same replay have to end in the same place, on every build
+    vec3 player = game->mCloneTransform.mPosition;
+    printf("player at (%.4f, %.4f, %.4f)\n", player.x, player.y, player.z);
+    printf("snapshot ring: %u snapshots in %zu bytes (%zu bytes each uncompressed)\n",
+           game->mSnapshots.Count(), game->mSnapshots.BytesUsed(), sizeof(GameSnapshot));
+
+    game->Shutdown();
+    delete game;
+    if(tracePath && !ProfilerWriteChromeTrace(tracePath)) {
+        printf("No trace written, this build has no profiler\n");
+    }
+    ProfilerShutdown();
+    MemoryShutdown();
+    AllocTrackerReport();
+    return 0;
+}
+
+#endif
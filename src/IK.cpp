@@ -0,0 +1,168 @@
+#include "IK.h"
+#include "Arena.h"
+#include "Profiler.h"
+
+#include <cmath>
+
+#define IK_EPSILON 0.0001f
+
+// Sets the model space rotation of joint, its children follow
+static void SetGlobalRotation(Pose &pose, unsigned int joint, const quat &rotation) {
+    Transform local = pose.GetLocalTransform(joint);
+    int parent = pose.GetParent(joint);
+    quat parentRotation = parent >= 0 ? pose.GetGlobalTransform(parent).mRotation : quat();
+    local.mRotation = normalized(rotation * inverse(parentRotation));
+    pose.SetLocalTransform(joint, local);
+}
+
+bool SolveTwoBoneIK(Pose &pose, unsigned int root, unsigned int mid, unsigned int end,
+                    const vec3 &target, const vec3 &pole, float weight) {
+    Transform rootGlobal = pose.GetGlobalTransform(root);
+    Transform midGlobal = pose.GetGlobalTransform(mid);
+    Transform endGlobal = pose.GetGlobalTransform(end);
+    vec3 a = rootGlobal.mPosition;
+    vec3 b = midGlobal.mPosition;
+    vec3 c = endGlobal.mPosition;
+    float upper = len(b - a);
+    float lower = len(c - b);
+    if(upper < IK_EPSILON || lower < IK_EPSILON) {
+        return false;
+    }
+
+    vec3 toTarget = lerp(c, target, weight) - a;
+    float distance = len(toTarget);
+    if(distance < IK_EPSILON) {
+        return false;
+    }
+    vec3 direction = toTarget * (1.0f / distance);
+    // Never fully straight or folded, the bend direction stays defined
+    distance = fminf(fmaxf(distance, fabsf(upper - lower) + IK_EPSILON), upper + lower - IK_EPSILON);
+
+    // The mid joint goes on the side of the pole, in the plane through the target
+    vec3 toPole = pole - a;
+    vec3 bend = toPole - direction * dot(toPole, direction);
+    if(lenSq(bend) < IK_EPSILON * IK_EPSILON) {
+        return false;
+    }
+    bend = normalized(bend);
+
+    // Law of cosines gives the angle at the root between the upper bone and the target
+    float cosRoot = (upper * upper + distance * distance - lower * lower) / (2.0f * upper * distance);
+    cosRoot = fminf(fmaxf(cosRoot, -1.0f), 1.0f);
+    float sinRoot = sqrtf(1.0f - cosRoot * cosRoot);
+    vec3 midTarget = a + direction * (upper * cosRoot) + bend * (upper * sinRoot);
+    vec3 endTarget = a + direction * distance;
+
+    SetGlobalRotation(pose, root, rootGlobal.mRotation * fromTo(b - a, midTarget - a));
+    // The root moved the mid joint, the lower bone is aimed from where it is now
+    midGlobal = pose.GetGlobalTransform(mid);
+    c = pose.GetGlobalTransform(end).mPosition;
+    SetGlobalRotation(pose, mid, midGlobal.mRotation * fromTo(c - midGlobal.mPosition, endTarget - midGlobal.mPosition));
+    SetGlobalRotation(pose, end, endGlobal.mRotation);
+    return true;
+}
+
+bool FootIKRig::Initialize(cgltf_data *data) {
+    int hips = FindJointIndex(data, "mixamorig:Hips");
+    const char *names[2][3] = {
+        { "mixamorig:LeftUpLeg", "mixamorig:LeftLeg", "mixamorig:LeftFoot" },
+        { "mixamorig:RightUpLeg", "mixamorig:RightLeg", "mixamorig:RightFoot" }
+    };
+    int joints[2][3];
+    for(unsigned int i = 0; i < 2; ++i) {
+        for(unsigned int j = 0; j < 3; ++j) {
+            joints[i][j] = FindJointIndex(data, names[i][j]);
+            if(joints[i][j] < 0) {
+                hips = -1;
+            }
+        }
+    }
+    mProbeHeight = 1.0f;
+    mMaxDrop = 0.75f;
+    mMinNormalY = 0.7f;
+    mHips = hips;
+    if(hips < 0) {
+        return false;
+    }
+    for(unsigned int i = 0; i < 2; ++i) {
+        mLegs[i].mUpper = (unsigned int)joints[i][0];
+        mLegs[i].mLower = (unsigned int)joints[i][1];
+        mLegs[i].mFoot = (unsigned int)joints[i][2];
+    }
+    return true;
+}
+
+void SolveFootPlacement(RaycastWorld *world, const FootIKRig &rig, FootPlacement *characters, unsigned int count) {
+    PROFILE_FUNCTION();
+    if(rig.mHips < 0 || !count) {
+        return;
+    }
+    ScratchScope scratch;
+    unsigned int rayCount = count * 2;
+    Ray *rays = scratch.mArena->PushArray<Ray>(rayCount);
+    RayHit *hits = scratch.mArena->PushArray<RayHit>(rayCount);
+    vec3 *feet = scratch.mArena->PushArray<vec3>(rayCount);
+    for(unsigned int i = 0; i < count; ++i) {
+        FootPlacement *character = &characters[i];
+        for(unsigned int leg = 0; leg < 2; ++leg) {
+            unsigned int ray = i * 2 + leg;
+            vec3 foot = character->mPose->GetGlobalTransform(rig.mLegs[leg].mFoot).mPosition;
+            feet[ray] = transformPoint(character->mModel, foot);
+            rays[ray] = MakeRay(feet[ray] + vec3(0, rig.mProbeHeight, 0), vec3(0, -1, 0), rig.mProbeHeight + rig.mMaxDrop);
+        }
+    }
+    // Small crowds stay on this thread, the batch only wakes the workers for big ones
+    world->RaycastBatch(rays, hits, (int)rayCount, 0);
+
+    for(unsigned int i = 0; i < count; ++i) {
+        FootPlacement *character = &characters[i];
+        Pose &pose = *character->mPose;
+        RayHit *legHits = &hits[i * 2];
+        if(character->mWeight <= 0.0f || (!legHits[0].mHit && !legHits[1].mHit)) {
+            continue;
+        }
+        // Height of the ground under each foot above the floor the character stands on
+        float offsets[2] = { 0.0f, 0.0f };
+        float hipOffset = 0.0f;
+        for(unsigned int leg = 0; leg < 2; ++leg) {
+            if(legHits[leg].mHit) {
+                offsets[leg] = fmaxf(legHits[leg].mPoint.y - character->mModel.mPosition.y, -rig.mMaxDrop);
+                hipOffset = fminf(hipOffset, offsets[leg]);
+            }
+        }
+
+        Transform invModel = inverse(character->mModel);
+        if(hipOffset < 0.0f) {
+            int parent = pose.GetParent((unsigned int)rig.mHips);
+            Transform invParent = parent >= 0 ? inverse(pose.GetGlobalTransform(parent)) : Transform();
+            vec3 drop = transformVector(invModel, vec3(0, hipOffset * character->mWeight, 0));
+            Transform hips = pose.GetLocalTransform((unsigned int)rig.mHips);
+            hips.mPosition = hips.mPosition + transformVector(invParent, drop);
+            pose.SetLocalTransform((unsigned int)rig.mHips, hips);
+        }
+
+        for(unsigned int leg = 0; leg < 2; ++leg) {
+            if(!legHits[leg].mHit) {
+                continue;
+            }
+            const FootIKLeg &joints = rig.mLegs[leg];
+            vec3 target = transformPoint(invModel, feet[i * 2 + leg] + vec3(0, offsets[leg], 0));
+            // The knee bends the way it already does, pushed forward when the leg is straight
+            vec3 hip = pose.GetGlobalTransform(joints.mUpper).mPosition;
+            vec3 knee = pose.GetGlobalTransform(joints.mLower).mPosition;
+            vec3 pole = knee + vec3(0, 0, len(knee - hip));
+            if(!SolveTwoBoneIK(pose, joints.mUpper, joints.mLower, joints.mFoot, target, pole, character->mWeight)) {
+                continue;
+            }
+            vec3 normal = legHits[leg].mNormal;
+            if(normal.y < rig.mMinNormalY) {
+                continue;
+            }
+            // Flat ground leaves the animated foot as it is
+            quat tilt = nlerp(quat(), fromTo(transformVector(invModel, vec3(0, 1, 0)),
+                                             transformVector(invModel, normal)), character->mWeight);
+            Transform foot = pose.GetGlobalTransform(joints.mFoot);
+            SetGlobalRotation(pose, joints.mFoot, foot.mRotation * tilt);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef _IK_H_
+#define _IK_H_
+
+#include <cgltf.h>
+#include "Pose.h"
+#include "Raycast.h"
+
+// Moves the chain root -> mid -> end so end reaches target, everything in
+// model space. The knee or elbow bends toward pole. Only the local rotations
+// of root and mid change, end keeps its model space rotation. Targets out of
+// reach are clamped to the straightened chain. Returns false for a chain
+// with no length or a pole on the line to the target
+bool SolveTwoBoneIK(Pose &pose, unsigned int root, unsigned int mid, unsigned int end,
+                    const vec3 &target, const vec3 &pole, float weight);
+
+#define FOOT_IK_LEFT 0
+#define FOOT_IK_RIGHT 1
+
+struct FootIKLeg {
+    unsigned int mUpper;
+    unsigned int mLower;
+    unsigned int mFoot;
+};
+
+// Joints the foot placement works on, mHips is -1 until Initialize finds them
+struct FootIKRig {
+    int mHips;
+    FootIKLeg mLegs[2];
+    // The probes start this far above the animated feet
+    float mProbeHeight;
+    // Lowest the hips go, and the ground a foot reaches down to
+    float mMaxDrop;
+    // Steeper ground than this is not used to tilt the feet (cosine of the slope)
+    float mMinNormalY;
+
+    // Looks the joints up by their Mixamo names
+    bool Initialize(cgltf_data *data);
+};
+
+// One character to solve, mModel is the transform the pose is drawn with
+struct FootPlacement {
+    Pose *mPose;
+    Transform mModel;
+    float mWeight;
+};
+
+// Feet of every character are probed down against the world in a single
+// RaycastBatch. The hips drop to the lowest ground found under a foot, then
+// each leg is solved so its foot keeps the animated height above the ground
+// right under it and tilts to the ground normal
+void SolveFootPlacement(RaycastWorld *world, const FootIKRig &rig, FootPlacement *characters, unsigned int count);
+
+#endif
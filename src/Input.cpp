@@ -0,0 +1,118 @@
+#include "Input.h"
+#include "Defines.h"
+
+Input gInput;
+Input gLastInput;
+
+void InputUpdateWasDown(Input *input, Input *lastInput) {
+    for(int i = 0; i < (int)ArrayCount(input->mKeys); ++i) {
+        input->mKeys[i].mWasDown = lastInput->mKeys[i].mIsDown;
+    }
+    for(int i = 0; i < (int)ArrayCount(input->mMouseButtons); ++i) {
+        input->mMouseButtons[i].mWasDown = lastInput->mMouseButtons[i].mIsDown;
+    }
+    for(int i = 0; i < (int)ArrayCount(input->mJoyButtons); ++i) {
+        input->mJoyButtons[i].mWasDown = lastInput->mJoyButtons[i].mIsDown;
+    }
+}
+
+bool KeyboardGetKeyDown(int key) {
+    return gInput.mKeys[key].mIsDown;
+}
+
+bool KeyboardGetKeyJustDown(int key) {
+    if(gInput.mKeys[key].mIsDown != gInput.mKeys[key].mWasDown) {
+        return gInput.mKeys[key].mIsDown; 
+    }
+    return false;
+}
+
+bool KeyboardGetKeyJustUp(int key) {
+    if(gInput.mKeys[key].mIsDown != gInput.mKeys[key].mWasDown) {
+        return gInput.mKeys[key].mWasDown; 
+    }
+    return false;
+}
+
+bool KeyboardGetKeyUp(int key) {
+    return !gInput.mKeys[key].mIsDown;
+}
+
+bool MouseGetButtonDown(int button) {
+    return gInput.mMouseButtons[button].mIsDown;
+}
+
+bool MouseGetButtonJustDown(int button) {
+    if(gInput.mMouseButtons[button].mIsDown != gInput.mMouseButtons[button].mWasDown) {
+        return gInput.mMouseButtons[button].mIsDown; 
+    }
+    return false;
+}
+
+bool MouseGetButtonJustUp(int button) {
+    if(gInput.mMouseButtons[button].mIsDown != gInput.mMouseButtons[button].mWasDown) {
+        return gInput.mMouseButtons[button].mWasDown; 
+    }
+    return false;
+}
+
+bool MouseGetButtonUp(int button) {
+    return !gInput.mMouseButtons[button].mIsDown;
+}
+
+int MouseGetCursorX() {
+    return gInput.mMouseX;
+}
+int MouseGetCursorY() {
+    return gInput.mMouseY;
+}
+
+int MouseGetWheel() {
+    return gInput.mMouseWheel;
+}
+
+int MouseGetLastCursorX() {
+    return gLastInput.mMouseX;
+}
+
+int MouseGetLastCursorY() {
+    return gLastInput.mMouseY;
+}
+
+bool JoysickGetButtonDown(int button) {
+    return gInput.mJoyButtons[button].mIsDown;
+}
+
+bool JoysickGetButtonJustDown(int button) {
+    if(gInput.mJoyButtons[button].mIsDown != gInput.mJoyButtons[button].mWasDown) {
+        return gInput.mJoyButtons[button].mIsDown; 
+    }
+    return false;
+}
+
+bool JoysickGetButtonJustUp(int button) {
+    if(gInput.mJoyButtons[button].mIsDown != gInput.mJoyButtons[button].mWasDown) {
+        return gInput.mJoyButtons[button].mWasDown; 
+    }
+    return false;
+}
+
+bool JoysickGetButtonUp(int button) {
+    return !gInput.mJoyButtons[button].mIsDown;
+}
+
+float JoysickGetLeftStickX() {
+    return gInput.mLeftStickX;
+}
+
+float JoysickGetLeftStickY() {
+    return gInput.mLeftStickY;
+}
+
+float JoysickGetRightStickX() {
+    return gInput.mRightStickX;
+}
+
+float JoysickGetRightStickY() {
+    return gInput.mRightStickY;
+}
@@ -119,6 +119,13 @@ struct Input {
     };
 };
 
+// Written by the platform layer every frame, gLastInput holds the previous frame
+extern Input gInput;
+extern Input gLastInput;
+
+// Copies the down state of the last frame into mWasDown
+void InputUpdateWasDown(Input *input, Input *lastInput);
+
 bool KeyboardGetKeyDown(int key);
 bool KeyboardGetKeyJustDown(int key);
 bool KeyboardGetKeyJustUp(int key);
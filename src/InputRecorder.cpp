@@ -0,0 +1,210 @@
+#include "InputRecorder.h"
+
+#include <string.h>
+
+#define INPUT_CHANGED_KEYS    (1 << 0)
+#define INPUT_CHANGED_BUTTONS (1 << 1)
+#define INPUT_CHANGED_MOUSE   (1 << 2)
+#define INPUT_CHANGED_WHEEL   (1 << 3)
+#define INPUT_CHANGED_STICKS  (1 << 4)
+
+// Key changes are stored as the key index with the new state in the top bit
+#define INPUT_KEY_DOWN_BIT 0x8000
+
+static unsigned short PackButtons(const Input *input) {
+    unsigned short buttons = 0;
+    for(int i = 0; i < (int)ArrayCount(input->mJoyButtons); ++i) {
+        if(input->mJoyButtons[i].mIsDown) buttons |= (unsigned short)(1 << i);
+    }
+    for(int i = 0; i < (int)ArrayCount(input->mMouseButtons); ++i) {
+        if(input->mMouseButtons[i].mIsDown) buttons |= (unsigned short)(1 << (ArrayCount(input->mJoyButtons) + i));
+    }
+    return buttons;
+}
+
+static void UnpackButtons(Input *input, unsigned short buttons) {
+    for(int i = 0; i < (int)ArrayCount(input->mJoyButtons); ++i) {
+        input->mJoyButtons[i].mIsDown = (buttons & (1 << i)) != 0;
+    }
+    for(int i = 0; i < (int)ArrayCount(input->mMouseButtons); ++i) {
+        input->mMouseButtons[i].mIsDown = (buttons & (1 << (ArrayCount(input->mJoyButtons) + i))) != 0;
+    }
+}
+
+bool InputRecorder::Begin(const char *path) {
+    mFile = fopen(path, "wb");
+    if(!mFile) {
+        printf("Input recorder: cannot open %s\n", path);
+        return false;
+    }
+    mUsed = 0;
+    mFrameCount = 0;
+    memset(&mPrevious, 0, sizeof(Input));
+    InputRecordHeader header = {};
+    header.mMagic = INPUT_RECORD_MAGIC;
+    header.mVersion = INPUT_RECORD_VERSION;
+    Write(&header, sizeof(header));
+    return true;
+}
+
+void InputRecorder::RecordFrame(const Input *input, float dt) {
+    if(!mFile) {
+        return;
+    }
+    unsigned short keyChanges = 0;
+    for(int i = 0; i < (int)ArrayCount(input->mKeys); ++i) {
+        if(input->mKeys[i].mIsDown != mPrevious.mKeys[i].mIsDown) keyChanges++;
+    }
+    unsigned short buttons = PackButtons(input);
+    unsigned char changed = 0;
+    if(keyChanges) changed |= INPUT_CHANGED_KEYS;
+    if(buttons != PackButtons(&mPrevious)) changed |= INPUT_CHANGED_BUTTONS;
+    if(input->mMouseX != mPrevious.mMouseX || input->mMouseY != mPrevious.mMouseY) changed |= INPUT_CHANGED_MOUSE;
+    if(input->mMouseWheel != mPrevious.mMouseWheel) changed |= INPUT_CHANGED_WHEEL;
+    if(input->mLeftStickX != mPrevious.mLeftStickX || input->mLeftStickY != mPrevious.mLeftStickY ||
+       input->mRightStickX != mPrevious.mRightStickX || input->mRightStickY != mPrevious.mRightStickY) {
+        changed |= INPUT_CHANGED_STICKS;
+    }
+
+    Write(&dt, sizeof(dt));
+    Write(&changed, sizeof(changed));
+    if(changed & INPUT_CHANGED_KEYS) {
+        Write(&keyChanges, sizeof(keyChanges));
+        for(int i = 0; i < (int)ArrayCount(input->mKeys); ++i) {
+            if(input->mKeys[i].mIsDown != mPrevious.mKeys[i].mIsDown) {
+                unsigned short key = (unsigned short)i;
+                if(input->mKeys[i].mIsDown) key |= INPUT_KEY_DOWN_BIT;
+                Write(&key, sizeof(key));
+            }
+        }
+    }
+    if(changed & INPUT_CHANGED_BUTTONS) {
+        Write(&buttons, sizeof(buttons));
+    }
+    if(changed & INPUT_CHANGED_MOUSE) {
+        Write(&input->mMouseX, sizeof(input->mMouseX));
+        Write(&input->mMouseY, sizeof(input->mMouseY));
+    }
+    if(changed & INPUT_CHANGED_WHEEL) {
+        Write(&input->mMouseWheel, sizeof(input->mMouseWheel));
+    }
+    if(changed & INPUT_CHANGED_STICKS) {
+        Write(&input->mLeftStickX, sizeof(float));
+        Write(&input->mLeftStickY, sizeof(float));
+        Write(&input->mRightStickX, sizeof(float));
+        Write(&input->mRightStickY, sizeof(float));
+    }
+    mPrevious = *input;
+    mFrameCount++;
+}
+
+void InputRecorder::End() {
+    if(!mFile) {
+        return;
+    }
+    Flush();
+    // Patch the frame count into the header
+    InputRecordHeader header = {};
+    header.mMagic = INPUT_RECORD_MAGIC;
+    header.mVersion = INPUT_RECORD_VERSION;
+    header.mFrameCount = mFrameCount;
+    fseek(mFile, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, mFile);
+    fclose(mFile);
+    mFile = 0;
+    printf("Input recorder: %u frames recorded\n", mFrameCount);
+}
+
+void InputRecorder::Write(const void *data, unsigned int size) {
+    if(mUsed + size > INPUT_RECORD_BUFFER_SIZE) {
+        Flush();
+    }
+    memcpy(mBuffer + mUsed, data, size);
+    mUsed += size;
+}
+
+void InputRecorder::Flush() {
+    if(mUsed) {
+        fwrite(mBuffer, 1, mUsed, mFile);
+        mUsed = 0;
+    }
+}
+
+bool InputReplay::Load(const char *path) {
+    mFile = PlatformReadFile(path);
+    if(!mFile.data) {
+        printf("Input replay: cannot read %s\n", path);
+        return false;
+    }
+    mCursor = 0;
+    mFrame = 0;
+    memset(&mState, 0, sizeof(Input));
+    InputRecordHeader header;
+    if(!Read(&header, sizeof(header)) ||
+       header.mMagic != INPUT_RECORD_MAGIC || header.mVersion != INPUT_RECORD_VERSION) {
+        printf("Input replay: %s is not an input recording\n", path);
+        Shutdown();
+        return false;
+    }
+    mFrameCount = header.mFrameCount;
+    return true;
+}
+
+bool InputReplay::NextFrame(Input *input, Input *lastInput, float *dt) {
+    if(!mFile.data || mFrame >= mFrameCount) {
+        return false;
+    }
+    unsigned char changed = 0;
+    if(!Read(dt, sizeof(float)) || !Read(&changed, sizeof(changed))) {
+        return false;
+    }
+    if(changed & INPUT_CHANGED_KEYS) {
+        unsigned short keyChanges = 0;
+        if(!Read(&keyChanges, sizeof(keyChanges))) return false;
+        for(unsigned int i = 0; i < keyChanges; ++i) {
+            unsigned short key = 0;
+            if(!Read(&key, sizeof(key))) return false;
+            unsigned int index = key & ~INPUT_KEY_DOWN_BIT;
+            if(index >= ArrayCount(mState.mKeys)) return false;
+            mState.mKeys[index].mIsDown = (key & INPUT_KEY_DOWN_BIT) != 0;
+        }
+    }
+    if(changed & INPUT_CHANGED_BUTTONS) {
+        unsigned short buttons = 0;
+        if(!Read(&buttons, sizeof(buttons))) return false;
+        UnpackButtons(&mState, buttons);
+    }
+    if(changed & INPUT_CHANGED_MOUSE) {
+        if(!Read(&mState.mMouseX, sizeof(int)) || !Read(&mState.mMouseY, sizeof(int))) return false;
+    }
+    if(changed & INPUT_CHANGED_WHEEL) {
+        if(!Read(&mState.mMouseWheel, sizeof(int))) return false;
+    }
+    if(changed & INPUT_CHANGED_STICKS) {
+        if(!Read(&mState.mLeftStickX, sizeof(float)) || !Read(&mState.mLeftStickY, sizeof(float)) ||
+           !Read(&mState.mRightStickX, sizeof(float)) || !Read(&mState.mRightStickY, sizeof(float))) {
+            return false;
+        }
+    }
+    *input = mState;
+    InputUpdateWasDown(input, lastInput);
+    mFrame++;
+    return true;
+}
+
+void InputReplay::Shutdown() {
+    PlatformFreeFile(&mFile);
+    mCursor = 0;
+    mFrameCount = 0;
+    mFrame = 0;
+}
+
+bool InputReplay::Read(void *data, unsigned int size) {
+    if(mCursor + size > mFile.size) {
+        printf("Input replay: recording truncated at frame %u\n", mFrame);
+        return false;
+    }
+    memcpy(data, (unsigned char *)mFile.data + mCursor, size);
+    mCursor += size;
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef _INPUTRECORDER_H_
+#define _INPUTRECORDER_H_
+
+#include <stdio.h>
+
+#include "Input.h"
+#include "Defines.h"
+#include "Platform.h"
+
+// Per frame input and dt captured to a binary file and fed back through
+// gInput, so a gameplay session can be re-run exactly on another build.
+// A frame stores its dt, a byte with the sections that changed since the
+// previous frame and then only those sections. Idle frames take 5 bytes
+
+#define INPUT_RECORD_MAGIC 0x52504E49 // "INPR"
+#define INPUT_RECORD_VERSION 1
+#define INPUT_RECORD_BUFFER_SIZE Kilobyte(64)
+
+struct InputRecordHeader {
+    unsigned int mMagic;
+    unsigned int mVersion;
+    unsigned int mFrameCount;
+    unsigned int mReserved;
+};
+
+// Streams to the file through a fixed buffer, recording never allocates
+struct InputRecorder {
+    FILE *mFile;
+    unsigned char mBuffer[INPUT_RECORD_BUFFER_SIZE];
+    unsigned int mUsed;
+    unsigned int mFrameCount;
+    Input mPrevious;
+
+    bool Begin(const char *path);
+    // Call after the platform layer filled the input for the frame
+    void RecordFrame(const Input *input, float dt);
+    void End();
+    bool IsRecording() { return mFile != 0; }
+
+private:
+    void Write(const void *data, unsigned int size);
+    void Flush();
+};
+
+struct InputReplay {
+    FileResult mFile;
+    size_t mCursor;
+    unsigned int mFrameCount;
+    unsigned int mFrame;
+    Input mState;
+
+    bool Load(const char *path);
+    // Overwrites the input with the next recorded frame and its mWasDown
+    // state from lastInput. Returns false once the recording is over
+    bool NextFrame(Input *input, Input *lastInput, float *dt);
+    void Shutdown();
+    bool IsReplaying() { return mFile.data != 0; }
+
+private:
+    bool Read(void *data, unsigned int size);
+};
+
+#endif
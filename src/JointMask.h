@@ -0,0 +1,53 @@
+#ifndef _JOINTMASK_H_
+#define _JOINTMASK_H_
+
+#include "PosePool.h"
+
+static_assert(POSE_MAX_JOINTS <= 64, "JointMask holds one bit per joint in 64 bits");
+
+// One bit per skeleton joint, limits sampling and blending to part of the
+// body (upper body, lower body) so a layer only touches the joints it owns
+struct JointMask {
+    unsigned long long mBits;
+
+    JointMask() : mBits(0) { }
+
+    void Set(unsigned int joint) {
+        mBits |= 1ull << joint;
+    }
+
+    void Clear(unsigned int joint) {
+        mBits &= ~(1ull << joint);
+    }
+
+    bool IsSet(unsigned int joint) const {
+        return (mBits >> joint) & 1ull;
+    }
+
+    bool IsEmpty() const {
+        return mBits == 0;
+    }
+
+    // Lowest and highest joint in the mask, only valid when it is not empty
+    unsigned int First() const {
+        unsigned int joint = 0;
+        while(!IsSet(joint)) joint++;
+        return joint;
+    }
+
+    unsigned int Last() const {
+        unsigned int joint = 63;
+        while(!IsSet(joint)) joint--;
+        return joint;
+    }
+
+    // The joints of a skeleton with jointCount joints that are not in the mask
+    JointMask Inverted(unsigned int jointCount) const {
+        JointMask result;
+        unsigned long long all = jointCount >= 64 ? ~0ull : (1ull << jointCount) - 1;
+        result.mBits = ~mBits & all;
+        return result;
+    }
+};
+
+#endif
@@ -1,20 +1,14 @@
 #ifndef _MAT4_H_
 #define _MAT4_H_
 
-#include "vec4.h"
-#include "vec3.h"
+#include "Vec4.h"
+#include "Vec3.h"
 
 #define MAT4_EPSILON 0.000001f
 
 struct mat4 {
     union {
         float v[16];
-        struct {
-            vec4 right;
-            vec4 up;
-            vec4 forward;
-            vec4 position;
-        };
 		struct {
 			//            row 1     row 2     row 3     row 4
 			/* column 1 */float xx; float xy; float xz; float xw;
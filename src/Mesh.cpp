@@ -1,16 +1,20 @@
 #include "Mesh.h"
 #include <glad/glad.h>
 #include <stdio.h>
+#include <string.h>
 #include <iostream>
 #include <algorithm>
 #include <cgltf.h>
 #include <memory>
 #include <vector>
 
+#include "AllocTracker.h"
 #include "Vec3.h"
 #include "Vec2.h"
 #include "Vec4.h"
 #include "Transform.h"
+#include "Mat4.h"
+#include "Profiler.h"
 
 #define ArrayCount(array) (sizeof(array)/sizeof((array)[0]))
 
@@ -28,9 +32,20 @@ struct AnimVertex {
     ivec4 mJoints;
 };
 
+static void *GLTFAlloc(void *user, cgltf_size size) {
+    return TrackedMalloc(size, ALLOC_TAG_MESH);
+}
+
+static void GLTFFree(void *user, void *ptr) {
+    TrackedFree(ptr);
+}
+
 cgltf_data *LoadGLTFFile(const char *path) {
+    PROFILE_FUNCTION();
     cgltf_options options;
     memset(&options, 0, sizeof(cgltf_options));
+    options.memory.alloc_func = GLTFAlloc;
+    options.memory.free_func = GLTFFree;
     cgltf_data *data = NULL;
     cgltf_result result = cgltf_parse_file(&options, path, &data);
     if(result != cgltf_result_success) {
@@ -73,7 +88,64 @@ static int GetNodeIndex(cgltf_node *target, cgltf_node *nodes, unsigned int node
     return -1;
 }
 
+template <typename Vertex>
+static BoundingVolume ComputeVerticesBoundingVolume(Vertex *vertices, unsigned int count) {
+    std::vector<vec3> points(count);
+    for(unsigned int i = 0; i < count; ++i) {
+        points[i] = vertices[i].mPosition;
+    }
+    return ComputeBoundingVolume(points.empty() ? 0 : &points[0], (int)count);
+}
+
+// Group every vertex with the joint that influences it the most and fit a
+// bounding volume to each group in the bind space of that joint
+static void ComputeJointBoundingVolumes(std::vector<BoundingVolume> &out, std::vector<AnimVertex> &vertices,
+                                        cgltf_data *data) {
+    unsigned int nodeCount = (unsigned int)data->nodes_count;
+    std::vector<mat4> invBindPose(nodeCount);
+    for(unsigned int i = 0; i < (unsigned int)data->skins_count; ++i) {
+        cgltf_skin *skin = &data->skins[i];
+        if(skin->inverse_bind_matrices == 0) {
+            continue;
+        }
+        for(cgltf_size j = 0; j < skin->joints_count; ++j) {
+            int jointIndex = GetNodeIndex(skin->joints[j], data->nodes, nodeCount);
+            if(jointIndex < 0) {
+                continue;
+            }
+            cgltf_accessor_read_float(skin->inverse_bind_matrices, j, invBindPose[jointIndex].v, 16);
+        }
+    }
+
+    std::vector<std::vector<vec3> > jointPoints(nodeCount);
+    unsigned int vertexCount = (unsigned int)vertices.size();
+    for(unsigned int i = 0; i < vertexCount; ++i) {
+        AnimVertex *vertex = &vertices[i];
+        int dominant = 0;
+        for(int k = 1; k < 4; ++k) {
+            if(vertex->mWeights.v[k] > vertex->mWeights.v[dominant]) {
+                dominant = k;
+            }
+        }
+        unsigned int joint = (unsigned int)vertex->mJoints.v[dominant];
+        if(joint < nodeCount) {
+            jointPoints[joint].push_back(transformPoint(invBindPose[joint], vertex->mPosition));
+        }
+    }
+
+    out.resize(nodeCount);
+    for(unsigned int i = 0; i < nodeCount; ++i) {
+        if(jointPoints[i].empty()) {
+            out[i] = BoundingVolume();
+            continue;
+        }
+        out[i] = ComputeBoundingVolume(&jointPoints[i][0], (int)jointPoints[i].size());
+    }
+}
+
 void Mesh::InitializeStatic(cgltf_data *data) {
+    PROFILE_SCOPE("Mesh::InitializeStatic");
+    AllocTagScope tag(ALLOC_TAG_MESH);
     std::vector<StaticVertex> vertices;
     vertices.resize(data->accessors[0].count);
 
@@ -140,6 +212,9 @@ void Mesh::InitializeStatic(cgltf_data *data) {
     mVerticesCount = (int)vertices.size();
     mIndicesCount = (int)indices.size();
 
+    mBounds.mMesh = ComputeVerticesBoundingVolume(vertices.empty() ? 0 : &vertices[0], mVerticesCount);
+    mBounds.mJoints.clear();
+
     glGenVertexArrays(1, &mVao);
     glGenBuffers(1, &mVbo);
     glGenBuffers(1, &mEbo);
@@ -167,6 +242,8 @@ void Mesh::InitializeStatic(cgltf_data *data) {
 }
 
 void Mesh::InitializeAnimated(cgltf_data *data) { 
+    PROFILE_SCOPE("Mesh::InitializeAnimated");
+    AllocTagScope tag(ALLOC_TAG_MESH);
     std::vector<AnimVertex> vertices;
     vertices.resize(data->accessors[0].count);
 
@@ -257,6 +334,9 @@ void Mesh::InitializeAnimated(cgltf_data *data) {
     mVerticesCount = (int)vertices.size();
     mIndicesCount = (int)indices.size();
 
+    mBounds.mMesh = ComputeVerticesBoundingVolume(vertices.empty() ? 0 : &vertices[0], mVerticesCount);
+    ComputeJointBoundingVolumes(mBounds.mJoints, vertices, data);
+
     glGenVertexArrays(1, &mVao);
     glGenBuffers(1, &mVbo);
     glGenBuffers(1, &mEbo);
@@ -286,6 +366,7 @@ void Mesh::InitializeAnimated(cgltf_data *data) {
 }
 
 void Mesh::InitializeCube() {
+    AllocTagScope tag(ALLOC_TAG_MESH);
     StaticVertex vertices[] = {
         {{-0.5f, -0.5f, -0.5f}, {0.0f,  0.0f, -1.0f}, {0.0f, 0.0f}},
         {{ 0.5f, -0.5f, -0.5f}, {0.0f,  0.0f, -1.0f}, {1.0f, 0.0f}},
@@ -333,6 +414,9 @@ void Mesh::InitializeCube() {
     mVerticesCount = ArrayCount(vertices);
     mIndicesCount = 0;
 
+    mBounds.mMesh = ComputeVerticesBoundingVolume(vertices, mVerticesCount);
+    mBounds.mJoints.clear();
+
     glGenVertexArrays(1, &mVao);
     glGenBuffers(1, &mVbo);
 
@@ -2,6 +2,7 @@
 #define _MESH_H_
 
 #include <cgltf.h>
+#include "BoundingVolume.h"
 
 struct Mesh {
 
@@ -12,6 +13,8 @@ struct Mesh {
     unsigned int mVerticesCount;
     unsigned int mIndicesCount;
 
+    MeshBounds mBounds;
+
     Mesh() : mVao(0), mVbo(0), mEbo(0) { }
     void InitializeStatic(cgltf_data *data);
     void InitializeAnimated(cgltf_data *data);
@@ -0,0 +1,325 @@
+#include "MotionMatching.h"
+#include "Defines.h"
+#include "AllocTracker.h"
+#include "Profiler.h"
+
+#include <cmath>
+#include <string.h>
+#include <algorithm>
+
+// Relative importance of the feature groups once each is normalized
+struct MotionFeatureGroup {
+    unsigned int mOffset;
+    unsigned int mSize;
+    float mWeight;
+};
+
+static const MotionFeatureGroup gFeatureGroups[] = {
+    { MOTION_FEATURE_LEFT_FOOT, 3, 0.75f },
+    { MOTION_FEATURE_RIGHT_FOOT, 3, 0.75f },
+    { MOTION_FEATURE_LEFT_FOOT_VELOCITY, 3, 1.0f },
+    { MOTION_FEATURE_RIGHT_FOOT_VELOCITY, 3, 1.0f },
+    { MOTION_FEATURE_HIP_VELOCITY, 3, 1.0f },
+    { MOTION_FEATURE_TRAJECTORY, 2 * MOTION_TRAJECTORY_POINTS, 1.0f },
+};
+
+// Ground position under the hips and their heading, the features are measured from it
+struct MotionCharacterFrame {
+    vec3 mOrigin;
+    float mCos;
+    float mSin;
+
+    vec3 ToLocalVector(const vec3 &v) const {
+        return vec3(v.x * mCos - v.z * mSin, v.y, v.x * mSin + v.z * mCos);
+    }
+
+    vec3 ToLocalPoint(const vec3 &p) const {
+        return ToLocalVector(p - mOrigin);
+    }
+};
+
+static MotionCharacterFrame GetCharacterFrame(const Transform &hips) {
+    MotionCharacterFrame frame;
+    frame.mOrigin = vec3(hips.mPosition.x, 0.0f, hips.mPosition.z);
+    vec3 forward = hips.mRotation * vec3(0, 0, 1);
+    float yaw = atan2f(forward.x, forward.z);
+    frame.mCos = cosf(yaw);
+    frame.mSin = sinf(yaw);
+    return frame;
+}
+
+static float SquaredDistance(const float *a, const float *b) {
+    // One partial sum per lane so the compiler can keep the loop in SIMD
+    // registers (SSE, or AVX with GAME_ARCH) without reassociating floats
+    float lanes[8] = {};
+    for(unsigned int k = 0; k < MOTION_FEATURE_STRIDE; k += 8) {
+        for(unsigned int j = 0; j < 8; ++j) {
+            float d = a[k + j] - b[k + j];
+            lanes[j] += d * d;
+        }
+    }
+    return ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) + ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]));
+}
+
+void MotionDatabase::Build(std::vector<Clip> &clips, Pose &restPose, int leftFoot, int rightFoot, int hips) {
+    PROFILE_FUNCTION();
+    AllocTagScope tag(ALLOC_TAG_ANIMATION);
+    mFeatures.clear();
+    mFrames.clear();
+    mClipFirstFrame.clear();
+
+    const float velocityStep = 1.0f / 60.0f;
+    Pose pose = restPose;
+    Pose previous = restPose;
+    Pose future = restPose;
+    for(unsigned int c = 0; c < (unsigned int)clips.size(); ++c) {
+        Clip &clip = clips[c];
+        mClipFirstFrame.push_back((unsigned int)mFrames.size());
+        unsigned int frameCount = (unsigned int)(clip.GetDuration() * MOTION_SAMPLE_RATE) + 1;
+        for(unsigned int f = 0; f < frameCount; ++f) {
+            float time = clip.mStartTime + (float)f / MOTION_SAMPLE_RATE;
+            pose = restPose;
+            clip.Sample(pose, time);
+            // Looping clips wrap, the others clamp and read a zero velocity at the start
+            previous = restPose;
+            clip.Sample(previous, time - velocityStep);
+
+            Transform hipsNow = pose.GetGlobalTransform(hips);
+            MotionCharacterFrame frame = GetCharacterFrame(hipsNow);
+            vec3 leftNow = pose.GetGlobalTransform(leftFoot).mPosition;
+            vec3 rightNow = pose.GetGlobalTransform(rightFoot).mPosition;
+            vec3 leftBefore = previous.GetGlobalTransform(leftFoot).mPosition;
+            vec3 rightBefore = previous.GetGlobalTransform(rightFoot).mPosition;
+            vec3 hipsBefore = previous.GetGlobalTransform(hips).mPosition;
+
+            float row[MOTION_FEATURE_STRIDE] = {};
+            vec3 values[5] = {
+                frame.ToLocalPoint(leftNow),
+                frame.ToLocalPoint(rightNow),
+                frame.ToLocalVector((leftNow - leftBefore) * (1.0f / velocityStep)),
+                frame.ToLocalVector((rightNow - rightBefore) * (1.0f / velocityStep)),
+                frame.ToLocalVector((hipsNow.mPosition - hipsBefore) * (1.0f / velocityStep)),
+            };
+            memcpy(row, values, sizeof(values));
+            for(unsigned int p = 0; p < MOTION_TRAJECTORY_POINTS; ++p) {
+                future = restPose;
+                clip.Sample(future, time + (float)(p + 1) / MOTION_TRAJECTORY_POINTS);
+                vec3 position = frame.ToLocalPoint(future.GetGlobalTransform(hips).mPosition);
+                row[MOTION_FEATURE_TRAJECTORY + p * 2 + 0] = position.x;
+                row[MOTION_FEATURE_TRAJECTORY + p * 2 + 1] = position.z;
+            }
+            mFeatures.insert(mFeatures.end(), row, row + MOTION_FEATURE_STRIDE);
+            MotionFrame motionFrame = { c, time };
+            mFrames.push_back(motionFrame);
+        }
+    }
+
+    // Each dimension is centered, each group is scaled by its deviation so
+    // positions in meters and velocities in meters per second weigh the same
+    unsigned int count = FrameCount();
+    for(unsigned int k = 0; k < MOTION_FEATURE_STRIDE; ++k) {
+        mMean[k] = 0.0f;
+        mScale[k] = 0.0f;
+    }
+    if(!count) {
+        return;
+    }
+    for(unsigned int i = 0; i < count; ++i) {
+        for(unsigned int k = 0; k < MOTION_FEATURE_COUNT; ++k) {
+            mMean[k] += mFeatures[i * MOTION_FEATURE_STRIDE + k];
+        }
+    }
+    for(unsigned int k = 0; k < MOTION_FEATURE_COUNT; ++k) {
+        mMean[k] /= (float)count;
+    }
+    for(unsigned int g = 0; g < ArrayCount(gFeatureGroups); ++g) {
+        const MotionFeatureGroup &group = gFeatureGroups[g];
+        float variance = 0.0f;
+        for(unsigned int i = 0; i < count; ++i) {
+            for(unsigned int k = group.mOffset; k < group.mOffset + group.mSize; ++k) {
+                float d = mFeatures[i * MOTION_FEATURE_STRIDE + k] - mMean[k];
+                variance += d * d;
+            }
+        }
+        float deviation = sqrtf(variance / (float)(count * group.mSize));
+        for(unsigned int k = group.mOffset; k < group.mOffset + group.mSize; ++k) {
+            mScale[k] = deviation > 0.0f ? group.mWeight / deviation : 0.0f;
+        }
+    }
+    for(unsigned int i = 0; i < count; ++i) {
+        Normalize(&mFeatures[i * MOTION_FEATURE_STRIDE]);
+    }
+    BuildTree();
+}
+
+void MotionDatabase::BuildTree() {
+    AllocTagScope tag(ALLOC_TAG_ANIMATION);
+    unsigned int count = FrameCount();
+    mOrder.resize(count);
+    for(unsigned int i = 0; i < count; ++i) {
+        mOrder[i] = i;
+    }
+    mNodes.clear();
+    mNodes.reserve(2 * (count / MOTION_KDTREE_LEAF_SIZE + 1));
+    if(count) {
+        BuildNode(0, count);
+    }
+}
+
+unsigned int MotionDatabase::FrameCount() {
+    return (unsigned int)mFrames.size();
+}
+
+unsigned int MotionDatabase::FindFrame(unsigned int clip, float time) {
+    unsigned int first = mClipFirstFrame[clip];
+    unsigned int last = clip + 1 < (unsigned int)mClipFirstFrame.size() ? mClipFirstFrame[clip + 1] : FrameCount();
+    int offset = (int)((time - mFrames[first].mTime) * MOTION_SAMPLE_RATE + 0.5f);
+    offset = std::max(0, std::min(offset, (int)(last - first) - 1));
+    return first + (unsigned int)offset;
+}
+
+const float *MotionDatabase::GetFeatures(unsigned int frame) {
+    return &mFeatures[frame * MOTION_FEATURE_STRIDE];
+}
+
+void MotionDatabase::Normalize(float *features) {
+    for(unsigned int k = 0; k < MOTION_FEATURE_STRIDE; ++k) {
+        features[k] = (features[k] - mMean[k]) * mScale[k];
+    }
+}
+
+unsigned int MotionDatabase::Search(const float *query, float *outDistance) {
+    PROFILE_FUNCTION();
+    unsigned int best = 0;
+    float bestDistance = INFINITY;
+    unsigned int count = FrameCount();
+    const float *row = mFeatures.data();
+    for(unsigned int i = 0; i < count; ++i, row += MOTION_FEATURE_STRIDE) {
+        float distance = SquaredDistance(row, query);
+        if(distance < bestDistance) {
+            bestDistance = distance;
+            best = i;
+        }
+    }
+    if(outDistance) *outDistance = bestDistance;
+    return best;
+}
+
+unsigned int MotionDatabase::SearchTree(const float *query, float *outDistance) {
+    PROFILE_FUNCTION();
+    unsigned int best = 0;
+    float bestDistance = INFINITY;
+    if(!mNodes.empty()) {
+        SearchNode(0, query, &best, &bestDistance);
+    }
+    if(outDistance) *outDistance = bestDistance;
+    return best;
+}
+
+// Splits on the dimension with the widest spread at its median
+unsigned int MotionDatabase::BuildNode(unsigned int begin, unsigned int end) {
+    unsigned int index = (unsigned int)mNodes.size();
+    mNodes.push_back(MotionKDNode());
+    MotionKDNode node = {};
+    node.mDimension = -1;
+    node.mBegin = begin;
+    node.mEnd = end;
+    if(end - begin > MOTION_KDTREE_LEAF_SIZE) {
+        float minimum[MOTION_FEATURE_COUNT];
+        float maximum[MOTION_FEATURE_COUNT];
+        for(unsigned int k = 0; k < MOTION_FEATURE_COUNT; ++k) {
+            minimum[k] = INFINITY;
+            maximum[k] = -INFINITY;
+        }
+        for(unsigned int i = begin; i < end; ++i) {
+            const float *row = GetFeatures(mOrder[i]);
+            for(unsigned int k = 0; k < MOTION_FEATURE_COUNT; ++k) {
+                minimum[k] = fminf(minimum[k], row[k]);
+                maximum[k] = fmaxf(maximum[k], row[k]);
+            }
+        }
+        int dimension = 0;
+        for(unsigned int k = 1; k < MOTION_FEATURE_COUNT; ++k) {
+            if(maximum[k] - minimum[k] > maximum[dimension] - minimum[dimension]) {
+                dimension = (int)k;
+            }
+        }
+        if(maximum[dimension] > minimum[dimension]) {
+            unsigned int middle = begin + (end - begin) / 2;
+            const float *features = mFeatures.data();
+            std::nth_element(mOrder.begin() + begin, mOrder.begin() + middle, mOrder.begin() + end,
+                [features, dimension](unsigned int a, unsigned int b) {
+                    return features[a * MOTION_FEATURE_STRIDE + dimension] < features[b * MOTION_FEATURE_STRIDE + dimension];
+                });
+            node.mDimension = dimension;
+            node.mSplit = GetFeatures(mOrder[middle])[dimension];
+            node.mLeft = BuildNode(begin, middle);
+            node.mRight = BuildNode(middle, end);
+        }
+    }
+    mNodes[index] = node;
+    return index;
+}
+
+void MotionDatabase::SearchNode(unsigned int index, const float *query, unsigned int *best, float *bestDistance) {
+    const MotionKDNode &node = mNodes[index];
+    if(node.mDimension < 0) {
+        for(unsigned int i = node.mBegin; i < node.mEnd; ++i) {
+            float distance = SquaredDistance(GetFeatures(mOrder[i]), query);
+            if(distance < *bestDistance) {
+                *bestDistance = distance;
+                *best = mOrder[i];
+            }
+        }
+        return;
+    }
+    // The near side first, the far one only if the splitting plane is closer than the best so far
+    float d = query[node.mDimension] - node.mSplit;
+    unsigned int nearChild = d < 0.0f ? node.mLeft : node.mRight;
+    unsigned int farChild = d < 0.0f ? node.mRight : node.mLeft;
+    SearchNode(nearChild, query, best, bestDistance);
+    if(d * d < *bestDistance) {
+        SearchNode(farChild, query, best, bestDistance);
+    }
+}
+
+void MotionMatcher::Initialize(MotionDatabase *database, std::vector<Clip> *clips, const Pose &restPose) {
+    mDatabase = database;
+    mClips = clips;
+    mController.Initialize(restPose);
+    mController.mMode = TRANSITION_INERTIALIZE;
+    mSearchInterval = 0.1f;
+    mSearchTimer = 0.0f;
+    mTransitionTime = 0.2f;
+    if(database->FrameCount()) {
+        mController.Play(&(*clips)[database->mFrames[0].mClip], database->mFrames[0].mTime);
+    }
+}
+
+void MotionMatcher::Update(float dt, const float *trajectory) {
+    PROFILE_FUNCTION();
+    mSearchTimer -= dt;
+    if(mSearchTimer <= 0.0f && mDatabase->FrameCount()) {
+        mSearchTimer += mSearchInterval;
+        // The current frame's features with the trajectory swapped for the desired one
+        unsigned int clip = (unsigned int)(mController.GetCurrentClip() - &(*mClips)[0]);
+        unsigned int current = mDatabase->FindFrame(clip, mController.mTime);
+        float query[MOTION_FEATURE_STRIDE];
+        memcpy(query, mDatabase->GetFeatures(current), sizeof(query));
+        for(unsigned int k = 0; k < 2 * MOTION_TRAJECTORY_POINTS; ++k) {
+            unsigned int dimension = MOTION_FEATURE_TRAJECTORY + k;
+            query[dimension] = (trajectory[k] - mDatabase->mMean[dimension]) * mDatabase->mScale[dimension];
+        }
+        unsigned int best = mDatabase->SearchTree(query);
+        // Staying on the clip already playing is free, jump only somewhere else
+        const MotionFrame &frame = mDatabase->mFrames[best];
+        if(frame.mClip != clip || fabsf(frame.mTime - mController.mTime) > 0.2f) {
+            mController.InertializeTo(&(*mClips)[frame.mClip], frame.mTime, mTransitionTime);
+        }
+    }
+    mController.Update(dt);
+}
+
+Pose &MotionMatcher::GetCurrentPose() {
+    return mController.GetCurrentPose();
+}
@@ -0,0 +1,91 @@
+#ifndef _MOTIONMATCHING_H_
+#define _MOTIONMATCHING_H_
+
+#include <vector>
+#include "Pose.h"
+#include "Clip.h"
+#include "CrossFadeController.h"
+
+#define MOTION_SAMPLE_RATE 30.0f
+#define MOTION_TRAJECTORY_POINTS 3
+// Foot positions and velocities, hip velocity and the future hip positions on the ground
+#define MOTION_FEATURE_COUNT (3 * 5 + 2 * MOTION_TRAJECTORY_POINTS)
+// Rows are padded so a scan over them stays on whole SIMD registers, a multiple of 8
+#define MOTION_FEATURE_STRIDE 24
+#define MOTION_KDTREE_LEAF_SIZE 8
+
+// Offsets of the feature groups in a row, the trajectory goes last so a
+// query can overwrite it with the desired one
+#define MOTION_FEATURE_LEFT_FOOT 0
+#define MOTION_FEATURE_RIGHT_FOOT 3
+#define MOTION_FEATURE_LEFT_FOOT_VELOCITY 6
+#define MOTION_FEATURE_RIGHT_FOOT_VELOCITY 9
+#define MOTION_FEATURE_HIP_VELOCITY 12
+#define MOTION_FEATURE_TRAJECTORY 15
+
+struct MotionFrame {
+    unsigned int mClip;
+    float mTime;
+};
+
+struct MotionKDNode {
+    // Leaves have mDimension -1 and cover mOrder[mBegin, mEnd)
+    int mDimension;
+    float mSplit;
+    unsigned int mLeft;
+    unsigned int mRight;
+    unsigned int mBegin;
+    unsigned int mEnd;
+};
+
+// Every clip sampled at MOTION_SAMPLE_RATE into rows of normalized features,
+// all measured in the ground frame under the hips facing the hips forward.
+// Built once at load. Search compares a query against every row, SearchTree
+// walks a KD-tree over the same rows, both return the index of the closest
+// frame
+struct MotionDatabase {
+    std::vector<float> mFeatures;
+    std::vector<MotionFrame> mFrames;
+    std::vector<unsigned int> mClipFirstFrame;
+    float mMean[MOTION_FEATURE_STRIDE];
+    float mScale[MOTION_FEATURE_STRIDE];
+
+    std::vector<MotionKDNode> mNodes;
+    std::vector<unsigned int> mOrder;
+
+    void Build(std::vector<Clip> &clips, Pose &restPose, int leftFoot, int rightFoot, int hips);
+    // Rebuilds the KD-tree after mFeatures changed
+    void BuildTree();
+    unsigned int FrameCount();
+    // The row of the frame of clip closest to time
+    unsigned int FindFrame(unsigned int clip, float time);
+    const float *GetFeatures(unsigned int frame);
+    // Turns raw features into the space of the rows
+    void Normalize(float *features);
+    unsigned int Search(const float *query, float *outDistance = 0);
+    unsigned int SearchTree(const float *query, float *outDistance = 0);
+
+private:
+    unsigned int BuildNode(unsigned int begin, unsigned int end);
+    void SearchNode(unsigned int node, const float *query, unsigned int *best, float *bestDistance);
+};
+
+// Plays the database clips and every mSearchInterval seconds jumps to the
+// frame that best continues the current pose along the desired trajectory.
+// Jumps are inertialized so only one clip is sampled
+struct MotionMatcher {
+    MotionDatabase *mDatabase;
+    std::vector<Clip> *mClips;
+    CrossFadeController mController;
+    float mSearchInterval;
+    float mSearchTimer;
+    float mTransitionTime;
+
+    void Initialize(MotionDatabase *database, std::vector<Clip> *clips, const Pose &restPose);
+    // trajectory holds MOTION_TRAJECTORY_POINTS ground positions (x, z) in the
+    // same frame as the database features, 1/3, 2/3 and 1 second ahead
+    void Update(float dt, const float *trajectory);
+    Pose &GetCurrentPose();
+};
+
+#endif
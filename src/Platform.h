@@ -0,0 +1,28 @@
+#ifndef _PLATFORM_H_
+#define _PLATFORM_H_
+
+#include <stddef.h>
+
+// Everything the game needs from the operating system. WinMain.cpp implements
+// it with Win32/WGL/XInput, HeadlessMain.cpp with POSIX and no window at all
+
+struct FileResult {
+    void *data;
+    size_t size;
+};
+
+// File I/O, the data is null terminated. Free it with PlatformFreeFile
+FileResult PlatformReadFile(const char *path);
+void PlatformFreeFile(FileResult *file);
+
+// Timer, seconds from an arbitrary start point
+double PlatformGetSeconds();
+
+// Window
+void PlatformGetWindowSize(int *width, int *height);
+void PlatformSwapBuffers();
+
+// Input, fills gInput for this frame. Returns false when the game has to quit
+bool PlatformProcessInput();
+
+#endif
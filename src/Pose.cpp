@@ -1,46 +1,72 @@
 #include "Pose.h"
+#include "Arena.h"
+#include "AllocTracker.h"
+#include "Profiler.h"
 
-Pose::Pose() { }
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <cmath>
 
-Pose::Pose(unsigned int numJoints) {
-	Resize(numJoints);
+Pose::Pose() : mJoints(0), mTopology(0) { }
+
+Pose::Pose(const PoseTopology *topology) : mJoints(0), mTopology(topology) {
+	mJoints = GetPosePool()->Allocate();
+	for (unsigned int i = 0; i < topology->mJointCount; ++i) {
+		mJoints[i] = Transform();
+	}
 }
 
-Pose::Pose(const Pose& p) {
+Pose::Pose(const Pose& p) : mJoints(0), mTopology(0) {
 	*this = p;
 }
 
+Pose::Pose(Pose&& p) noexcept : mJoints(p.mJoints), mTopology(p.mTopology) {
+	p.mJoints = 0;
+	p.mTopology = 0;
+}
+
+Pose::~Pose() {
+	Release();
+}
+
 Pose& Pose::operator=(const Pose& p) {
 	if (&p == this) {
 		return *this;
 	}
-
-	if (mParents.size() != p.mParents.size()) {
-		mParents.resize(p.mParents.size());
+	if (!p.mJoints) {
+		Release();
+		return *this;
 	}
-	if (mJoints.size() != p.mJoints.size()) {
-		mJoints.resize(p.mJoints.size());
+	// Buffers have a fixed capacity, only an empty pose has to get one
+	if (!mJoints) {
+		mJoints = GetPosePool()->Allocate();
 	}
+	mTopology = p.mTopology;
+	memcpy(mJoints, p.mJoints, sizeof(Transform) * mTopology->mJointCount);
+	return *this;
+}
 
-	if (mParents.size() != 0) {
-		memcpy(&mParents[0], &p.mParents[0],
-			sizeof(int) * mParents.size());
-	}
-	if (mJoints.size() != 0) {
-		memcpy(&mJoints[0], &p.mJoints[0],
-			sizeof(Transform) * mJoints.size());
+Pose& Pose::operator=(Pose&& p) noexcept {
+	if (&p == this) {
+		return *this;
 	}
-
+	Release();
+	mJoints = p.mJoints;
+	mTopology = p.mTopology;
+	p.mJoints = 0;
+	p.mTopology = 0;
 	return *this;
 }
 
-void Pose::Resize(unsigned int size) {
-	mParents.resize(size);
-	mJoints.resize(size);
+void Pose::Release() {
+	GetPosePool()->Free(mJoints);
+	mJoints = 0;
+	mTopology = 0;
 }
 
 unsigned int Pose::Size() {
-	return (unsigned int)mJoints.size();
+	return mTopology ? mTopology->mJointCount : 0;
 }
 
 Transform Pose::GetLocalTransform(unsigned int index) {
@@ -54,7 +80,8 @@ void Pose::SetLocalTransform(unsigned int index,
 
 Transform Pose::GetGlobalTransform(unsigned int index) {
 	Transform result = mJoints[index];
-	for (int parent = mParents[index]; parent >= 0; parent = mParents[parent]) {
+	const int *parents = mTopology->mParents;
+	for (int parent = parents[index]; parent >= 0; parent = parents[parent]) {
 		result = combine(mJoints[parent], result);
 	}
 	return result;
@@ -67,6 +94,7 @@ Transform Pose::operator[](unsigned int index) {
 void Pose::GetMatrixPalette(std::vector<mat4>& out) {
 	unsigned int size = Size();
 	if (out.size() != size) {
+		AllocTagScope tag(ALLOC_TAG_ANIMATION);
 		out.resize(size);
 	}
 
@@ -76,34 +104,26 @@ void Pose::GetMatrixPalette(std::vector<mat4>& out) {
 	}
 }
 
-int Pose::GetParent(unsigned int index) {
-	return mParents[index];
+// out has to hold Size() matrices
+void Pose::GetMatrixPalette(mat4 *out) {
+	unsigned int size = Size();
+	for (unsigned int i = 0; i < size; ++i) {
+		Transform t = GetGlobalTransform(i);
+		out[i] = transformToMat4(t);
+	}
 }
 
-void Pose::SetParent(unsigned int index, int parent) {
-	mParents[index] = parent;
+int Pose::GetParent(unsigned int index) {
+	return mTopology->mParents[index];
 }
 
 bool Pose::operator==(const Pose& other) {
-	if (mJoints.size() != other.mJoints.size()) {
-		return false;
-	}
-	if (mParents.size() != other.mParents.size()) {
+	if (mTopology != other.mTopology) {
 		return false;
 	}
-	unsigned int size = (unsigned int)mJoints.size();
+	unsigned int size = Size();
 	for (unsigned int i = 0; i < size; ++i) {
-		Transform thisLocal = mJoints[i];
-		Transform otherLocal = other.mJoints[i];
-
-		int thisParent = mParents[i];
-		int otherParent = other.mParents[i];
-
-		if (thisParent != otherParent) {
-			return false;
-		}
-
-		if (thisLocal != otherLocal) {
+		if (mJoints[i] != other.mJoints[i]) {
 			return false;
 		}
 	}
@@ -114,6 +134,73 @@ bool Pose::operator!=(const Pose& other) {
 	return !(*this == other);
 }
 
+// Straight loop over the joint floats: positions and scales lerp, rotations
+// nlerp along the shortest arc. No calls and no branches per joint, so the
+// compiler can keep it in vector registers. out may be a or b
+static inline void BlendJoint(Transform& jo, const Transform& ja, const Transform& jb, float t, float s) {
+	float d = ja.mRotation.x * jb.mRotation.x + ja.mRotation.y * jb.mRotation.y +
+	          ja.mRotation.z * jb.mRotation.z + ja.mRotation.w * jb.mRotation.w;
+	float bt = d < 0.0f ? -t : t;
+	float qx = ja.mRotation.x * s + jb.mRotation.x * bt;
+	float qy = ja.mRotation.y * s + jb.mRotation.y * bt;
+	float qz = ja.mRotation.z * s + jb.mRotation.z * bt;
+	float qw = ja.mRotation.w * s + jb.mRotation.w * bt;
+	float invLength = 1.0f / sqrtf(qx * qx + qy * qy + qz * qz + qw * qw);
+
+	jo.mPosition.x = ja.mPosition.x * s + jb.mPosition.x * t;
+	jo.mPosition.y = ja.mPosition.y * s + jb.mPosition.y * t;
+	jo.mPosition.z = ja.mPosition.z * s + jb.mPosition.z * t;
+	jo.mRotation.x = qx * invLength;
+	jo.mRotation.y = qy * invLength;
+	jo.mRotation.z = qz * invLength;
+	jo.mRotation.w = qw * invLength;
+	jo.mScale.x = ja.mScale.x * s + jb.mScale.x * t;
+	jo.mScale.y = ja.mScale.y * s + jb.mScale.y * t;
+	jo.mScale.z = ja.mScale.z * s + jb.mScale.z * t;
+}
+
+void Blend(Pose& out, const Pose& a, const Pose& b, float t) {
+	assert(a.mTopology == b.mTopology && out.mTopology == a.mTopology);
+	unsigned int size = a.mTopology->mJointCount;
+	const Transform *aJoints = a.mJoints;
+	const Transform *bJoints = b.mJoints;
+	Transform *outJoints = out.mJoints;
+	float s = 1.0f - t;
+	for (unsigned int i = 0; i < size; ++i) {
+		BlendJoint(outJoints[i], aJoints[i], bJoints[i], t, s);
+	}
+}
+
+void Blend(Pose& out, const Pose& a, const Pose& b, float t, const JointMask& mask) {
+	assert(a.mTopology == b.mTopology && out.mTopology == a.mTopology);
+	if (mask.IsEmpty()) {
+		return;
+	}
+	unsigned int last = mask.Last();
+	assert(last < a.mTopology->mJointCount);
+	float s = 1.0f - t;
+	for (unsigned int i = mask.First(); i <= last; ++i) {
+		if (mask.IsSet(i)) {
+			BlendJoint(out.mJoints[i], a.mJoints[i], b.mJoints[i], t, s);
+		}
+	}
+}
+
+JointMask GetSubtreeMask(Pose& pose, unsigned int root) {
+	JointMask mask;
+	unsigned int size = pose.Size();
+	for (unsigned int i = 0; i < size; ++i) {
+		int joint = (int)i;
+		while (joint >= 0 && joint != (int)root) {
+			joint = pose.GetParent(joint);
+		}
+		if (joint == (int)root) {
+			mask.Set(i);
+		}
+	}
+	return mask;
+}
+
 static Transform GetLocalTransform(const cgltf_node *node) {
         Transform result;
         if(node->has_matrix) {
@@ -146,22 +233,36 @@ static int GetNodeIndex(cgltf_node *target, cgltf_node *nodes, unsigned int node
 
 
 Pose LoadRestPose(cgltf_data *data) {
+    PROFILE_FUNCTION();
+    AllocTagScope tag(ALLOC_TAG_ANIMATION);
     unsigned int boneCount = (unsigned int)data->nodes_count;
-    Pose result(boneCount);
+    // Every node is a joint, the pose buffers only hold POSE_MAX_JOINTS of them
+    if(boneCount > POSE_MAX_JOINTS) {
+        printf("Error Loading Pose: %u nodes, at most %d joints are supported\n", boneCount, POSE_MAX_JOINTS);
+        return Pose();
+    }
+    int parents[POSE_MAX_JOINTS];
+    for(unsigned int i = 0; i < boneCount; ++i) {
+        parents[i] = GetNodeIndex(data->nodes[i].parent, data->nodes, boneCount);
+    }
+    Pose result(GetPoseTopology(parents, boneCount));
     for(unsigned int i = 0; i < boneCount; ++i) {
-        cgltf_node* node = &(data->nodes[i]);
         Transform transform = GetLocalTransform(data->nodes + i);
         result.SetLocalTransform(i, transform);
-        int parent = GetNodeIndex(node->parent, data->nodes, boneCount);
-        result.SetParent(i, parent);
     }
     return result;
 }
 
 Pose LoadBindPose(cgltf_data *data) {
+    PROFILE_FUNCTION();
+    AllocTagScope tag(ALLOC_TAG_ANIMATION);
+    ScratchScope scratch;
     Pose restPose = LoadRestPose(data);
     unsigned int numBones = restPose.Size();
-    std::vector<Transform> worldBindPose(numBones);
+    if(numBones == 0) {
+        return restPose;
+    }
+    Transform *worldBindPose = scratch.mArena->PushArray<Transform>(numBones);
     for(unsigned int i = 0; i < numBones; ++i) {
         worldBindPose[i] = restPose.GetGlobalTransform(i); 
     }
@@ -169,9 +270,7 @@ Pose LoadBindPose(cgltf_data *data) {
     unsigned int numSkins = (unsigned int)data->skins_count;
     for(unsigned int i = 0; i < numSkins; ++i) {
         cgltf_skin* skin = &(data->skins[i]);
-        std::vector<float> invBindAccessor;
-
-        invBindAccessor.resize(skin->inverse_bind_matrices->count * 16);
+        float *invBindAccessor = scratch.mArena->PushArray<float>(skin->inverse_bind_matrices->count * 16);
         for(cgltf_size j = 0; j < skin->inverse_bind_matrices->count; ++j) {
             cgltf_accessor_read_float(skin->inverse_bind_matrices, j, &invBindAccessor[j * 16], 16);
         }
@@ -187,6 +286,9 @@ Pose LoadBindPose(cgltf_data *data) {
             // Set the transform in the world bind pose
             cgltf_node* jointNode = skin->joints[j];
             int jointIndex = GetNodeIndex(jointNode, data->nodes, numBones);
+            if(jointIndex < 0) {
+                continue;
+            }
             worldBindPose[jointIndex] = bindTransform;
         }
     }
@@ -204,3 +306,12 @@ Pose LoadBindPose(cgltf_data *data) {
     } 
     return bindPose;
 }
+
+int FindJointIndex(cgltf_data *data, const char *name) {
+    for(unsigned int i = 0; i < (unsigned int)data->nodes_count; ++i) {
+        if(data->nodes[i].name && strcmp(data->nodes[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
@@ -4,30 +4,48 @@
 #include <vector>
 #include <cgltf.h>
 #include "Transform.h"
+#include "PosePool.h"
+#include "JointMask.h"
 
+// Local joint transforms in a pooled buffer plus the shared topology. Copies
+// between poses of the same skeleton are a memcpy and never allocate
 struct Pose {
-    std::vector<Transform> mJoints;
-    std::vector<int> mParents;
+    Transform *mJoints;
+    const PoseTopology *mTopology;
     
 	Pose();
+	Pose(const PoseTopology *topology);
 	Pose(const Pose& p);
+	Pose(Pose&& p) noexcept;
+	~Pose();
 	Pose& operator=(const Pose& p);
-	Pose(unsigned int numJoints);
-	void Resize(unsigned int size);
+	Pose& operator=(Pose&& p) noexcept;
 	unsigned int Size();
 	Transform GetLocalTransform(unsigned int index);
 	void SetLocalTransform(unsigned int index, const Transform& transform);
 	Transform GetGlobalTransform(unsigned int index);
 	Transform operator[](unsigned int index);
 	void GetMatrixPalette(std::vector<mat4>& out);
+	void GetMatrixPalette(mat4 *out);
 	int GetParent(unsigned int index);
-	void SetParent(unsigned int index, int parent);
 
 	bool operator==(const Pose& other);
 	bool operator!=(const Pose& other);
+private:
+	void Release();
 };
 
+// out = mix(a, b, t) joint by joint, all three poses share the topology
+void Blend(Pose& out, const Pose& a, const Pose& b, float t);
+// Same but only for the joints in mask, the rest of out is left alone
+void Blend(Pose& out, const Pose& a, const Pose& b, float t, const JointMask& mask);
+// root and every joint below it
+JointMask GetSubtreeMask(Pose& pose, unsigned int root);
+
+// An empty pose (Size 0) when the file has more than POSE_MAX_JOINTS nodes
 Pose LoadRestPose(cgltf_data *data);
 Pose LoadBindPose(cgltf_data *data);
+// Index of the joint with this node name, -1 if there is none
+int FindJointIndex(cgltf_data *data, const char *name);
 
 #endif
@@ -0,0 +1,130 @@
+#include "PoseCache.h"
+#include "AllocTracker.h"
+#include "Profiler.h"
+
+#include <cmath>
+
+static unsigned int HashKey(const PoseCacheKey &key) {
+    return (key.mClip * 73856093u) ^ ((unsigned int)key.mStep * 19349663u) ^ (key.mLevel * 83492791u);
+}
+
+static bool SameKey(const PoseCacheKey &a, const PoseCacheKey &b) {
+    return a.mClip == b.mClip && a.mStep == b.mStep && a.mLevel == b.mLevel;
+}
+
+void PoseCache::Initialize() {
+    // Far levels are sampled every few frames anyway, coarser steps cost nothing there
+    mTimeSteps[0] = 1.0f / 60.0f;
+    mTimeSteps[1] = 1.0f / 30.0f;
+    mTimeSteps[2] = 1.0f / 15.0f;
+    for(unsigned int i = 0; i < POSE_CACHE_CAPACITY; ++i) {
+        mEntries[i].mInUse = false;
+        mFreeEntries[i] = POSE_CACHE_CAPACITY - 1 - i;
+    }
+    mFreeCount = POSE_CACHE_CAPACITY;
+    for(unsigned int i = 0; i < POSE_CACHE_TABLE_SIZE; ++i) {
+        mTable[i] = POSE_CACHE_EMPTY;
+    }
+    mFrame = 0;
+    mHits = mMisses = mBypasses = 0;
+    mTotalHits = mTotalMisses = mTotalBypasses = 0;
+}
+
+void PoseCache::Shutdown() {
+    for(unsigned int i = 0; i < POSE_CACHE_CAPACITY; ++i) {
+        mEntries[i].mPose = Pose();
+        std::vector<mat4>().swap(mEntries[i].mPalette);
+    }
+    Initialize();
+}
+
+// Slot holding key, or the empty slot where it goes
+unsigned int PoseCache::FindSlot(const PoseCacheKey &key) {
+    unsigned int slot = HashKey(key) & (POSE_CACHE_TABLE_SIZE - 1);
+    while(mTable[slot] != POSE_CACHE_EMPTY && !SameKey(mEntries[mTable[slot]].mKey, key)) {
+        slot = (slot + 1) & (POSE_CACHE_TABLE_SIZE - 1);
+    }
+    return slot;
+}
+
+void PoseCache::BeginFrame(unsigned int maxAge) {
+    mFrame++;
+    mHits = mMisses = mBypasses = 0;
+    // Rebuilt from the entries still alive, no tombstones to clean up
+    for(unsigned int i = 0; i < POSE_CACHE_TABLE_SIZE; ++i) {
+        mTable[i] = POSE_CACHE_EMPTY;
+    }
+    for(unsigned int i = 0; i < POSE_CACHE_CAPACITY; ++i) {
+        PoseCacheEntry *entry = &mEntries[i];
+        if(!entry->mInUse) {
+            continue;
+        }
+        if(mFrame - entry->mLastUsed > maxAge) {
+            entry->mInUse = false;
+            mFreeEntries[mFreeCount++] = i;
+            continue;
+        }
+        mTable[FindSlot(entry->mKey)] = i;
+    }
+}
+
+unsigned int PoseCache::Acquire(Clip &clip, unsigned int clipIndex, float inTime, unsigned int level,
+                                const JointMask *mask, const Pose &restPose) {
+    PoseCacheKey key;
+    key.mClip = clipIndex;
+    key.mStep = (int)floorf(inTime / mTimeSteps[level] + 0.5f);
+    key.mLevel = level;
+    unsigned int slot = FindSlot(key);
+    if(mTable[slot] != POSE_CACHE_EMPTY) {
+        mEntries[mTable[slot]].mLastUsed = mFrame;
+        mHits++;
+        mTotalHits++;
+        return mTable[slot] + 1;
+    }
+    if(!mFreeCount) {
+        mBypasses++;
+        mTotalBypasses++;
+        return 0;
+    }
+
+    PROFILE_SCOPE("PoseCache miss");
+    unsigned int index = mFreeEntries[--mFreeCount];
+    PoseCacheEntry *entry = &mEntries[index];
+    entry->mKey = key;
+    entry->mInUse = true;
+    entry->mPaletteReady = false;
+    entry->mLastUsed = mFrame;
+    {
+        AllocTagScope tag(ALLOC_TAG_ANIMATION);
+        entry->mPose = restPose;
+    }
+    float time = (float)key.mStep * mTimeSteps[level];
+    if(mask) {
+        clip.SampleMasked(entry->mPose, time, *mask);
+    }
+    else {
+        clip.Sample(entry->mPose, time);
+    }
+    mTable[slot] = index;
+    mMisses++;
+    mTotalMisses++;
+    return index + 1;
+}
+
+const Pose &PoseCache::GetPose(unsigned int entry) {
+    return mEntries[entry - 1].mPose;
+}
+
+const std::vector<mat4> &PoseCache::GetPalette(unsigned int entry) {
+    PoseCacheEntry *cached = &mEntries[entry - 1];
+    if(!cached->mPaletteReady) {
+        cached->mPose.GetMatrixPalette(cached->mPalette);
+        cached->mPaletteReady = true;
+    }
+    return cached->mPalette;
+}
+
+float PoseCache::HitRate() {
+    unsigned long long total = mTotalHits + mTotalMisses + mTotalBypasses;
+    return total ? (float)((double)mTotalHits / (double)total) : 0.0f;
+}
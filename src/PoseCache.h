@@ -0,0 +1,72 @@
+#ifndef _POSECACHE_H_
+#define _POSECACHE_H_
+
+#include <vector>
+#include "Pose.h"
+#include "Clip.h"
+#include "AnimationLod.h"
+
+#define POSE_CACHE_CAPACITY 256
+// Twice the entries keeps the linear probes short
+#define POSE_CACHE_TABLE_SIZE (POSE_CACHE_CAPACITY * 2)
+#define POSE_CACHE_EMPTY 0xFFFFFFFF
+
+struct PoseCacheKey {
+    unsigned int mClip;
+    int mStep;
+    unsigned int mLevel;
+};
+
+// A key always maps to the same pose, so the palette stays valid once built
+struct PoseCacheEntry {
+    PoseCacheKey mKey;
+    Pose mPose;
+    std::vector<mat4> mPalette;
+    unsigned int mLastUsed;
+    bool mInUse;
+    bool mPaletteReady;
+};
+
+// Poses of clips sampled at a time rounded to mTimeSteps[level], shared by
+// every character asking for the same clip, step and LOD level. The pose
+// and palette of an entry are sampled and built once and only read after
+// that. Entries live until no character asked for them in maxAge frames, a
+// character updated every few frames keeps drawing its entry in between.
+// Entries are handed out 1 based, 0 means the cache was full and the
+// character has to sample its own pose
+struct PoseCache {
+    PoseCacheEntry mEntries[POSE_CACHE_CAPACITY];
+    unsigned int mFreeEntries[POSE_CACHE_CAPACITY];
+    unsigned int mFreeCount;
+    unsigned int mTable[POSE_CACHE_TABLE_SIZE];
+    float mTimeSteps[ANIMATION_LOD_LEVELS];
+    unsigned int mFrame;
+
+    // Requests answered by an existing entry, by a new one and not at all,
+    // for the last frame and since Initialize
+    unsigned int mHits;
+    unsigned int mMisses;
+    unsigned int mBypasses;
+    unsigned long long mTotalHits;
+    unsigned long long mTotalMisses;
+    unsigned long long mTotalBypasses;
+
+    void Initialize();
+    void Shutdown();
+    // Drops the entries not asked for in more than maxAge frames
+    void BeginFrame(unsigned int maxAge);
+    // inTime has to be inside the clip range. mask limits the sampled
+    // joints, the others keep the rest pose
+    unsigned int Acquire(Clip &clip, unsigned int clipIndex, float inTime, unsigned int level,
+                         const JointMask *mask, const Pose &restPose);
+    const Pose &GetPose(unsigned int entry);
+    // Built the first time it is asked for
+    const std::vector<mat4> &GetPalette(unsigned int entry);
+    // Share of all requests answered by an existing entry
+    float HitRate();
+
+private:
+    unsigned int FindSlot(const PoseCacheKey &key);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "PosePool.h"
+#include "AllocTracker.h"
+
+#include <deque>
+#include <string.h>
+#include <assert.h>
+
+#define POSE_BUFFER_SIZE (sizeof(Transform) * POSE_MAX_JOINTS)
+
+static PosePool gPosePool;
+// By value, a deque keeps the addresses handed out while it grows
+static std::deque<PoseTopology> gTopologies;
+
+Transform *PosePool::Allocate() {
+    if(!mFreeList) {
+        Grow();
+    }
+    Transform *buffer = mFreeList;
+    mFreeList = *(Transform **)buffer;
+    mFreeCount--;
+    return buffer;
+}
+
+void PosePool::Free(Transform *buffer) {
+    if(!buffer) {
+        return;
+    }
+    *(Transform **)buffer = mFreeList;
+    mFreeList = buffer;
+    mFreeCount++;
+}
+
+void PosePool::Grow() {
+    AllocTagScope tag(ALLOC_TAG_ANIMATION);
+    unsigned char *block = (unsigned char *)TrackedMalloc(POSE_BUFFER_SIZE * POSE_POOL_BLOCK_SIZE + 15, ALLOC_TAG_ANIMATION);
+    mBlocks.push_back(block);
+    unsigned char *aligned = (unsigned char *)(((size_t)block + 15) & ~(size_t)15);
+    for(int i = POSE_POOL_BLOCK_SIZE - 1; i >= 0; --i) {
+        Free((Transform *)(aligned + i * POSE_BUFFER_SIZE));
+    }
+    mBufferCount += POSE_POOL_BLOCK_SIZE;
+}
+
+void PosePool::Shutdown() {
+    assert(mFreeCount == mBufferCount && "poses still alive");
+    for(unsigned int i = 0; i < mBlocks.size(); ++i) {
+        TrackedFree(mBlocks[i]);
+    }
+    mBlocks.clear();
+    mFreeList = 0;
+    mBufferCount = 0;
+    mFreeCount = 0;
+}
+
+PosePool *GetPosePool() {
+    return &gPosePool;
+}
+
+const PoseTopology *GetPoseTopology(const int *parents, unsigned int jointCount) {
+    assert(jointCount <= POSE_MAX_JOINTS && "skeleton has too many joints");
+    for(unsigned int i = 0; i < gTopologies.size(); ++i) {
+        PoseTopology *topology = &gTopologies[i];
+        if(topology->mJointCount == jointCount &&
+           memcmp(topology->mParents, parents, sizeof(int) * jointCount) == 0) {
+            return topology;
+        }
+    }
+    AllocTagScope tag(ALLOC_TAG_ANIMATION);
+    PoseTopology topology;
+    memset(&topology, 0, sizeof(PoseTopology));
+    memcpy(topology.mParents, parents, sizeof(int) * jointCount);
+    topology.mJointCount = jointCount;
+    gTopologies.push_back(topology);
+    return &gTopologies.back();
+}
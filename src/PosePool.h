@@ -0,0 +1,37 @@
+#ifndef _POSEPOOL_H_
+#define _POSEPOOL_H_
+
+#include <vector>
+#include "Transform.h"
+
+#define POSE_MAX_JOINTS 64
+#define POSE_POOL_BLOCK_SIZE 64 // buffers allocated at once when the pool runs dry
+
+// Joint hierarchy of a skeleton, immutable and shared by all its poses
+struct PoseTopology {
+    int mParents[POSE_MAX_JOINTS];
+    unsigned int mJointCount;
+};
+
+// Hands out fixed capacity (POSE_MAX_JOINTS) 16 byte aligned joint buffers.
+// Freed buffers go to a free list, the pool only touches the heap when it
+// has to grow. Not thread safe
+struct PosePool {
+    std::vector<void *> mBlocks;
+    Transform *mFreeList; // the first bytes of a free buffer point to the next one
+    unsigned int mBufferCount;
+    unsigned int mFreeCount;
+
+    Transform *Allocate();
+    void Free(Transform *buffer);
+    void Shutdown();
+private:
+    void Grow();
+};
+
+PosePool *GetPosePool();
+
+// Returns the registered topology with these parents, registering it the first time
+const PoseTopology *GetPoseTopology(const int *parents, unsigned int jointCount);
+
+#endif
@@ -0,0 +1,165 @@
+#include "Profiler.h"
+
+#ifdef PROFILER_ENABLED
+
+#include "AllocTracker.h"
+#include "Platform.h"
+
+#include <stdio.h>
+#include <atomic>
+
+static_assert((PROFILER_RING_SIZE & (PROFILER_RING_SIZE - 1)) == 0, "the ring size has to be a power of two");
+
+// One ring per thread slot. The owning thread is the only writer, it fills
+// the event and then publishes it by moving mHead forward
+struct ProfileThread {
+    ProfileEvent *mEvents;
+    std::atomic<unsigned long long> mHead;
+    std::atomic<bool> mInUse;
+    unsigned int mDepth;
+    char mName[32];
+};
+
+// Claims a slot on the first marker of a thread and gives it back when the
+// thread ends, short lived workers keep reusing the same few slots
+struct ProfileThreadHandle {
+    ProfileThread *mThread;
+    bool mClaimed;
+
+    ~ProfileThreadHandle();
+};
+
+static ProfileThread gThreads[PROFILER_MAX_THREADS];
+static unsigned long long gStartTime;
+static bool gInitialized;
+static thread_local ProfileThreadHandle gThreadHandle;
+
+static unsigned long long ProfilerNow() {
+    return (unsigned long long)(PlatformGetSeconds() * 1000000000.0);
+}
+
+static ProfileThread *ProfilerGetThread() {
+    if(gThreadHandle.mClaimed || !gInitialized) {
+        return gThreadHandle.mThread;
+    }
+    gThreadHandle.mClaimed = true;
+    for(int i = 0; i < PROFILER_MAX_THREADS; ++i) {
+        bool expected = false;
+        if(gThreads[i].mInUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            gThreads[i].mDepth = 0;
+            snprintf(gThreads[i].mName, sizeof(gThreads[i].mName), "thread %d", i);
+            gThreadHandle.mThread = &gThreads[i];
+            return gThreadHandle.mThread;
+        }
+    }
+    // Out of slots, this thread records nothing
+    return 0;
+}
+
+ProfileThreadHandle::~ProfileThreadHandle() {
+    if(mThread) {
+        mThread->mInUse.store(false, std::memory_order_release);
+        mThread = 0;
+    }
+}
+
+ProfileScope::ProfileScope(const char *name) {
+    mName = name;
+    mThread = ProfilerGetThread();
+    if(mThread) {
+        mThread->mDepth++;
+    }
+    mStart = ProfilerNow();
+}
+
+ProfileScope::~ProfileScope() {
+    unsigned long long end = ProfilerNow();
+    ProfileThread *thread = mThread;
+    if(!thread || !thread->mEvents) {
+        return;
+    }
+    thread->mDepth--;
+    unsigned long long head = thread->mHead.load(std::memory_order_relaxed);
+    ProfileEvent *event = &thread->mEvents[head & (PROFILER_RING_SIZE - 1)];
+    event->mName = mName;
+    event->mStart = mStart;
+    event->mEnd = end;
+    event->mDepth = thread->mDepth;
+    thread->mHead.store(head + 1, std::memory_order_release);
+}
+
+void ProfilerInitialize() {
+    AllocTagScope tag(ALLOC_TAG_GENERAL);
+    for(int i = 0; i < PROFILER_MAX_THREADS; ++i) {
+        ProfileThread *thread = &gThreads[i];
+        thread->mEvents = (ProfileEvent *)TrackedMalloc(sizeof(ProfileEvent) * PROFILER_RING_SIZE, ALLOC_TAG_GENERAL);
+        thread->mHead = 0;
+        thread->mDepth = 0;
+    }
+    gStartTime = ProfilerNow();
+    gInitialized = true;
+}
+
+void ProfilerShutdown() {
+    gInitialized = false;
+    gThreadHandle.mThread = 0;
+    gThreadHandle.mClaimed = false;
+    for(int i = 0; i < PROFILER_MAX_THREADS; ++i) {
+        ProfileThread *thread = &gThreads[i];
+        TrackedFree(thread->mEvents);
+        thread->mEvents = 0;
+        thread->mHead = 0;
+        thread->mInUse = false;
+    }
+}
+
+void ProfilerSetThreadName(const char *name) {
+    ProfileThread *thread = ProfilerGetThread();
+    if(thread) {
+        snprintf(thread->mName, sizeof(thread->mName), "%s", name);
+    }
+}
+
+bool ProfilerWriteChromeTrace(const char *path) {
+    if(!gInitialized) {
+        return false;
+    }
+    FILE *file = fopen(path, "wb");
+    if(!file) {
+        printf("Profiler: cannot write %s\n", path);
+        return false;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    unsigned long long eventCount = 0;
+    for(int i = 0; i < PROFILER_MAX_THREADS; ++i) {
+        ProfileThread *thread = &gThreads[i];
+        unsigned long long head = thread->mHead.load(std::memory_order_acquire);
+        if(head == 0) {
+            continue;
+        }
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", i, thread->mName);
+        first = false;
+        unsigned long long begin = head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+        for(unsigned long long j = begin; j < head; ++j) {
+            ProfileEvent *event = &thread->mEvents[j & (PROFILER_RING_SIZE - 1)];
+            // Events from before ProfilerInitialize would show up at a negative time
+            if(event->mStart < gStartTime) {
+                continue;
+            }
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}}",
+                    event->mName, i,
+                    (double)(event->mStart - gStartTime) / 1000.0,
+                    (double)(event->mEnd - event->mStart) / 1000.0,
+                    event->mDepth);
+            eventCount++;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    printf("Profiler: %llu events written to %s\n", eventCount, path);
+    return true;
+}
+
+#endif
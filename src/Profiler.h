@@ -0,0 +1,63 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+// Scoped CPU markers recorded into a ring buffer per thread and exported as
+// Chrome trace_event JSON (chrome://tracing or ui.perfetto.dev). Debug builds
+// get it from _APP_DEBUG, profiling builds define PROFILER_ENABLED. Anywhere
+// else the markers compile to nothing
+#if !defined(PROFILER_ENABLED) && defined(_APP_DEBUG) && !defined(PROFILER_DISABLED)
+#define PROFILER_ENABLED
+#endif
+
+#define PROFILER_MAX_THREADS 16
+// Events kept per thread, a power of two. Older events get overwritten
+#define PROFILER_RING_SIZE 8192
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef PROFILER_ENABLED
+
+struct ProfileEvent {
+    const char *mName;
+    unsigned long long mStart;
+    unsigned long long mEnd;
+    unsigned int mDepth;
+};
+
+struct ProfileThread;
+
+// Records one complete event from construction to destruction. The name
+// has to outlive the profiler, use string literals
+struct ProfileScope {
+    const char *mName;
+    unsigned long long mStart;
+    ProfileThread *mThread;
+
+    ProfileScope(const char *name);
+    ~ProfileScope();
+};
+
+// Allocates the ring buffers up front, so a new thread never touches the heap
+void ProfilerInitialize();
+void ProfilerShutdown();
+void ProfilerSetThreadName(const char *name);
+// Writes every event still in the rings. Call it while no other thread is recording
+bool ProfilerWriteChromeTrace(const char *path);
+
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+
+#else
+
+inline void ProfilerInitialize() { }
+inline void ProfilerShutdown() { }
+inline void ProfilerSetThreadName(const char *) { }
+inline bool ProfilerWriteChromeTrace(const char *) { return false; }
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+
+#endif
+
+#endif
@@ -146,9 +146,10 @@ quat operator*(const quat& q1, const quat& q2) {
 }
 
 vec3 operator*(const quat &q, const vec3 &v) {
-    return q.vector * 2.0f * dot(q.vector, v) +
-           v * (q.scalar * q.scalar - dot(q.vector, q.vector)) +
-           cross(q.vector, v) * 2.0f * q.scalar;
+    vec3 qv = vec3(q.x, q.y, q.z);
+    return qv * 2.0f * dot(qv, v) +
+           v * (q.w * q.w - dot(qv, qv)) +
+           cross(qv, v) * 2.0f * q.w;
 }
 
 quat mix(const quat &from, const quat &to, float t) {
@@ -160,8 +161,8 @@ quat nlerp(const quat &from, const quat &to, float t) {
 }
 
 quat operator^(const quat &q, float f) {
-    float angle = 2.0f * acosf(q.scalar);
-    vec3 axis = normalized(q.vector);
+    float angle = 2.0f * acosf(q.w);
+    vec3 axis = normalized(vec3(q.x, q.y, q.z));
     float halfCos = cosf(f * angle * 0.5f);
     float halfSin = sinf(f * angle * 0.5f);
     return quat(axis.x * halfSin, axis.y * halfSin, axis.z * halfSin, halfCos);
@@ -207,8 +208,8 @@ mat4 quatToMat4(const quat &q) {
 }
 
 quat mat4ToQuat(const mat4 &m) {
-    vec3 up = normalized(vec3(m.up.x, m.up.y, m.up.z));
-    vec3 forward = normalized(vec3(m.forward.x, m.forward.y, m.forward.z));
+    vec3 up = normalized(vec3(m.yx, m.yy, m.yz));
+    vec3 forward = normalized(vec3(m.zx, m.zy, m.zz));
     vec3 right = cross(up, forward);
     up = cross(forward, right);
     return lookRotation(forward, up);
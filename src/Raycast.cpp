@@ -0,0 +1,575 @@
+#include "Raycast.h"
+#include "AllocTracker.h"
+#include "Profiler.h"
+#include "Arena.h"
+
+#include <cmath>
+#include <float.h>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#define RAY_EPSILON 0.000001f
+#define BVH_LEAF_SIZE 4
+#define BVH_STACK_SIZE 64
+#define RAYS_PER_THREAD 64
+// Fewer rays than this are done before a worker would have woken up
+#define RAYCAST_INLINE_RAYS 256
+
+Ray MakeRay(vec3 origin, vec3 direction, float maxDistance) {
+    Ray result;
+    result.mOrigin = origin;
+    result.mDirection = normalized(direction);
+    result.mMaxDistance = maxDistance;
+    return result;
+}
+
+Ray MakeSegment(vec3 start, vec3 end) {
+    return MakeRay(start, end - start, len(end - start));
+}
+
+// Intersect ray against the slabs of the box, t is the entry distance
+// (0 if the origin is inside the box) and normal the face that was entered
+bool RaycastAABB(const Ray &ray, const AABB_min_max &b, float &t, vec3 &normal) {
+    float tmin = 0.0f;
+    float tmax = ray.mMaxDistance;
+    int axis = -1;
+    float sign = 0.0f;
+    for(int i = 0; i < 3; ++i) {
+        float p = ray.mOrigin.v[i];
+        float d = ray.mDirection.v[i];
+        if(fabsf(d) < RAY_EPSILON) {
+            // Ray is parallel to slab. No hit if origin not within slab
+            if(p < b.min.v[i] || p > b.max.v[i]) return false;
+        }
+        else {
+            // Compute intersection t value of ray with near and far plane of slab
+            float ood = 1.0f / d;
+            float t1 = (b.min.v[i] - p) * ood;
+            float t2 = (b.max.v[i] - p) * ood;
+            float s = -1.0f;
+            // Make t1 be intersection with near plane, t2 with far plane
+            if(t1 > t2) {
+                float tmp = t1; t1 = t2; t2 = tmp;
+                s = 1.0f;
+            }
+            // Compute the intersection of slab intersection intervals
+            if(t1 > tmin) {
+                tmin = t1;
+                axis = i;
+                sign = s;
+            }
+            if(t2 < tmax) tmax = t2;
+            // Exit with no collision as soon as slab intersection becomes empty
+            if(tmin > tmax) return false;
+        }
+    }
+    t = tmin;
+    normal = ray.mDirection * -1.0f;
+    if(axis >= 0) {
+        normal = vec3(0, 0, 0);
+        normal.v[axis] = sign;
+    }
+    return true;
+}
+
+// Same slab test done in the local space of the box
+bool RaycastOBB(const Ray &ray, const OBB &b, float &t, vec3 &normal) {
+    Ray local;
+    vec3 p = ray.mOrigin - b.c;
+    local.mOrigin = vec3(dot(p, b.u[0]), dot(p, b.u[1]), dot(p, b.u[2]));
+    local.mDirection = vec3(dot(ray.mDirection, b.u[0]), dot(ray.mDirection, b.u[1]), dot(ray.mDirection, b.u[2]));
+    local.mMaxDistance = ray.mMaxDistance;
+    AABB_min_max box;
+    box.min = b.e * -1.0f;
+    box.max = b.e;
+    vec3 localNormal;
+    if(!RaycastAABB(local, box, t, localNormal)) {
+        return false;
+    }
+    normal = b.u[0] * localNormal.x + b.u[1] * localNormal.y + b.u[2] * localNormal.z;
+    return true;
+}
+
+// Moller-Trumbore, double sided, normal faces against the ray
+bool RaycastTriangle(const Ray &ray, vec3 a, vec3 b, vec3 c, float &t, vec3 &normal) {
+    vec3 ab = b - a;
+    vec3 ac = c - a;
+    vec3 pvec = cross(ray.mDirection, ac);
+    float det = dot(ab, pvec);
+    if(fabsf(det) < RAY_EPSILON) return false;
+    float invDet = 1.0f / det;
+    vec3 tvec = ray.mOrigin - a;
+    float u = dot(tvec, pvec) * invDet;
+    if(u < 0.0f || u > 1.0f) return false;
+    vec3 qvec = cross(tvec, ab);
+    float v = dot(ray.mDirection, qvec) * invDet;
+    if(v < 0.0f || u + v > 1.0f) return false;
+    float hit = dot(ac, qvec) * invDet;
+    if(hit < 0.0f || hit > ray.mMaxDistance) return false;
+    t = hit;
+    normal = normalized(cross(ab, ac));
+    if(dot(normal, ray.mDirection) > 0.0f) {
+        normal = normal * -1.0f;
+    }
+    return true;
+}
+
+bool RaycastCollider(const Ray &ray, const Collider &collider, float &t, vec3 &normal) {
+    if(collider.mType == COLLIDER_OBB) {
+        return RaycastOBB(ray, collider.mOBB, t, normal);
+    }
+    return RaycastAABB(ray, collider.mAABB, t, normal);
+}
+
+// The box grown by the radius stands in for the Minkowski sum of box and
+// sphere, edges and corners are treated as square which only makes the
+// cast report a hit slightly early around them
+bool SphereCastCollider(const Ray &ray, float radius, const Collider &collider, float &t, vec3 &normal) {
+    vec3 r = vec3(radius, radius, radius);
+    if(collider.mType == COLLIDER_OBB) {
+        OBB grown = collider.mOBB;
+        grown.e = grown.e + r;
+        return RaycastOBB(ray, grown, t, normal);
+    }
+    AABB_min_max grown;
+    grown.min = collider.mAABB.min - r;
+    grown.max = collider.mAABB.max + r;
+    return RaycastAABB(ray, grown, t, normal);
+}
+
+bool SphereCast(const Ray &ray, float radius, const Collider *colliders, int colliderCount, RayHit &hit) {
+    hit.mHit = false;
+    hit.mDistance = ray.mMaxDistance;
+    hit.mCollider = -1;
+    hit.mTriangle = -1;
+    // Bounds of the whole swept sphere, used to reject colliders cheaply
+    vec3 end = ray.mOrigin + ray.mDirection * ray.mMaxDistance;
+    AABB_min_max swept;
+    for(int i = 0; i < 3; ++i) {
+        swept.min.v[i] = std::min(ray.mOrigin.v[i], end.v[i]) - radius;
+        swept.max.v[i] = std::max(ray.mOrigin.v[i], end.v[i]) + radius;
+    }
+    Ray current = ray;
+    for(int i = 0; i < colliderCount; ++i) {
+        const AABB_min_max *bounds = &colliders[i].mAABB;
+        if(swept.max.x < bounds->min.x || swept.min.x > bounds->max.x ||
+           swept.max.y < bounds->min.y || swept.min.y > bounds->max.y ||
+           swept.max.z < bounds->min.z || swept.min.z > bounds->max.z) {
+            continue;
+        }
+        float t;
+        vec3 normal;
+        // t is 0 when the sphere starts inside the collider, it can only move
+        // out of that one so it is not a hit
+        if(SphereCastCollider(current, radius, colliders[i], t, normal) && t > 0.0f) {
+            hit.mHit = true;
+            hit.mDistance = t;
+            hit.mNormal = normal;
+            hit.mCollider = i;
+            current.mMaxDistance = t;
+        }
+    }
+    if(hit.mHit) {
+        hit.mPoint = ray.mOrigin + ray.mDirection * hit.mDistance;
+    }
+    return hit.mHit;
+}
+
+void RaycastWorld::Build(const Collider *colliders, int colliderCount) {
+    PROFILE_SCOPE("RaycastWorld::Build");
+    AllocTagScope tag(ALLOC_TAG_COLLISION);
+    mColliders.assign(colliders, colliders + colliderCount);
+    BuildBVH();
+}
+
+void RaycastWorld::AddTriangles(const vec3 *vertices, const unsigned int *indices, int indexCount) {
+    AllocTagScope tag(ALLOC_TAG_COLLISION);
+    for(int i = 0; i + 2 < indexCount; i += 3) {
+        RaycastTriangleData triangle;
+        triangle.a = vertices[indices[i + 0]];
+        triangle.b = vertices[indices[i + 1]];
+        triangle.c = vertices[indices[i + 2]];
+        mTriangles.push_back(triangle);
+    }
+    BuildBVH();
+}
+
+struct BVHBuildItem {
+    int mPrimitive;
+    AABB_min_max mBounds;
+    vec3 mCentroid;
+};
+
+static AABB_min_max Union(const AABB_min_max &a, const AABB_min_max &b) {
+    AABB_min_max result;
+    for(int i = 0; i < 3; ++i) {
+        result.min.v[i] = a.min.v[i] < b.min.v[i] ? a.min.v[i] : b.min.v[i];
+        result.max.v[i] = a.max.v[i] > b.max.v[i] ? a.max.v[i] : b.max.v[i];
+    }
+    return result;
+}
+
+static void BuildBVHNode(std::vector<BVHNode> &nodes, int nodeIndex, BVHBuildItem *items, int first, int count) {
+    AABB_min_max bounds = items[first].mBounds;
+    AABB_min_max centroidBounds;
+    centroidBounds.min = centroidBounds.max = items[first].mCentroid;
+    for(int i = first + 1; i < first + count; ++i) {
+        bounds = Union(bounds, items[i].mBounds);
+        AABB_min_max centroid;
+        centroid.min = centroid.max = items[i].mCentroid;
+        centroidBounds = Union(centroidBounds, centroid);
+    }
+    nodes[nodeIndex].mBounds = bounds;
+    if(count <= BVH_LEAF_SIZE) {
+        nodes[nodeIndex].mFirst = first;
+        nodes[nodeIndex].mCount = count;
+        return;
+    }
+
+    // Median split along the axis with the largest centroid spread
+    vec3 extent = centroidBounds.max - centroidBounds.min;
+    int axis = 0;
+    if(extent.y > extent.x) axis = 1;
+    if(extent.z > extent.v[axis]) axis = 2;
+    int half = count / 2;
+    std::nth_element(items + first, items + first + half, items + first + count,
+                     [axis](const BVHBuildItem &a, const BVHBuildItem &b) {
+                         return a.mCentroid.v[axis] < b.mCentroid.v[axis];
+                     });
+
+    // Children are allocated next to each other
+    int left = (int)nodes.size();
+    nodes.push_back(BVHNode());
+    nodes.push_back(BVHNode());
+    nodes[nodeIndex].mFirst = left;
+    nodes[nodeIndex].mCount = 0;
+    BuildBVHNode(nodes, left, items, first, half);
+    BuildBVHNode(nodes, left + 1, items, first + half, count - half);
+}
+
+void RaycastWorld::BuildBVH() {
+    AllocTagScope tag(ALLOC_TAG_COLLISION);
+    mNodes.clear();
+    mPrimitives.clear();
+    std::vector<BVHBuildItem> items;
+    for(int i = 0; i < (int)mColliders.size(); ++i) {
+        BVHBuildItem item;
+        item.mPrimitive = i;
+        item.mBounds = mColliders[i].mAABB;
+        item.mCentroid = (item.mBounds.min + item.mBounds.max) * 0.5f;
+        items.push_back(item);
+    }
+    for(int i = 0; i < (int)mTriangles.size(); ++i) {
+        RaycastTriangleData *triangle = &mTriangles[i];
+        BVHBuildItem item;
+        item.mPrimitive = -(i + 1);
+        item.mBounds.min = item.mBounds.max = triangle->a;
+        for(int j = 0; j < 3; ++j) {
+            item.mBounds.min.v[j] = std::min(item.mBounds.min.v[j], std::min(triangle->b.v[j], triangle->c.v[j]));
+            item.mBounds.max.v[j] = std::max(item.mBounds.max.v[j], std::max(triangle->b.v[j], triangle->c.v[j]));
+        }
+        item.mCentroid = (triangle->a + triangle->b + triangle->c) * (1.0f / 3.0f);
+        items.push_back(item);
+    }
+    if(items.empty()) {
+        return;
+    }
+    mNodes.reserve(items.size() * 2);
+    mNodes.push_back(BVHNode());
+    BuildBVHNode(mNodes, 0, &items[0], 0, (int)items.size());
+    mPrimitives.resize(items.size());
+    for(unsigned int i = 0; i < items.size(); ++i) {
+        mPrimitives[i] = items[i].mPrimitive;
+    }
+}
+
+// Slab test against a node using the precomputed inverse direction,
+// infinities from axis aligned rays fall out of the min/max naturally
+static bool RayOverlapsNode(const vec3 &origin, const vec3 &invDir, float maxDistance,
+                            const AABB_min_max &b, float &tEnter) {
+    float tmin = 0.0f;
+    float tmax = maxDistance;
+    for(int i = 0; i < 3; ++i) {
+        float t1 = (b.min.v[i] - origin.v[i]) * invDir.v[i];
+        float t2 = (b.max.v[i] - origin.v[i]) * invDir.v[i];
+        if(t1 != t1) t1 = -FLT_MAX; // 0 * inf when the origin lies on the slab
+        if(t2 != t2) t2 = FLT_MAX;
+        tmin = std::max(tmin, std::min(t1, t2));
+        tmax = std::min(tmax, std::max(t1, t2));
+    }
+    tEnter = tmin;
+    return tmin <= tmax;
+}
+
+static bool TraverseBVH(RaycastWorld *world, const Ray &ray, RayHit &hit, bool anyHit) {
+    hit.mHit = false;
+    hit.mDistance = ray.mMaxDistance;
+    hit.mCollider = -1;
+    hit.mTriangle = -1;
+    if(world->mNodes.empty()) {
+        return false;
+    }
+    vec3 invDir = vec3(1.0f / ray.mDirection.x, 1.0f / ray.mDirection.y, 1.0f / ray.mDirection.z);
+    Ray current = ray;
+    int stack[BVH_STACK_SIZE];
+    int stackCount = 0;
+    stack[stackCount++] = 0;
+    while(stackCount > 0) {
+        BVHNode *node = &world->mNodes[stack[--stackCount]];
+        float tEnter;
+        if(!RayOverlapsNode(current.mOrigin, invDir, current.mMaxDistance, node->mBounds, tEnter)) {
+            continue;
+        }
+        if(node->mCount == 0) {
+            // Visit the nearest child first so the far one is usually culled
+            int left = node->mFirst;
+            int right = node->mFirst + 1;
+            float tLeft, tRight;
+            bool hitLeft = RayOverlapsNode(current.mOrigin, invDir, current.mMaxDistance, world->mNodes[left].mBounds, tLeft);
+            bool hitRight = RayOverlapsNode(current.mOrigin, invDir, current.mMaxDistance, world->mNodes[right].mBounds, tRight);
+            if(hitLeft && hitRight) {
+                if(tLeft < tRight) {
+                    stack[stackCount++] = right;
+                    stack[stackCount++] = left;
+                }
+                else {
+                    stack[stackCount++] = left;
+                    stack[stackCount++] = right;
+                }
+            }
+            else if(hitLeft) {
+                stack[stackCount++] = left;
+            }
+            else if(hitRight) {
+                stack[stackCount++] = right;
+            }
+            continue;
+        }
+        for(int i = node->mFirst; i < node->mFirst + node->mCount; ++i) {
+            int primitive = world->mPrimitives[i];
+            float t;
+            vec3 normal;
+            bool result;
+            if(primitive >= 0) {
+                result = RaycastCollider(current, world->mColliders[primitive], t, normal);
+            }
+            else {
+                RaycastTriangleData *triangle = &world->mTriangles[-primitive - 1];
+                result = RaycastTriangle(current, triangle->a, triangle->b, triangle->c, t, normal);
+            }
+            if(result && t <= current.mMaxDistance) {
+                hit.mHit = true;
+                hit.mDistance = t;
+                hit.mNormal = normal;
+                hit.mCollider = primitive >= 0 ? primitive : -1;
+                hit.mTriangle = primitive < 0 ? -primitive - 1 : -1;
+                if(anyHit) {
+                    hit.mPoint = ray.mOrigin + ray.mDirection * t;
+                    return true;
+                }
+                // Shrink the ray so farther nodes get rejected
+                current.mMaxDistance = t;
+            }
+        }
+    }
+    if(hit.mHit) {
+        hit.mPoint = ray.mOrigin + ray.mDirection * hit.mDistance;
+    }
+    return hit.mHit;
+}
+
+bool RaycastWorld::Raycast(const Ray &ray, RayHit &hit) {
+    return TraverseBVH(this, ray, hit, false);
+}
+
+bool RaycastWorld::AnyHit(const Ray &ray) {
+    RayHit hit;
+    return TraverseBVH(this, ray, hit, true);
+}
+
+static unsigned int SpreadBits10(unsigned int x) {
+    x &= 0x3FF;
+    x = (x | (x << 16)) & 0x030000FF;
+    x = (x | (x << 8)) & 0x0300F00F;
+    x = (x | (x << 4)) & 0x030C30C3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+
+struct RaySortKey {
+    unsigned long long mKey;
+    int mIndex;
+};
+
+static void RaycastRange(RaycastWorld *world, const Ray *rays, RayHit *hits, const RaySortKey *keys, int first, int last) {
+    PROFILE_SCOPE("RaycastRange");
+    for(int i = first; i < last; ++i) {
+        int index = keys[i].mIndex;
+        TraverseBVH(world, rays[index], hits[index], false);
+    }
+}
+
+// Workers sleep until a batch is posted, then claim ranges of it until none
+// are left. A batch is over once every worker has checked in, so none of
+// them is still holding the pointers of a batch when the next is posted
+struct RaycastWorkers {
+    std::vector<std::thread> mThreads;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+    unsigned int mBatch;
+    int mPending;
+    bool mQuit;
+
+    RaycastWorld *mWorld;
+    const Ray *mRays;
+    RayHit *mHits;
+    const RaySortKey *mKeys;
+    int mCount;
+    int mPerRange;
+    int mRangeCount;
+    std::atomic<int> mNextRange;
+};
+
+static void RaycastClaimRanges(RaycastWorkers *workers) {
+    for(;;) {
+        int range = workers->mNextRange.fetch_add(1);
+        if(range >= workers->mRangeCount) {
+            return;
+        }
+        int first = range * workers->mPerRange;
+        int last = std::min(workers->mCount, first + workers->mPerRange);
+        RaycastRange(workers->mWorld, workers->mRays, workers->mHits, workers->mKeys, first, last);
+    }
+}
+
+static void RaycastWorkerMain(RaycastWorkers *workers) {
+    ProfilerSetThreadName("Raycast worker");
+    unsigned int batch = 0;
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(workers->mMutex);
+            workers->mWake.wait(lock, [&] { return workers->mQuit || workers->mBatch != batch; });
+            if(workers->mQuit) {
+                return;
+            }
+            batch = workers->mBatch;
+        }
+        RaycastClaimRanges(workers);
+        std::lock_guard<std::mutex> lock(workers->mMutex);
+        if(--workers->mPending == 0) {
+            workers->mDone.notify_one();
+        }
+    }
+}
+
+void RaycastWorld::StartWorkers(int workerCount) {
+    StopWorkers();
+    if(workerCount <= 0) {
+        workerCount = (int)std::thread::hardware_concurrency() - 1;
+    }
+    if(workerCount <= 0) {
+        return;
+    }
+    AllocTagScope tag(ALLOC_TAG_COLLISION);
+    mWorkers = new RaycastWorkers();
+    mWorkers->mBatch = 0;
+    mWorkers->mPending = 0;
+    mWorkers->mQuit = false;
+    mWorkers->mRangeCount = 0;
+    mWorkers->mNextRange = 0;
+    mWorkers->mThreads.reserve(workerCount);
+    for(int i = 0; i < workerCount; ++i) {
+        mWorkers->mThreads.push_back(std::thread(RaycastWorkerMain, mWorkers));
+    }
+}
+
+void RaycastWorld::StopWorkers() {
+    if(!mWorkers) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mWorkers->mMutex);
+        mWorkers->mQuit = true;
+    }
+    mWorkers->mWake.notify_all();
+    for(unsigned int i = 0; i < mWorkers->mThreads.size(); ++i) {
+        mWorkers->mThreads[i].join();
+    }
+    delete mWorkers;
+    mWorkers = 0;
+}
+
+void RaycastWorld::RaycastBatch(const Ray *rays, RayHit *hits, int count, int threadCount) {
+    PROFILE_SCOPE("RaycastWorld::RaycastBatch");
+    if(count <= 0) {
+        return;
+    }
+    AABB_min_max bounds;
+    bounds.min = bounds.max = rays[0].mOrigin;
+    for(int i = 1; i < count; ++i) {
+        AABB_min_max point;
+        point.min = point.max = rays[i].mOrigin;
+        bounds = Union(bounds, point);
+    }
+    vec3 extent = bounds.max - bounds.min;
+    vec3 scale;
+    for(int i = 0; i < 3; ++i) {
+        scale.v[i] = extent.v[i] > RAY_EPSILON ? 1023.0f / extent.v[i] : 0.0f;
+    }
+
+    // Sort by direction octant first and morton code of the origin second,
+    // neighbouring rays then walk the same BVH nodes. The keys live in the
+    // scratch arena so a batch every frame stays off the heap
+    ScratchScope scratch;
+    RaySortKey *keys = scratch.mArena->PushArray<RaySortKey>(count);
+    for(int i = 0; i < count; ++i) {
+        const Ray *ray = &rays[i];
+        unsigned int octant = (ray->mDirection.x < 0.0f ? 1 : 0) |
+                              (ray->mDirection.y < 0.0f ? 2 : 0) |
+                              (ray->mDirection.z < 0.0f ? 4 : 0);
+        vec3 p = (ray->mOrigin - bounds.min) * scale;
+        unsigned int morton = (SpreadBits10((unsigned int)p.x) << 2) |
+                              (SpreadBits10((unsigned int)p.y) << 1) |
+                              SpreadBits10((unsigned int)p.z);
+        keys[i].mKey = ((unsigned long long)octant << 32) | morton;
+        keys[i].mIndex = i;
+    }
+    std::sort(keys, keys + count, [](const RaySortKey &a, const RaySortKey &b) {
+        return a.mKey < b.mKey;
+    });
+
+    int workerCount = mWorkers ? (int)mWorkers->mThreads.size() : 0;
+    if(threadCount <= 0 || threadCount > workerCount + 1) {
+        threadCount = workerCount + 1;
+    }
+    int maxThreads = (count + RAYS_PER_THREAD - 1) / RAYS_PER_THREAD;
+    if(threadCount > maxThreads) threadCount = maxThreads;
+    if(threadCount <= 1 || count < RAYCAST_INLINE_RAYS) {
+        RaycastRange(this, rays, hits, keys, 0, count);
+        return;
+    }
+
+    // The calling thread claims ranges too, then waits for the workers to check in
+    RaycastWorkers *workers = mWorkers;
+    {
+        std::lock_guard<std::mutex> lock(workers->mMutex);
+        workers->mWorld = this;
+        workers->mRays = rays;
+        workers->mHits = hits;
+        workers->mKeys = keys;
+        workers->mCount = count;
+        workers->mPerRange = (count + threadCount - 1) / threadCount;
+        workers->mRangeCount = (count + workers->mPerRange - 1) / workers->mPerRange;
+        workers->mNextRange = 0;
+        workers->mPending = workerCount;
+        workers->mBatch++;
+    }
+    workers->mWake.notify_all();
+    RaycastClaimRanges(workers);
+    std::unique_lock<std::mutex> lock(workers->mMutex);
+    workers->mDone.wait(lock, [&] { return workers->mPending == 0; });
+}
@@ -0,0 +1,74 @@
+#ifndef _RAYCAST_H_
+#define _RAYCAST_H_
+
+#include <vector>
+#include "Collision.h"
+
+// mDirection has to be normalized, a segment is a ray with a finite mMaxDistance
+struct Ray {
+    vec3 mOrigin;
+    vec3 mDirection;
+    float mMaxDistance;
+};
+
+struct RayHit {
+    bool mHit;
+    float mDistance;
+    vec3 mPoint;
+    vec3 mNormal;
+    int mCollider; // index of the collider hit or -1
+    int mTriangle; // index of the triangle hit or -1
+};
+
+Ray MakeRay(vec3 origin, vec3 direction, float maxDistance);
+Ray MakeSegment(vec3 start, vec3 end);
+
+bool RaycastAABB(const Ray &ray, const AABB_min_max &b, float &t, vec3 &normal);
+bool RaycastOBB(const Ray &ray, const OBB &b, float &t, vec3 &normal);
+bool RaycastTriangle(const Ray &ray, vec3 a, vec3 b, vec3 c, float &t, vec3 &normal);
+bool RaycastCollider(const Ray &ray, const Collider &collider, float &t, vec3 &normal);
+bool SphereCastCollider(const Ray &ray, float radius, const Collider &collider, float &t, vec3 &normal);
+// Colliders the sphere already overlaps at the ray origin are ignored
+bool SphereCast(const Ray &ray, float radius, const Collider *colliders, int colliderCount, RayHit &hit);
+
+struct RaycastTriangleData {
+    vec3 a;
+    vec3 b;
+    vec3 c;
+};
+
+struct BVHNode {
+    AABB_min_max mBounds;
+    int mFirst; // first child for inner nodes, first primitive for leafs
+    int mCount; // 0 for inner nodes
+};
+
+struct RaycastWorkers;
+
+// Owns a copy of the colliders and triangles, rebuild it when they change
+struct RaycastWorld {
+    std::vector<Collider> mColliders;
+    std::vector<RaycastTriangleData> mTriangles;
+    std::vector<BVHNode> mNodes;
+    std::vector<int> mPrimitives; // >= 0 collider index, < 0 -(triangle index + 1)
+    RaycastWorkers *mWorkers;
+
+    RaycastWorld() : mWorkers(0) { }
+
+    void Build(const Collider *colliders, int colliderCount);
+    void AddTriangles(const vec3 *vertices, const unsigned int *indices, int indexCount);
+    void BuildBVH();
+
+    bool Raycast(const Ray &ray, RayHit &hit);
+    bool AnyHit(const Ray &ray);
+    // Rays are sorted by direction octant and origin for coherence and split
+    // between up to threadCount threads (0 uses every worker). Small batches
+    // and batches before StartWorkers run on the calling thread
+    void RaycastBatch(const Ray *rays, RayHit *hits, int count, int threadCount);
+    // Threads kept waiting for batches, workerCount 0 uses one less than the
+    // hardware thread count since the calling thread takes a range too
+    void StartWorkers(int workerCount);
+    void StopWorkers();
+};
+
+#endif
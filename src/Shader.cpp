@@ -1,37 +1,16 @@
 #include "Shader.h"
-#include <windows.h>
 #include <assert.h>
 #include <glad/glad.h>
 #include <stdio.h>
-
-FileResult ReadFile(const char* filepath)
-{
-    FileResult result = {};
-    HANDLE file_handle = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
-    if (file_handle != INVALID_HANDLE_VALUE) {
-        LARGE_INTEGER file_size;
-        if (GetFileSizeEx(file_handle, &file_size)) {
-            assert(file_size.QuadPart <= 0xFFFFFFFF);
-            result.data = malloc((size_t)file_size.QuadPart + 1);
-            result.size = (size_t)file_size.QuadPart;
-            if (ReadFile(file_handle, result.data, (DWORD)result.size, 0, 0)) {
-                unsigned char* last_byte = (unsigned char*)result.data + result.size;
-                *last_byte = 0;
-                return result;
-            }
-        }
-    }
-    FileResult zeroResult = {};
-    return zeroResult;
-}
-
-void DeleteFile(FileResult *file) {
-    if(file->data) free(file->data);
-}
+#include "AllocTracker.h"
+#include "Platform.h"
+#include "Profiler.h"
 
 void Shader::Initialize(const char *vertexPath, const char *fragmentPath) {
-    FileResult vertexResult = ReadFile(vertexPath);
-    FileResult fragmentResult = ReadFile(fragmentPath);
+    PROFILE_SCOPE("Shader::Initialize");
+    AllocTagScope tag(ALLOC_TAG_SHADER);
+    FileResult vertexResult = PlatformReadFile(vertexPath);
+    FileResult fragmentResult = PlatformReadFile(fragmentPath);
     const char *vertexSrc = (const char *)vertexResult.data;
     const char *fragmentSrc = (const char *)fragmentResult.data;
 
@@ -74,8 +53,8 @@ void Shader::Initialize(const char *vertexPath, const char *fragmentPath) {
     glDeleteShader(vertexId);
     glDeleteShader(fragmentId);
     
-    DeleteFile(&vertexResult);
-    DeleteFile(&fragmentResult);
+    PlatformFreeFile(&vertexResult);
+    PlatformFreeFile(&fragmentResult);
 }
 
 void Shader::Shutdown() {
@@ -120,8 +99,8 @@ void Shader::UpdateIntArray(const char* varName, int size, int* array) {
     glUniform1iv(varLoc, size, array);
 }
 
-void Shader::UpdateMat4Array(const char* varName, int size, mat4* array) {
+void Shader::UpdateMat4Array(const char* varName, int size, const mat4* array) {
     int varLoc = glGetUniformLocation(mProgram, varName);
     Bind();
-    glUniformMatrix4fv(varLoc, size, false, (float *)&array[0]);
+    glUniformMatrix4fv(varLoc, size, false, (const float *)&array[0]);
 }
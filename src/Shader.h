@@ -5,11 +5,6 @@
 #include "Vec3.h"
 #include "Mat4.h"
 
-struct FileResult {
-    void *data;
-    size_t size;
-};
-
 struct Shader {
     unsigned int mProgram;
     
@@ -23,7 +18,7 @@ struct Shader {
     void UpdateMat4(const char* varName, mat4 matrix);
     void UpdateInt(const char* varName, int value);
     void UpdateIntArray(const char* varName, int size, int* array);
-    void UpdateMat4Array(const char* varName, int size, mat4* array);
+    void UpdateMat4Array(const char* varName, int size, const mat4* array);
 };
 
 #endif
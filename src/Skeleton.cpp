@@ -1,6 +1,8 @@
 #include "Skeleton.h"
+#include "AllocTracker.h"
 
 void Skeleton::SetPoses(const Pose& rest, const Pose& bind) {
+    AllocTagScope tag(ALLOC_TAG_ANIMATION);
     mRestPose = rest;
     mBindPose = bind;
 
@@ -1,34 +1,209 @@
 #ifndef _SLOTMAP_H_
 #define _SLOTMAP_H_
 
-// TODO: test for slotmap data structure
-#include "Vec3.h"
-
-struct TransformComponent {
-    const char *name;
-    vec3 mPosition;
-};
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <stddef.h>
+#include <assert.h>
 
 struct SlotmapKey {
     unsigned int mId;
-    unsigned int mGen; 
+    unsigned int mGen;
 };
 
-// try for 100 components
-struct TransformSlotmap {
-    unsigned int mCount;
-    unsigned int mGeneration;
+// Sparse side of a slot map: maps keys to dense indices, hands out keys
+// from a free list and bumps the generation of a slot when it is freed so
+// stale keys are detected. Keys stay valid when the storage grows, pointers
+// to the dense data do not
+struct SlotmapIndex {
+    std::vector<SlotmapKey> mIndices; // mId is the dense index, or the next free slot
+    std::vector<unsigned int> mErase; // dense index -> slot
     unsigned int mFreeList;
 
-    SlotmapKey mIndices[100];
-    TransformComponent mData[100];
-    unsigned int mErase[100];
-    
-    void Initialize();
-    SlotmapKey AddComponent(TransformComponent component);
-    void RemoveComponent(SlotmapKey key);
-    TransformComponent GetComponent(SlotmapKey key);
+    void Initialize(unsigned int capacity) {
+        mIndices.clear();
+        mErase.clear();
+        mIndices.reserve(capacity);
+        mErase.reserve(capacity);
+        mFreeList = 0xFFFFFFFF;
+    }
+
+    SlotmapKey Allocate() {
+        unsigned int slot;
+        if(mFreeList != 0xFFFFFFFF) {
+            slot = mFreeList;
+            mFreeList = mIndices[slot].mId;
+        }
+        else {
+            slot = (unsigned int)mIndices.size();
+            SlotmapKey empty = {0, 0};
+            mIndices.push_back(empty);
+        }
+        mIndices[slot].mId = (unsigned int)mErase.size();
+        mErase.push_back(slot);
+        SlotmapKey key = {slot, mIndices[slot].mGen};
+        return key;
+    }
+
+    // Returns the dense index the caller has to fill by moving the last
+    // element into it, the last element is the one that gets popped
+    unsigned int Free(SlotmapKey key) {
+        assert(IsValid(key) && "try to delete a entity already gone");
+        unsigned int dataIndex = mIndices[key.mId].mId;
+        unsigned int last = (unsigned int)mErase.size() - 1;
+        if(dataIndex != last) {
+            mErase[dataIndex] = mErase[last];
+            mIndices[mErase[dataIndex]].mId = dataIndex;
+        }
+        mErase.pop_back();
+        mIndices[key.mId].mId = mFreeList;
+        mIndices[key.mId].mGen++;
+        mFreeList = key.mId;
+        return dataIndex;
+    }
+
+    bool IsValid(SlotmapKey key) {
+        return key.mId < mIndices.size() && mIndices[key.mId].mGen == key.mGen &&
+               mIndices[key.mId].mId < mErase.size() && mErase[mIndices[key.mId].mId] == key.mId;
+    }
+
+    unsigned int DenseIndex(SlotmapKey key) {
+        assert(IsValid(key) && "ERROR wrong element!!!");
+        return mIndices[key.mId].mId;
+    }
+
+    SlotmapKey GetKey(unsigned int denseIndex) {
+        unsigned int slot = mErase[denseIndex];
+        SlotmapKey key = {slot, mIndices[slot].mGen};
+        return key;
+    }
+
+    unsigned int Size() {
+        return (unsigned int)mErase.size();
+    }
 };
 
+// Slot map storing T packed in one array, iterate with Data() and Size()
+template <typename T>
+struct Slotmap {
+    SlotmapIndex mIndex;
+    std::vector<T> mData;
+
+    void Initialize(unsigned int capacity = 0) {
+        mIndex.Initialize(capacity);
+        mData.clear();
+        mData.reserve(capacity);
+    }
+
+    SlotmapKey AddComponent(const T &component) {
+        SlotmapKey key = mIndex.Allocate();
+        mData.push_back(component);
+        return key;
+    }
+
+    void RemoveComponent(SlotmapKey key) {
+        unsigned int dataIndex = mIndex.Free(key);
+        if(dataIndex != mData.size() - 1) {
+            mData[dataIndex] = std::move(mData.back());
+        }
+        mData.pop_back();
+    }
+
+    // Null if the key is stale
+    T *GetComponent(SlotmapKey key) {
+        if(!mIndex.IsValid(key)) {
+            return 0;
+        }
+        return &mData[mIndex.DenseIndex(key)];
+    }
+
+    bool IsValid(SlotmapKey key) { return mIndex.IsValid(key); }
+    SlotmapKey GetKey(unsigned int denseIndex) { return mIndex.GetKey(denseIndex); }
+    unsigned int Size() { return (unsigned int)mData.size(); }
+    T *Data() { return mData.empty() ? 0 : &mData[0]; }
+    T &operator[](unsigned int denseIndex) { return mData[denseIndex]; }
+};
+
+// Slot map storing every field in its own packed column (SoA),
+// Column<I>() gives the contiguous array of the I-th field
+template <typename... Columns>
+struct SlotmapSoA {
+    SlotmapIndex mIndex;
+    std::tuple<std::vector<Columns>...> mColumns;
+
+    void Initialize(unsigned int capacity = 0) {
+        mIndex.Initialize(capacity);
+        ForEachColumn(ClearColumn(capacity));
+    }
+
+    SlotmapKey AddComponent(const Columns&... values) {
+        SlotmapKey key = mIndex.Allocate();
+        PushColumns(std::index_sequence_for<Columns...>(), values...);
+        return key;
+    }
+
+    void RemoveComponent(SlotmapKey key) {
+        unsigned int dataIndex = mIndex.Free(key);
+        ForEachColumn(RemoveFromColumn(dataIndex));
+    }
+
+    bool IsValid(SlotmapKey key) { return mIndex.IsValid(key); }
+    unsigned int DenseIndex(SlotmapKey key) { return mIndex.DenseIndex(key); }
+    SlotmapKey GetKey(unsigned int denseIndex) { return mIndex.GetKey(denseIndex); }
+    unsigned int Size() { return mIndex.Size(); }
+
+    template <unsigned int I>
+    typename std::tuple_element<I, std::tuple<Columns...> >::type *Column() {
+        auto &column = std::get<I>(mColumns);
+        return column.empty() ? 0 : &column[0];
+    }
+
+    template <unsigned int I>
+    typename std::tuple_element<I, std::tuple<Columns...> >::type *Get(SlotmapKey key) {
+        if(!mIndex.IsValid(key)) {
+            return 0;
+        }
+        return &std::get<I>(mColumns)[mIndex.DenseIndex(key)];
+    }
+
+private:
+    struct ClearColumn {
+        unsigned int mCapacity;
+        ClearColumn(unsigned int capacity) : mCapacity(capacity) { }
+        template <typename V> void operator()(V &column) {
+            column.clear();
+            column.reserve(mCapacity);
+        }
+    };
+
+    struct RemoveFromColumn {
+        unsigned int mIndex;
+        RemoveFromColumn(unsigned int index) : mIndex(index) { }
+        template <typename V> void operator()(V &column) {
+            if(mIndex != column.size() - 1) {
+                column[mIndex] = std::move(column.back());
+            }
+            column.pop_back();
+        }
+    };
+
+    template <typename F>
+    void ForEachColumn(F f) {
+        ForEachColumn(f, std::index_sequence_for<Columns...>());
+    }
+
+    template <typename F, size_t... I>
+    void ForEachColumn(F f, std::index_sequence<I...>) {
+        int expand[] = { 0, (f(std::get<I>(mColumns)), 0)... };
+        (void)expand;
+    }
+
+    template <size_t... I>
+    void PushColumns(std::index_sequence<I...>, const Columns&... values) {
+        int expand[] = { 0, (std::get<I>(mColumns).push_back(values), 0)... };
+        (void)expand;
+    }
+};
 
 #endif
@@ -0,0 +1,192 @@
+#include "Snapshot.h"
+#include "Arena.h"
+#include "AllocTracker.h"
+
+#include <string.h>
+#include <assert.h>
+
+#define SNAPSHOT_MAX_DELTAS (SNAPSHOT_RING_SIZE - 1)
+// Shorter runs of unchanged bytes are cheaper to store as literals
+#define SNAPSHOT_MIN_ZERO_RUN 4
+#define SNAPSHOT_MAX_RUN 0xFFFF
+
+// Tokens of (unchanged byte count, changed byte count, changed bytes XOR)
+// with both counts as 16 bit. Returns the encoded size
+static unsigned int EncodeDelta(const unsigned char *a, const unsigned char *b, unsigned int size, unsigned char *out) {
+    unsigned char *dst = out;
+    unsigned int i = 0;
+    while(i < size) {
+        unsigned int zeroRun = 0;
+        while(i + zeroRun < size && zeroRun < SNAPSHOT_MAX_RUN && a[i + zeroRun] == b[i + zeroRun]) {
+            zeroRun++;
+        }
+        i += zeroRun;
+        unsigned int literalCount = 0;
+        while(i + literalCount < size && literalCount < SNAPSHOT_MAX_RUN) {
+            unsigned int j = i + literalCount;
+            if(a[j] != b[j]) {
+                literalCount++;
+                continue;
+            }
+            unsigned int run = 0;
+            while(j + run < size && run < SNAPSHOT_MIN_ZERO_RUN && a[j + run] == b[j + run]) {
+                run++;
+            }
+            if(run >= SNAPSHOT_MIN_ZERO_RUN || j + run == size || literalCount + run > SNAPSHOT_MAX_RUN) {
+                break;
+            }
+            literalCount += run;
+        }
+        unsigned short counts[2] = { (unsigned short)zeroRun, (unsigned short)literalCount };
+        memcpy(dst, counts, sizeof(counts));
+        dst += sizeof(counts);
+        for(unsigned int k = 0; k < literalCount; ++k) {
+            *dst++ = a[i + k] ^ b[i + k];
+        }
+        i += literalCount;
+    }
+    return (unsigned int)(dst - out);
+}
+
+// XORs the delta into data, turning one side of the pair into the other
+static void ApplyDelta(unsigned char *data, const unsigned char *delta, unsigned int deltaSize) {
+    const unsigned char *src = delta;
+    const unsigned char *end = delta + deltaSize;
+    unsigned int position = 0;
+    while(src < end) {
+        unsigned short counts[2];
+        memcpy(counts, src, sizeof(counts));
+        src += sizeof(counts);
+        position += counts[0];
+        for(unsigned int k = 0; k < counts[1]; ++k) {
+            data[position + k] ^= src[k];
+        }
+        src += counts[1];
+        position += counts[1];
+    }
+}
+
+void SnapshotRing::Initialize() {
+    AllocTagScope tag(ALLOC_TAG_GENERAL);
+    mBuffer = (unsigned char *)TrackedMalloc(SNAPSHOT_DELTA_BUFFER_SIZE, ALLOC_TAG_GENERAL);
+    mWrite = 0;
+    mTail = 0;
+    mFirst = 0;
+    mDeltaCount = 0;
+    mHasLatest = false;
+}
+
+void SnapshotRing::Shutdown() {
+    TrackedFree(mBuffer);
+    mBuffer = 0;
+    mDeltaCount = 0;
+    mHasLatest = false;
+}
+
+void SnapshotRing::Push(const GameSnapshot *snapshot) {
+    if(mHasLatest) {
+        ScratchScope scratch;
+        // Worst case every token carries its 4 byte header for at least 4 literals
+        unsigned char *encoded = (unsigned char *)GetScratchArena()->Push(sizeof(GameSnapshot) * 2 + 64);
+        unsigned int size = EncodeDelta((unsigned char *)&mLatest, (const unsigned char *)snapshot, sizeof(GameSnapshot), encoded);
+        if(mDeltaCount == SNAPSHOT_MAX_DELTAS) {
+            DropOldest();
+        }
+        unsigned char *dst = Reserve(size);
+        memcpy(dst, encoded, size);
+        SnapshotDelta *delta = &mDeltas[(mFirst + mDeltaCount) % SNAPSHOT_MAX_DELTAS];
+        delta->mOffset = (unsigned int)(dst - mBuffer);
+        delta->mSize = size;
+        mDeltaCount++;
+    }
+    memcpy((void *)&mLatest, snapshot, sizeof(GameSnapshot));
+    mHasLatest = true;
+}
+
+unsigned int SnapshotRing::Count() {
+    return mHasLatest ? mDeltaCount + 1 : 0;
+}
+
+bool SnapshotRing::Get(unsigned int age, GameSnapshot *out) {
+    if(!mHasLatest || age > mDeltaCount) {
+        return false;
+    }
+    memcpy((void *)out, &mLatest, sizeof(GameSnapshot));
+    for(unsigned int i = 0; i < age; ++i) {
+        SnapshotDelta *delta = GetDelta(i);
+        ApplyDelta((unsigned char *)out, mBuffer + delta->mOffset, delta->mSize);
+    }
+    return true;
+}
+
+bool SnapshotRing::Rewind(unsigned int age, GameSnapshot *out) {
+    if(!Get(age, out)) {
+        return false;
+    }
+    for(unsigned int i = 0; i < age; ++i) {
+        SnapshotDelta *delta = GetDelta(0);
+        mWrite = delta->mOffset;
+        mDeltaCount--;
+    }
+    if(mDeltaCount == 0) {
+        mWrite = 0;
+        mTail = 0;
+    }
+    memcpy((void *)&mLatest, out, sizeof(GameSnapshot));
+    return true;
+}
+
+size_t SnapshotRing::BytesUsed() {
+    size_t bytes = mHasLatest ? sizeof(GameSnapshot) : 0;
+    for(unsigned int i = 0; i < mDeltaCount; ++i) {
+        bytes += GetDelta(i)->mSize;
+    }
+    return bytes;
+}
+
+unsigned char *SnapshotRing::Reserve(unsigned int size) {
+    assert(size <= SNAPSHOT_DELTA_BUFFER_SIZE && "snapshot delta larger than the ring");
+    for(;;) {
+        if(mDeltaCount == 0) {
+            mWrite = 0;
+            mTail = 0;
+        }
+        unsigned int offset = mWrite;
+        bool fits = false;
+        if(mDeltaCount == 0 || mWrite > mTail) {
+            // Free space at the end and in front of the oldest delta
+            if(mWrite + size <= SNAPSHOT_DELTA_BUFFER_SIZE) {
+                fits = true;
+            }
+            else if(size <= mTail) {
+                offset = 0;
+                fits = true;
+            }
+        }
+        else if(mWrite + size <= mTail) {
+            // Wrapped, the only free space is up to the oldest delta
+            fits = true;
+        }
+        if(fits) {
+            mWrite = offset + size;
+            return mBuffer + offset;
+        }
+        DropOldest();
+    }
+}
+
+void SnapshotRing::DropOldest() {
+    mFirst = (mFirst + 1) % SNAPSHOT_MAX_DELTAS;
+    mDeltaCount--;
+    if(mDeltaCount == 0) {
+        mWrite = 0;
+        mTail = 0;
+    }
+    else {
+        mTail = mDeltas[mFirst].mOffset;
+    }
+}
+
+SnapshotDelta *SnapshotRing::GetDelta(unsigned int age) {
+    return &mDeltas[(mFirst + mDeltaCount - 1 - age) % SNAPSHOT_MAX_DELTAS];
+}
@@ -0,0 +1,102 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include "Defines.h"
+#include "Transform.h"
+#include "Camera.h"
+#include "Ecs.h"
+#include "CrossFadeController.h"
+
+#define GAME_SNAPSHOT_MAX_CHARACTERS 128
+// Snapshots kept by the ring, the newest is stored whole and the rest as deltas
+#define SNAPSHOT_RING_SIZE 600
+#define SNAPSHOT_DELTA_BUFFER_SIZE Megabyte(2)
+
+struct CharacterSnapshot {
+    Entity mEntity;
+    Transform mTransform;
+    vec3 mVelocity;
+    unsigned int mIsJumping;
+    unsigned int mClip;
+    float mPlayback;
+    float mSpeed;
+    float mPendingTime;
+};
+
+#define SNAPSHOT_NO_CLIP 0xFFFFFFFF
+
+// Clips are indices into Game::mClips, or SNAPSHOT_NO_CLIP
+struct CrossFadeSnapshot {
+    unsigned int mClip;
+    float mTime;
+    unsigned int mTargetCount;
+    struct {
+        unsigned int mClip;
+        float mTime;
+        float mDuration;
+        float mElapsed;
+    } mTargets[CROSSFADE_MAX_TARGETS];
+};
+
+// Everything Update needs to continue from a frame, flat so it can be
+// copied and compared byte by byte. Unused characters stay zeroed
+struct GameSnapshot {
+    Transform mPlayerTransform;
+    vec3 mPlayerVelocity;
+    vec3 mPlayerDirection;
+    vec3 mPlayerRight;
+    float mPlayerRotation;
+    float mPlayerRotOffset;
+    unsigned int mPlayerJumping;
+    unsigned int mPlayerIsJumping;
+    unsigned int mCurrentAnim;
+    float mPlayerSpeed;
+    float mLocomotionPhase;
+    CrossFadeSnapshot mFade;
+    // The player collision reads last frame's closest points
+    vec3 mCollisionPoints[4];
+    Camera mCamera;
+    float mCubemapTimer;
+
+    unsigned int mCharacterCount;
+    CharacterSnapshot mCharacters[GAME_SNAPSHOT_MAX_CHARACTERS];
+};
+
+struct SnapshotDelta {
+    unsigned int mOffset;
+    unsigned int mSize;
+};
+
+// History of the last SNAPSHOT_RING_SIZE snapshots. Each older snapshot is
+// kept as the XOR against the one after it, run length encoded, so the
+// bytes that did not change between two frames cost almost nothing. The
+// deltas live in one circular byte buffer, the oldest get dropped when it
+// runs out of room
+struct SnapshotRing {
+    GameSnapshot mLatest;
+    unsigned char *mBuffer;
+    unsigned int mWrite;
+    unsigned int mTail;
+    SnapshotDelta mDeltas[SNAPSHOT_RING_SIZE - 1];
+    unsigned int mFirst;
+    unsigned int mDeltaCount;
+    bool mHasLatest;
+
+    void Initialize();
+    void Shutdown();
+    void Push(const GameSnapshot *snapshot);
+    // Snapshots stored, the latest included
+    unsigned int Count();
+    // age 0 is the latest snapshot, age 1 the one before it and so on
+    bool Get(unsigned int age, GameSnapshot *out);
+    // Like Get but also forgets every snapshot newer than age, for rollback
+    bool Rewind(unsigned int age, GameSnapshot *out);
+    size_t BytesUsed();
+
+private:
+    unsigned char *Reserve(unsigned int size);
+    void DropOldest();
+    SnapshotDelta *GetDelta(unsigned int age);
+};
+
+#endif
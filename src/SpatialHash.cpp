@@ -0,0 +1,174 @@
+#include "SpatialHash.h"
+#include "AllocTracker.h"
+
+#include <cmath>
+
+#define SPATIAL_HASH_EMPTY 0xFFFFFFFF
+
+static unsigned int HashCell(int x, int y, int z) {
+    return ((unsigned int)x * 73856093u) ^ ((unsigned int)y * 19349663u) ^ ((unsigned int)z * 83492791u);
+}
+
+void SpatialHash::Initialize(float cellSize) {
+    mCellSize = cellSize;
+    mInvCellSize = 1.0f / cellSize;
+    mMaxRadius = 0.0f;
+    mCells.clear();
+    mUsedCells.clear();
+}
+
+unsigned int SpatialHash::FindCell(int x, int y, int z, bool insert) {
+    unsigned int mask = (unsigned int)mCells.size() - 1;
+    unsigned int slot = HashCell(x, y, z) & mask;
+    // Linear probing, the table is kept at most half full
+    for(;;) {
+        SpatialHashCell *cell = &mCells[slot];
+        if(!cell->mUsed) {
+            if(!insert) {
+                return SPATIAL_HASH_EMPTY;
+            }
+            cell->mX = x;
+            cell->mY = y;
+            cell->mZ = z;
+            cell->mStart = 0;
+            cell->mCount = 0;
+            cell->mUsed = true;
+            mUsedCells.push_back(slot);
+            return slot;
+        }
+        if(cell->mX == x && cell->mY == y && cell->mZ == z) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+void SpatialHash::Build(const vec3 *positions, const float *radii, unsigned int count) {
+    AllocTagScope tag(ALLOC_TAG_COLLISION);
+    // Only clear the slots touched by the last build
+    for(unsigned int i = 0; i < mUsedCells.size(); ++i) {
+        mCells[mUsedCells[i]].mUsed = false;
+    }
+    mUsedCells.clear();
+    unsigned int tableSize = 16;
+    while(tableSize < count * 2) {
+        tableSize <<= 1;
+    }
+    if(mCells.size() != tableSize) {
+        SpatialHashCell empty = {};
+        mCells.assign(tableSize, empty);
+    }
+
+    // Count objects per cell
+    mObjectCell.resize(count);
+    mMaxRadius = 0.0f;
+    for(unsigned int i = 0; i < count; ++i) {
+        vec3 p = positions[i];
+        int x = (int)floorf(p.x * mInvCellSize);
+        int y = (int)floorf(p.y * mInvCellSize);
+        int z = (int)floorf(p.z * mInvCellSize);
+        unsigned int slot = FindCell(x, y, z, true);
+        mCells[slot].mCount++;
+        mObjectCell[i] = slot;
+        float radius = radii ? radii[i] : 0.0f;
+        if(radius > mMaxRadius) mMaxRadius = radius;
+    }
+
+    // Prefix sum gives each cell its range in the sorted arrays
+    unsigned int offset = 0;
+    for(unsigned int i = 0; i < mUsedCells.size(); ++i) {
+        SpatialHashCell *cell = &mCells[mUsedCells[i]];
+        cell->mStart = offset;
+        offset += cell->mCount;
+        cell->mCount = 0;
+    }
+
+    // Scatter
+    mSortedIds.resize(count);
+    mSortedPositions.resize(count);
+    mSortedRadii.resize(count);
+    for(unsigned int i = 0; i < count; ++i) {
+        SpatialHashCell *cell = &mCells[mObjectCell[i]];
+        unsigned int index = cell->mStart + cell->mCount++;
+        mSortedIds[index] = i;
+        mSortedPositions[index] = positions[i];
+        mSortedRadii[index] = radii ? radii[i] : 0.0f;
+    }
+}
+
+int SpatialHash::QueryPoint(vec3 p, unsigned int *out, int maxOut) {
+    return QueryRadius(p, 0.0f, out, maxOut);
+}
+
+int SpatialHash::QueryBox(const AABB_min_max &box, unsigned int *out, int maxOut) {
+    int found = 0;
+    if(mUsedCells.empty()) {
+        return 0;
+    }
+    int minX = (int)floorf((box.min.x - mMaxRadius) * mInvCellSize);
+    int minY = (int)floorf((box.min.y - mMaxRadius) * mInvCellSize);
+    int minZ = (int)floorf((box.min.z - mMaxRadius) * mInvCellSize);
+    int maxX = (int)floorf((box.max.x + mMaxRadius) * mInvCellSize);
+    int maxY = (int)floorf((box.max.y + mMaxRadius) * mInvCellSize);
+    int maxZ = (int)floorf((box.max.z + mMaxRadius) * mInvCellSize);
+    for(int z = minZ; z <= maxZ; ++z) {
+        for(int y = minY; y <= maxY; ++y) {
+            for(int x = minX; x <= maxX; ++x) {
+                unsigned int slot = FindCell(x, y, z, false);
+                if(slot == SPATIAL_HASH_EMPTY) {
+                    continue;
+                }
+                SpatialHashCell *cell = &mCells[slot];
+                for(unsigned int i = cell->mStart; i < cell->mStart + cell->mCount; ++i) {
+                    // Sphere against box
+                    float r = mSortedRadii[i];
+                    if(SqDistPointAABB(mSortedPositions[i], box) > r * r) {
+                        continue;
+                    }
+                    if(found >= maxOut) {
+                        return found;
+                    }
+                    out[found++] = mSortedIds[i];
+                }
+            }
+        }
+    }
+    return found;
+}
+
+int SpatialHash::QueryRadius(vec3 center, float radius, unsigned int *out, int maxOut) {
+    int found = 0;
+    if(mUsedCells.empty()) {
+        return 0;
+    }
+    float reach = radius + mMaxRadius;
+    int minX = (int)floorf((center.x - reach) * mInvCellSize);
+    int minY = (int)floorf((center.y - reach) * mInvCellSize);
+    int minZ = (int)floorf((center.z - reach) * mInvCellSize);
+    int maxX = (int)floorf((center.x + reach) * mInvCellSize);
+    int maxY = (int)floorf((center.y + reach) * mInvCellSize);
+    int maxZ = (int)floorf((center.z + reach) * mInvCellSize);
+    for(int z = minZ; z <= maxZ; ++z) {
+        for(int y = minY; y <= maxY; ++y) {
+            for(int x = minX; x <= maxX; ++x) {
+                unsigned int slot = FindCell(x, y, z, false);
+                if(slot == SPATIAL_HASH_EMPTY) {
+                    continue;
+                }
+                SpatialHashCell *cell = &mCells[slot];
+                for(unsigned int i = cell->mStart; i < cell->mStart + cell->mCount; ++i) {
+                    vec3 d = mSortedPositions[i] - center;
+                    float r = radius + mSortedRadii[i];
+                    if(dot(d, d) > r * r) {
+                        continue;
+                    }
+                    if(found >= maxOut) {
+                        return found;
+                    }
+                    out[found++] = mSortedIds[i];
+                }
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,44 @@
+#ifndef _SPATIALHASH_H_
+#define _SPATIALHASH_H_
+
+#include <vector>
+#include "Collision.h"
+
+struct SpatialHashCell {
+    int mX;
+    int mY;
+    int mZ;
+    unsigned int mStart;
+    unsigned int mCount;
+    bool mUsed;
+};
+
+// Uniform grid hashed into an open addressed table, rebuilt every frame.
+// Each object lives in the cell of its center, queries widen the range of
+// cells by the largest radius. Works best for many similar sized objects
+struct SpatialHash {
+    float mCellSize;
+    float mInvCellSize;
+    float mMaxRadius;
+
+    std::vector<SpatialHashCell> mCells;
+    std::vector<unsigned int> mUsedCells;
+    std::vector<unsigned int> mObjectCell;
+
+    // Objects sorted by cell, stored as columns
+    std::vector<unsigned int> mSortedIds;
+    std::vector<vec3> mSortedPositions;
+    std::vector<float> mSortedRadii;
+
+    void Initialize(float cellSize);
+    void Build(const vec3 *positions, const float *radii, unsigned int count);
+
+    // Return the number of objects written to out (at most maxOut)
+    int QueryPoint(vec3 p, unsigned int *out, int maxOut);
+    int QueryBox(const AABB_min_max &box, unsigned int *out, int maxOut);
+    int QueryRadius(vec3 center, float radius, unsigned int *out, int maxOut);
+private:
+    unsigned int FindCell(int x, int y, int z, bool insert);
+};
+
+#endif
@@ -0,0 +1,267 @@
+#include "SweepAndPrune.h"
+#include "AllocTracker.h"
+
+static unsigned long long PairKey(unsigned int a, unsigned int b) {
+    if(a > b) {
+        unsigned int tmp = a; a = b; b = tmp;
+    }
+    return ((unsigned long long)a << 32) | b;
+}
+
+static unsigned int PairHash(unsigned long long key, unsigned int mask) {
+    return (unsigned int)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+static bool TestAABBAABB(const AABB_min_max &a, const AABB_min_max &b) {
+    // Exit with no intersection if separated along an axis
+    if(a.max.x < b.min.x || a.min.x > b.max.x) return false;
+    if(a.max.y < b.min.y || a.min.y > b.max.y) return false;
+    if(a.max.z < b.min.z || a.min.z > b.max.z) return false;
+    // Overlapping on all axes means AABBs are intersecting
+    return true;
+}
+
+unsigned int SweepAndPrune::AddProxy(const AABB_min_max &bounds, int userData) {
+    AllocTagScope tag(ALLOC_TAG_COLLISION);
+    unsigned int proxy;
+    if(!mFreeProxies.empty()) {
+        proxy = mFreeProxies.back();
+        mFreeProxies.pop_back();
+    }
+    else {
+        proxy = (unsigned int)mProxies.size();
+        mProxies.push_back(SAPProxy());
+    }
+    SAPProxy *p = &mProxies[proxy];
+    p->mBounds = bounds;
+    p->mUserData = userData;
+    p->mPairCount = 0;
+    p->mActive = true;
+    ReservePairs((unsigned int)(mProxies.size() - mFreeProxies.size()) * SAP_PAIRS_PER_PROXY);
+    // Endpoints go to the end of the arrays, the next Update sorts them in
+    for(int axis = 0; axis < 3; ++axis) {
+        std::vector<SAPEndpoint> &endpoints = mEndpoints[axis];
+        SAPEndpoint min = { bounds.min.v[axis], proxy << 1 };
+        SAPEndpoint max = { bounds.max.v[axis], (proxy << 1) | 1 };
+        p->mMin[axis] = (unsigned int)endpoints.size();
+        endpoints.push_back(min);
+        p->mMax[axis] = (unsigned int)endpoints.size();
+        endpoints.push_back(max);
+    }
+    return proxy;
+}
+
+void SweepAndPrune::RemoveProxy(unsigned int proxy) {
+    SAPProxy *p = &mProxies[proxy];
+    if(!p->mActive) {
+        return;
+    }
+    // Report and drop every pair the proxy was part of, looked up by key
+    // until its count runs out
+    for(unsigned int other = 0; other < mProxies.size() && p->mPairCount > 0; ++other) {
+        if(mProxies[other].mActive && mProxies[other].mPairCount > 0) {
+            RemovePair(proxy, other);
+        }
+    }
+    // Remove the endpoints keeping the arrays sorted
+    for(int axis = 0; axis < 3; ++axis) {
+        std::vector<SAPEndpoint> &endpoints = mEndpoints[axis];
+        unsigned int write = 0;
+        for(unsigned int read = 0; read < endpoints.size(); ++read) {
+            unsigned int owner = endpoints[read].mData >> 1;
+            if(owner == proxy) {
+                continue;
+            }
+            endpoints[write] = endpoints[read];
+            if(endpoints[write].mData & 1) {
+                mProxies[owner].mMax[axis] = write;
+            }
+            else {
+                mProxies[owner].mMin[axis] = write;
+            }
+            ++write;
+        }
+        endpoints.resize(write);
+    }
+    p->mActive = false;
+    mFreeProxies.push_back(proxy);
+}
+
+void SweepAndPrune::UpdateProxy(unsigned int proxy, const AABB_min_max &bounds) {
+    SAPProxy *p = &mProxies[proxy];
+    p->mBounds = bounds;
+    for(int axis = 0; axis < 3; ++axis) {
+        mEndpoints[axis][p->mMin[axis]].mValue = bounds.min.v[axis];
+        mEndpoints[axis][p->mMax[axis]].mValue = bounds.max.v[axis];
+    }
+}
+
+void SweepAndPrune::Update() {
+    for(int axis = 0; axis < 3; ++axis) {
+        SortAxis(axis);
+    }
+}
+
+void SweepAndPrune::ClearPairChanges() {
+    mAdded.clear();
+    mRemoved.clear();
+}
+
+bool SweepAndPrune::IsOverlapping(unsigned int a, unsigned int b) {
+    return a != b && FindPairSlot(PairKey(a, b)) != SAP_INVALID_SLOT;
+}
+
+void SweepAndPrune::Clear() {
+    for(int axis = 0; axis < 3; ++axis) {
+        std::vector<SAPEndpoint>().swap(mEndpoints[axis]);
+    }
+    std::vector<SAPProxy>().swap(mProxies);
+    std::vector<unsigned int>().swap(mFreeProxies);
+    std::vector<unsigned long long>().swap(mPairTable);
+    mPairCount = 0;
+    std::vector<SAPPair>().swap(mAdded);
+    std::vector<SAPPair>().swap(mRemoved);
+}
+
+void SweepAndPrune::SortAxis(int axis) {
+    std::vector<SAPEndpoint> &endpoints = mEndpoints[axis];
+    unsigned int count = (unsigned int)endpoints.size();
+    for(unsigned int i = 1; i < count; ++i) {
+        SAPEndpoint key = endpoints[i];
+        unsigned int keyProxy = key.mData >> 1;
+        bool keyIsMax = (key.mData & 1) != 0;
+        unsigned int j = i;
+        while(j > 0 && endpoints[j - 1].mValue > key.mValue) {
+            SAPEndpoint prev = endpoints[j - 1];
+            unsigned int prevProxy = prev.mData >> 1;
+            bool prevIsMax = (prev.mData & 1) != 0;
+            if(!keyIsMax && prevIsMax) {
+                // A min moved in front of a max, the intervals start to overlap
+                if(TestAABBAABB(mProxies[keyProxy].mBounds, mProxies[prevProxy].mBounds)) {
+                    AddPair(keyProxy, prevProxy);
+                }
+            }
+            else if(keyIsMax && !prevIsMax) {
+                // A max moved in front of a min, the intervals stop overlapping
+                RemovePair(keyProxy, prevProxy);
+            }
+            endpoints[j] = prev;
+            if(prevIsMax) {
+                mProxies[prevProxy].mMax[axis] = j;
+            }
+            else {
+                mProxies[prevProxy].mMin[axis] = j;
+            }
+            --j;
+        }
+        endpoints[j] = key;
+        if(keyIsMax) {
+            mProxies[keyProxy].mMax[axis] = j;
+        }
+        else {
+            mProxies[keyProxy].mMin[axis] = j;
+        }
+    }
+}
+
+void SweepAndPrune::AddPair(unsigned int a, unsigned int b) {
+    AllocTagScope tag(ALLOC_TAG_COLLISION);
+    if(a == b) {
+        return;
+    }
+    if(InsertPair(PairKey(a, b))) {
+        SAPPair pair = { a < b ? a : b, a < b ? b : a };
+        mAdded.push_back(pair);
+        mProxies[a].mPairCount++;
+        mProxies[b].mPairCount++;
+    }
+}
+
+void SweepAndPrune::RemovePair(unsigned int a, unsigned int b) {
+    if(a == b) {
+        return;
+    }
+    if(ErasePair(PairKey(a, b))) {
+        SAPPair pair = { a < b ? a : b, a < b ? b : a };
+        mRemoved.push_back(pair);
+        mProxies[a].mPairCount--;
+        mProxies[b].mPairCount--;
+    }
+}
+
+void SweepAndPrune::ReservePairs(unsigned int pairCount) {
+    // At most half full, a power of two so the hash can be masked
+    unsigned int capacity = 16;
+    while(capacity < pairCount * 2) {
+        capacity <<= 1;
+    }
+    if(capacity <= mPairTable.size()) {
+        return;
+    }
+    AllocTagScope tag(ALLOC_TAG_COLLISION);
+    std::vector<unsigned long long> table(capacity, SAP_EMPTY_PAIR);
+    table.swap(mPairTable);
+    unsigned int mask = capacity - 1;
+    for(unsigned int i = 0; i < table.size(); ++i) {
+        if(table[i] == SAP_EMPTY_PAIR) {
+            continue;
+        }
+        unsigned int slot = PairHash(table[i], mask);
+        while(mPairTable[slot] != SAP_EMPTY_PAIR) {
+            slot = (slot + 1) & mask;
+        }
+        mPairTable[slot] = table[i];
+    }
+}
+
+unsigned int SweepAndPrune::FindPairSlot(unsigned long long key) {
+    if(mPairTable.empty()) {
+        return SAP_INVALID_SLOT;
+    }
+    unsigned int mask = (unsigned int)mPairTable.size() - 1;
+    for(unsigned int slot = PairHash(key, mask);; slot = (slot + 1) & mask) {
+        if(mPairTable[slot] == key) {
+            return slot;
+        }
+        if(mPairTable[slot] == SAP_EMPTY_PAIR) {
+            return SAP_INVALID_SLOT;
+        }
+    }
+}
+
+bool SweepAndPrune::InsertPair(unsigned long long key) {
+    if(FindPairSlot(key) != SAP_INVALID_SLOT) {
+        return false;
+    }
+    // Only grows when the proxies overlap more than was reserved for them
+    ReservePairs(mPairCount + 1);
+    unsigned int mask = (unsigned int)mPairTable.size() - 1;
+    unsigned int slot = PairHash(key, mask);
+    while(mPairTable[slot] != SAP_EMPTY_PAIR) {
+        slot = (slot + 1) & mask;
+    }
+    mPairTable[slot] = key;
+    mPairCount++;
+    return true;
+}
+
+bool SweepAndPrune::ErasePair(unsigned long long key) {
+    unsigned int hole = FindPairSlot(key);
+    if(hole == SAP_INVALID_SLOT) {
+        return false;
+    }
+    // Shift the rest of the run back over the hole instead of leaving a tombstone,
+    // a key moves when its home slot is not between the hole and where it sits
+    unsigned int mask = (unsigned int)mPairTable.size() - 1;
+    mPairTable[hole] = SAP_EMPTY_PAIR;
+    for(unsigned int slot = (hole + 1) & mask; mPairTable[slot] != SAP_EMPTY_PAIR; slot = (slot + 1) & mask) {
+        unsigned int home = PairHash(mPairTable[slot], mask);
+        if(((slot - home) & mask) >= ((slot - hole) & mask)) {
+            mPairTable[hole] = mPairTable[slot];
+            mPairTable[slot] = SAP_EMPTY_PAIR;
+            hole = slot;
+        }
+    }
+    mPairCount--;
+    return true;
+}
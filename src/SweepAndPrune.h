@@ -0,0 +1,79 @@
+#ifndef _SWEEPANDPRUNE_H_
+#define _SWEEPANDPRUNE_H_
+
+#include <vector>
+#include "Collision.h"
+
+#define SAP_EMPTY_PAIR 0xFFFFFFFFFFFFFFFFull
+#define SAP_INVALID_SLOT 0xFFFFFFFF
+// Pairs a proxy is expected to take part in, AddProxy reserves room for them
+#define SAP_PAIRS_PER_PROXY 8
+
+struct SAPEndpoint {
+    float mValue;
+    unsigned int mData; // proxy index << 1 | 1 for max endpoints
+};
+
+struct SAPProxy {
+    AABB_min_max mBounds;
+    unsigned int mMin[3]; // index of the endpoints in each axis array
+    unsigned int mMax[3];
+    int mUserData;
+    unsigned int mPairCount;
+    bool mActive;
+};
+
+struct SAPPair {
+    unsigned int mA;
+    unsigned int mB;
+};
+
+// Incremental sweep and prune over the three axes. The endpoint arrays are
+// kept sorted with insertion sort: objects move little between frames so
+// the arrays are nearly sorted and every swap is a potential pair change
+struct SweepAndPrune {
+    std::vector<SAPEndpoint> mEndpoints[3];
+    std::vector<SAPProxy> mProxies;
+    std::vector<unsigned int> mFreeProxies;
+    // Open addressed pair keys (smaller proxy << 32 | bigger) with linear
+    // probing, kept at most half full. Pairs found while sorting never
+    // allocate unless the proxies overlap more than SAP_PAIRS_PER_PROXY each
+    std::vector<unsigned long long> mPairTable;
+    unsigned int mPairCount;
+
+    // Pair changes since the last call to ClearPairChanges
+    std::vector<SAPPair> mAdded;
+    std::vector<SAPPair> mRemoved;
+
+    SweepAndPrune() : mPairCount(0) { }
+
+    unsigned int AddProxy(const AABB_min_max &bounds, int userData);
+    void RemoveProxy(unsigned int proxy);
+    void UpdateProxy(unsigned int proxy, const AABB_min_max &bounds);
+    void Update();
+    void ClearPairChanges();
+    bool IsOverlapping(unsigned int a, unsigned int b);
+    unsigned int PairCount() { return mPairCount; }
+    // Calls f(a, b) for every overlapping pair, a < b
+    template <typename F>
+    void ForEachPair(F f) {
+        for(unsigned int i = 0; i < mPairTable.size(); ++i) {
+            unsigned long long key = mPairTable[i];
+            if(key != SAP_EMPTY_PAIR) {
+                f((unsigned int)(key >> 32), (unsigned int)(key & 0xFFFFFFFF));
+            }
+        }
+    }
+    // Drops every proxy and pair without reporting them and gives the memory back
+    void Clear();
+private:
+    void SortAxis(int axis);
+    void AddPair(unsigned int a, unsigned int b);
+    void RemovePair(unsigned int a, unsigned int b);
+    void ReservePairs(unsigned int pairCount);
+    unsigned int FindPairSlot(unsigned long long key);
+    bool InsertPair(unsigned long long key);
+    bool ErasePair(unsigned long long key);
+};
+
+#endif
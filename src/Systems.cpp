@@ -0,0 +1,294 @@
+#include "Systems.h"
+
+#include "Shader.h"
+#include "Renderer.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "AllocTracker.h"
+#include "Profiler.h"
+#include "Arena.h"
+#include "IK.h"
+#include "AnimationLod.h"
+
+#include <cmath>
+#include <float.h>
+#include <assert.h>
+
+#define SYSTEM_GROUND_PROBE 0.05f
+
+// Pushes the point out of the box through the closest face, returns false if the point is outside
+static bool PushOutOfBox(vec3 &p, vec3 center, const vec3 axes[3], vec3 extents, vec3 &normal) {
+    vec3 d = p - center;
+    float local[3];
+    for(int i = 0; i < 3; ++i) {
+        local[i] = dot(d, axes[i]);
+        if(fabsf(local[i]) > extents.v[i]) {
+            return false;
+        }
+    }
+    int best = 0;
+    float bestDepth = FLT_MAX;
+    for(int i = 0; i < 3; ++i) {
+        float depth = extents.v[i] - fabsf(local[i]);
+        if(depth < bestDepth) {
+            bestDepth = depth;
+            best = i;
+        }
+    }
+    normal = axes[best] * (local[best] >= 0.0f ? 1.0f : -1.0f);
+    p = p + normal * bestDepth;
+    return true;
+}
+
+static bool PushOutOfCollider(vec3 &p, const Collider &collider, vec3 &normal) {
+    if(collider.mType == COLLIDER_OBB) {
+        return PushOutOfBox(p, collider.mOBB.c, collider.mOBB.u, collider.mOBB.e, normal);
+    }
+    const vec3 axes[3] = { vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, 0, 1) };
+    vec3 center = (collider.mAABB.min + collider.mAABB.max) * 0.5f;
+    vec3 extents = (collider.mAABB.max - collider.mAABB.min) * 0.5f;
+    return PushOutOfBox(p, center, axes, extents, normal);
+}
+
+void MovementSystem(EntityWorld *world, float dt) {
+    PROFILE_FUNCTION();
+    unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_VELOCITY);
+    world->ForEachChunk(mask, [&](Chunk *chunk) {
+        Transform *transforms = chunk->Column<Transform>();
+        VelocityComponent *velocities = chunk->Column<VelocityComponent>();
+        for(unsigned int i = 0; i < chunk->mCount; ++i) {
+            VelocityComponent *velocity = &velocities[i];
+            if(velocity->mIsJumping) {
+                velocity->mVelocity = velocity->mVelocity + velocity->mGravity * dt;
+            }
+            transforms[i].mPosition = transforms[i].mPosition + velocity->mVelocity * dt;
+        }
+    });
+}
+
+void CollisionSystem(EntityWorld *world, const Collider *colliders, int count) {
+    PROFILE_FUNCTION();
+    unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) |
+                        COMPONENT_BIT(COMPONENT_VELOCITY) |
+                        COMPONENT_BIT(COMPONENT_COLLIDER);
+
+    // Characters are points at their feet against the static scene
+    world->ForEachChunk(mask, [&](Chunk *chunk) {
+        Transform *transforms = chunk->Column<Transform>();
+        VelocityComponent *velocities = chunk->Column<VelocityComponent>();
+        ColliderComponent *characterColliders = chunk->Column<ColliderComponent>();
+        SlotmapKey *entities = chunk->Entities();
+        for(unsigned int i = 0; i < chunk->mCount; ++i) {
+            vec3 position = transforms[i].mPosition;
+            VelocityComponent *velocity = &velocities[i];
+            bool grounded = false;
+            for(int j = 0; j < count; ++j) {
+                vec3 normal;
+                if(PushOutOfCollider(position, colliders[j], normal) && normal.y > 0.7f) {
+                    grounded = true;
+                }
+            }
+            // Standing right on top of a face also counts as grounded
+            for(int j = 0; j < count && !grounded; ++j) {
+                vec3 probe = position - vec3(0, SYSTEM_GROUND_PROBE, 0);
+                vec3 normal;
+                grounded = PushOutOfCollider(probe, colliders[j], normal);
+            }
+            velocity->mIsJumping = !grounded;
+            if(grounded && velocity->mVelocity.y < 0.0f) {
+                velocity->mVelocity.y = 0.0f;
+            }
+            transforms[i].mPosition = position;
+
+            ColliderComponent *collider = &characterColliders[i];
+            AABB_min_max bounds;
+            bounds.min = position + collider->mLocalBounds.min;
+            bounds.max = position + collider->mLocalBounds.max;
+            if(collider->mProxy == ECS_INVALID_INDEX) {
+                collider->mProxy = world->mBroadphase.AddProxy(bounds, 0);
+                if(collider->mProxy >= world->mProxyEntities.size()) {
+                    world->mProxyEntities.resize(collider->mProxy + 1);
+                }
+                world->mProxyEntities[collider->mProxy] = entities[i];
+            }
+            else {
+                world->mBroadphase.UpdateProxy(collider->mProxy, bounds);
+            }
+        }
+    });
+
+    // Characters against characters, overlapping pairs are pushed apart on the ground plane
+    world->mBroadphase.Update();
+    world->mBroadphase.ClearPairChanges();
+    world->mBroadphase.ForEachPair([&](unsigned int proxyA, unsigned int proxyB) {
+        Entity a = world->mProxyEntities[proxyA];
+        Entity b = world->mProxyEntities[proxyB];
+        Transform *transformA = world->GetComponent<Transform>(a);
+        Transform *transformB = world->GetComponent<Transform>(b);
+        ColliderComponent *colliderA = world->GetComponent<ColliderComponent>(a);
+        ColliderComponent *colliderB = world->GetComponent<ColliderComponent>(b);
+        if(!transformA || !transformB || !colliderA || !colliderB) {
+            return;
+        }
+        float radiusA = (colliderA->mLocalBounds.max.x - colliderA->mLocalBounds.min.x) * 0.5f;
+        float radiusB = (colliderB->mLocalBounds.max.x - colliderB->mLocalBounds.min.x) * 0.5f;
+        vec3 d = transformB->mPosition - transformA->mPosition;
+        d.y = 0.0f;
+        float distance = len(d);
+        float overlap = radiusA + radiusB - distance;
+        if(overlap <= 0.0f) {
+            return;
+        }
+        vec3 n = distance > 0.0001f ? d * (1.0f / distance) : vec3(1, 0, 0);
+        transformA->mPosition = transformA->mPosition - n * (overlap * 0.5f);
+        transformB->mPosition = transformB->mPosition + n * (overlap * 0.5f);
+    });
+}
+
+void AnimationSystem(EntityWorld *world, std::vector<Clip> &clips, Pose &restPose, float dt,
+                     RaycastWorld *ground, const FootIKRig *footRig, AnimationLod *lod) {
+    PROFILE_FUNCTION();
+    unsigned int mask = COMPONENT_BIT(COMPONENT_ANIMATOR);
+    if(lod) {
+        for(unsigned int i = 0; i <= ANIMATION_LOD_LEVELS; ++i) {
+            lod->mLevelCounts[i] = 0;
+        }
+        lod->mSampledCount = 0;
+    }
+    // An entry has to outlive the frames a character skips between updates
+    PoseCache *cache = &world->mPoseCache;
+    unsigned int maxInterval = 1;
+    for(unsigned int i = 0; lod && i < ANIMATION_LOD_LEVELS; ++i) {
+        maxInterval = lod->mIntervals[i] > maxInterval ? lod->mIntervals[i] : maxInterval;
+    }
+    cache->BeginFrame(maxInterval);
+    unsigned int count = 0;
+    world->ForEachChunk(mask, [&](Chunk *chunk) {
+        AnimatorComponent *animators = chunk->Column<AnimatorComponent>();
+        Transform *transforms = chunk->Column<Transform>();
+        SlotmapKey *entities = chunk->Entities();
+        for(unsigned int i = 0; i < chunk->mCount; ++i) {
+            AnimatorComponent *animator = &animators[i];
+            Pose *pose = world->mPoses.GetComponent(animator->mPose);
+            assert(pose && "animator created before the world had a rest pose");
+            bool created = !animator->mPosed;
+            animator->mPosed = true;
+            unsigned int level = lod && transforms ? lod->Select(transforms[i]) : 0;
+            // Coming into view can not wait for the next slot of the level
+            bool shown = level != ANIMATION_LOD_CULLED && animator->mLod == ANIMATION_LOD_CULLED;
+            animator->mLod = level;
+            animator->mPendingTime += dt * animator->mSpeed;
+            animator->mSampled = !lod || created || shown || lod->IsDue(level, entities[i].mId);
+            if(lod) {
+                lod->mLevelCounts[level]++;
+            }
+            if(level == ANIMATION_LOD_CULLED) {
+                animator->mCacheEntry = 0;
+            }
+            if(!animator->mSampled) {
+                continue;
+            }
+
+            Clip &clip = clips[animator->mClip];
+            float time = clip.AdjustTimeToFitRange(animator->mPlayback + animator->mPendingTime);
+            animator->mPlayback = time;
+            animator->mPendingTime = 0.0f;
+            const JointMask *jointMask = 0;
+            if(level == ANIMATION_LOD_CULLED) {
+                jointMask = &lod->mRootMask;
+            }
+            else if(lod && level >= lod->mReducedLevel) {
+                jointMask = &lod->mReducedMask;
+            }
+            // Culled characters only sample one track, sharing would not save anything
+            if(level != ANIMATION_LOD_CULLED) {
+                animator->mCacheEntry = cache->Acquire(clip, animator->mClip, time, level, jointMask, restPose);
+            }
+            if(!animator->mCacheEntry) {
+                if(jointMask) {
+                    clip.SampleMasked(*pose, time, *jointMask);
+                }
+                else {
+                    clip.Sample(*pose, time);
+                }
+            }
+            if(lod) {
+                lod->mSampledCount++;
+            }
+        }
+        count += chunk->mCount;
+    });
+
+    // Grounded characters at full detail get their feet placed, all in one batch
+    if(ground && footRig && footRig->mHips >= 0) {
+        ScratchScope scratch;
+        FootPlacement *placements = scratch.mArena->PushArray<FootPlacement>(count);
+        unsigned int placementCount = 0;
+        world->ForEachChunk(mask | COMPONENT_BIT(COMPONENT_TRANSFORM), [&](Chunk *chunk) {
+            Transform *transforms = chunk->Column<Transform>();
+            AnimatorComponent *animators = chunk->Column<AnimatorComponent>();
+            VelocityComponent *velocities = chunk->Column<VelocityComponent>();
+            for(unsigned int i = 0; i < chunk->mCount; ++i) {
+                if(!animators[i].mSampled || animators[i].mLod != 0 ||
+                   (velocities && velocities[i].mIsJumping)) {
+                    continue;
+                }
+                // The shared pose is only read, placing the feet needs a copy
+                Pose *pose = world->mPoses.GetComponent(animators[i].mPose);
+                if(animators[i].mCacheEntry) {
+                    *pose = cache->GetPose(animators[i].mCacheEntry);
+                    animators[i].mCacheEntry = 0;
+                }
+                FootPlacement *placement = &placements[placementCount++];
+                placement->mPose = pose;
+                placement->mModel = transforms[i];
+                placement->mWeight = 1.0f;
+            }
+        });
+        SolveFootPlacement(ground, *footRig, placements, placementCount);
+    }
+
+    // Culled characters are not drawn, their palette waits until they are back in view
+    world->ForEachChunk(mask, [&](Chunk *chunk) {
+        AnimatorComponent *animators = chunk->Column<AnimatorComponent>();
+        for(unsigned int i = 0; i < chunk->mCount; ++i) {
+            AnimatorComponent *animator = &animators[i];
+            if(!animator->mSampled || animator->mLod == ANIMATION_LOD_CULLED) {
+                continue;
+            }
+            if(animator->mCacheEntry) {
+                cache->GetPalette(animator->mCacheEntry);
+                continue;
+            }
+            // Sized to the joint count when the animator was created
+            std::vector<mat4> *palette = world->mPalettes.GetComponent(animator->mPalette);
+            world->mPoses.GetComponent(animator->mPose)->GetMatrixPalette(*palette);
+        }
+    });
+}
+
+void RenderSystem(EntityWorld *world, Shader *shader, Renderer *renderer) {
+    PROFILE_FUNCTION();
+    unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_RENDERABLE);
+    world->ForEachChunk(mask, [&](Chunk *chunk) {
+        Transform *transforms = chunk->Column<Transform>();
+        RenderableComponent *renderables = chunk->Column<RenderableComponent>();
+        AnimatorComponent *animators = chunk->Column<AnimatorComponent>();
+        for(unsigned int i = 0; i < chunk->mCount; ++i) {
+            RenderableComponent *renderable = &renderables[i];
+            shader->UpdateMat4("model", transformToMat4(transforms[i]));
+            if(animators) {
+                const std::vector<mat4> *palette = animators[i].mCacheEntry ?
+                    &world->mPoseCache.GetPalette(animators[i].mCacheEntry) :
+                    world->mPalettes.GetComponent(animators[i].mPalette);
+                if(palette && !palette->empty()) {
+                    shader->UpdateMat4Array("pose", (int)palette->size(), &(*palette)[0]);
+                }
+            }
+            renderable->mTexture->Bind(shader, "tex0", 0);
+            renderable->mMesh->Bind();
+            shader->Bind();
+            renderer->DrawIndex(renderable->mMesh->mIndicesCount);
+        }
+    });
+}
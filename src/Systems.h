@@ -0,0 +1,24 @@
+#ifndef _SYSTEMS_H_
+#define _SYSTEMS_H_
+
+#include <vector>
+#include "Ecs.h"
+#include "Clip.h"
+
+struct Shader;
+struct Renderer;
+struct RaycastWorld;
+struct FootIKRig;
+struct AnimationLod;
+
+// Every system walks the chunks that have the components it needs and runs
+// a plain loop over the columns
+void MovementSystem(EntityWorld *world, float dt);
+void CollisionSystem(EntityWorld *world, const Collider *colliders, int count);
+// Feet are placed on ground when a rig is given, with a lod the update rate
+// and the sampled joints follow the distance to the camera
+void AnimationSystem(EntityWorld *world, std::vector<Clip> &clips, Pose &restPose, float dt,
+                     RaycastWorld *ground = 0, const FootIKRig *footRig = 0, AnimationLod *lod = 0);
+void RenderSystem(EntityWorld *world, Shader *shader, Renderer *renderer);
+
+#endif
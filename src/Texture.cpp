@@ -2,8 +2,12 @@
 #include <glad/glad.h>
 #include <stb_image.h>
 #include "Shader.h"
+#include "AllocTracker.h"
+#include "Profiler.h"
 
 void Texture::Initialize(const char *path) {
+    PROFILE_SCOPE("Texture::Initialize");
+    AllocTagScope tag(ALLOC_TAG_TEXTURE);
     glGenTextures(1, &mHandle);
     glBindTexture(GL_TEXTURE_2D, mHandle);
     unsigned char *data = stbi_load(path, &mWidth, &mHeight, &mChannels, 4);
@@ -19,6 +23,8 @@ void Texture::Initialize(const char *path) {
 
 
 void Texture::InitializeCubemap(const char **faces) {
+    PROFILE_SCOPE("Texture::InitializeCubemap");
+    AllocTagScope tag(ALLOC_TAG_TEXTURE);
     glGenTextures(1, &mHandle);
     glBindTexture(GL_TEXTURE_CUBE_MAP, mHandle);
 
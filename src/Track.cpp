@@ -1,5 +1,7 @@
 #include "Track.h"
 
+#include <cmath>
+
 ////////////////////////////////////////////////////////////////////////
 // TRACK HELPERS ///////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
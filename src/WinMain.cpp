@@ -3,15 +3,29 @@
 #include <xinput.h>
 #include <glad/glad.h>
 #include <stdio.h>
+#include <assert.h>
+#include <string.h>
 
 #include "Defines.h"
 #include "Game.h"
 #include "Input.h"
+#include "Arena.h"
+#include "AllocTracker.h"
+#include "Platform.h"
+#include "Profiler.h"
+#include "InputRecorder.h"
+
+// Frames before the loop is expected to stop allocating
+#define ALLOC_WARMUP_FRAMES 120
 
 
 static bool gRunning;
-static Input gInput;
-static Input gLastInput;
+static HDC gDeviceContext;
+static LARGE_INTEGER gFrequency;
+static int gClientWidth;
+static int gClientHeight;
+static InputRecorder gRecorder;
+static InputReplay gReplay;
 static WORD XInputButtons[] = 
 {
     XINPUT_GAMEPAD_DPAD_UP,
@@ -27,6 +41,24 @@ static WORD XInputButtons[] =
 };
 
 
+// Finds "option value" in the command line, the value ends at the next space
+static bool GetCommandLineOption(const char *cmdLine, const char *option, char *value, size_t valueSize) {
+    const char *found = strstr(cmdLine, option);
+    if(!found || valueSize == 0) {
+        return false;
+    }
+    const char *src = found + strlen(option);
+    while(*src == ' ') src++;
+    size_t length = 0;
+    while(src[length] && src[length] != ' ' && length + 1 < valueSize) {
+        value[length] = src[length];
+        length++;
+    }
+    value[length] = 0;
+    return length > 0;
+}
+
+
 #if _APP_DEBUG
     #pragma comment ( linker, "/subsystem:console" )
     int main(int argc, const char **argv) {
@@ -77,7 +109,52 @@ static float ProcessXInputStick(SHORT value, int deadZoneValue)
     return result;
 }
 
-static void ProcessInputAndMessages(Input *lastInput) {
+FileResult PlatformReadFile(const char* filepath)
+{
+    FileResult result = {};
+    HANDLE file_handle = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+    if (file_handle != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER file_size;
+        if (GetFileSizeEx(file_handle, &file_size)) {
+            assert(file_size.QuadPart <= 0xFFFFFFFF);
+            result.data = TrackedMalloc((size_t)file_size.QuadPart + 1, AllocTagCurrent());
+            result.size = (size_t)file_size.QuadPart;
+            if (ReadFile(file_handle, result.data, (DWORD)result.size, 0, 0)) {
+                unsigned char* last_byte = (unsigned char*)result.data + result.size;
+                *last_byte = 0;
+                CloseHandle(file_handle);
+                return result;
+            }
+            TrackedFree(result.data);
+        }
+        CloseHandle(file_handle);
+    }
+    FileResult zeroResult = {};
+    return zeroResult;
+}
+
+void PlatformFreeFile(FileResult *file) {
+    if(file->data) TrackedFree(file->data);
+    file->data = 0;
+    file->size = 0;
+}
+
+double PlatformGetSeconds() {
+    LARGE_INTEGER counter = {};
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)gFrequency.QuadPart;
+}
+
+void PlatformGetWindowSize(int *width, int *height) {
+    *width = gClientWidth;
+    *height = gClientHeight;
+}
+
+void PlatformSwapBuffers() {
+    SwapBuffers(gDeviceContext);
+}
+
+bool PlatformProcessInput() {
     gInput.mMouseWheel = 0;
     MSG msg = {};
     while(PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
@@ -151,31 +228,9 @@ static void ProcessInputAndMessages(Input *lastInput) {
         gInput.mRightStickY = 0.0f;
     }
 
-    
-    for(int i = 0; i < ArrayCount(gInput.mKeys); ++i) {
-        if(lastInput->mKeys[i].mIsDown) {
-            gInput.mKeys[i].mWasDown = true;
-        }
-        else {
-            gInput.mKeys[i].mWasDown = false; 
-        }
-    }
-    for(int i = 0; i < ArrayCount(gInput.mMouseButtons); ++i) {
-        if(lastInput->mMouseButtons[i].mIsDown) {
-            gInput.mMouseButtons[i].mWasDown = true;
-        }
-        else {
-            gInput.mMouseButtons[i].mWasDown = false; 
-        }
-    }
-    for(int i = 0; i < ArrayCount(gInput.mJoyButtons); ++i) {
-        if(lastInput->mJoyButtons[i].mIsDown) {
-            gInput.mJoyButtons[i].mWasDown = true;
-        }
-        else {
-            gInput.mJoyButtons[i].mWasDown = false; 
-        }
-    }
+
+    InputUpdateWasDown(&gInput, &gLastInput);
+    return gRunning;
 }
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine, int iCmdShow) {
@@ -220,6 +275,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine,
                 windowRect.bottom - windowRect.top,
                 NULL, NULL, hInstance, szCmdLine);
     HDC hdc = GetDC(hwnd);
+    gDeviceContext = hdc;
     
     PIXELFORMATDESCRIPTOR pfd = {};
     memset(&pfd, 0, sizeof(PIXELFORMATDESCRIPTOR));
@@ -282,52 +338,79 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine,
     GetClientRect(hwnd, &clientRect);
     clientWidth = clientRect.right - clientRect.left;
     clientHeight = clientRect.bottom - clientRect.top;
+    gClientWidth = clientWidth;
+    gClientHeight = clientHeight;
 
     glViewport(0, 0, clientWidth, clientHeight);
     glEnable(GL_DEPTH_TEST);
     //glEnable(GL_CULL_FACE);
     glPointSize(5.0f);
 
-    LARGE_INTEGER frequency = {};
-    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceFrequency(&gFrequency);
+
+    MemoryInitialize();
+    ProfilerInitialize();
+    ProfilerSetThreadName("main");
+
+    // --record FILE captures the session, --replay FILE plays one back at its recorded dt
+    char inputPath[MAX_PATH];
+    if(GetCommandLineOption(szCmdLine, "--record", inputPath, sizeof(inputPath))) {
+        gRecorder.Begin(inputPath);
+    }
+    if(GetCommandLineOption(szCmdLine, "--replay", inputPath, sizeof(inputPath))) {
+        gReplay.Load(inputPath);
+    }
 
     Game game = {};
 
     game.Initialize();
 
-    LARGE_INTEGER lastCounter = {};
-    QueryPerformanceCounter(&lastCounter);
+    double lastTime = PlatformGetSeconds();
     
     gRunning = true;
+    unsigned int frameCount = 0;
    
     while(gRunning) {
+        PROFILE_SCOPE("Frame");
+        AllocTrackerBeginFrame();
 
-        ProcessInputAndMessages(&gLastInput);
+        PlatformProcessInput();
 
-        LARGE_INTEGER currentCounter = {};
-        QueryPerformanceCounter(&currentCounter);
-#if 0
-        double fps = (double)frequency.QuadPart / (double)(currentCounter.QuadPart - lastCounter.QuadPart);
-        printf("FPS: %lf\n", fps);
-#endif
-        float dt = (float)((double)(currentCounter.QuadPart - lastCounter.QuadPart) / (double)frequency.QuadPart);
+        double currentTime = PlatformGetSeconds();
+        float dt = (float)(currentTime - lastTime);
+        if(gReplay.IsReplaying() && !gReplay.NextFrame(&gInput, &gLastInput, &dt)) {
+            break;
+        }
+        gRecorder.RecordFrame(&gInput, dt);
 
         game.Update(dt);
         glClearColor(1.0f, 0.6f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
 
         game.Render();
+        GetFrameArena()->EndFrame();
+        AllocTrackerEndFrame();
+        if(++frameCount == ALLOC_WARMUP_FRAMES) {
+            AllocTrackerSetSteadyState(true);
+        }
 
-        SwapBuffers(hdc);
+        PlatformSwapBuffers();
         if(vsynch != 0) {
             glFinish();
         }
 
-        lastCounter = currentCounter;
+        lastTime = currentTime;
         gLastInput = gInput;
     }
 
+    AllocTrackerSetSteadyState(false);
+    gRecorder.End();
+    gReplay.Shutdown();
     game.Shutdown();
+    ProfilerWriteChromeTrace("trace.json");
+    ProfilerShutdown();
+    MemoryShutdown();
+    AllocTrackerReport();
 
     wglMakeCurrent(NULL, NULL);
     wglDeleteContext(hglrc);
@@ -335,106 +418,3 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine,
     
     return 0;
 }
-
-// Input function implementation
-
-bool KeyboardGetKeyDown(int key) {
-    return gInput.mKeys[key].mIsDown;
-}
-
-bool KeyboardGetKeyJustDown(int key) {
-    if(gInput.mKeys[key].mIsDown != gInput.mKeys[key].mWasDown) {
-        return gInput.mKeys[key].mIsDown; 
-    }
-    return false;
-}
-
-bool KeyboardGetKeyJustUp(int key) {
-    if(gInput.mKeys[key].mIsDown != gInput.mKeys[key].mWasDown) {
-        return gInput.mKeys[key].mWasDown; 
-    }
-    return false;
-}
-
-bool KeyboardGetKeyUp(int key) {
-    return !gInput.mKeys[key].mIsDown;
-}
-
-bool MouseGetButtonDown(int button) {
-    return gInput.mMouseButtons[button].mIsDown;
-}
-
-bool MouseGetButtonJustDown(int button) {
-    if(gInput.mMouseButtons[button].mIsDown != gInput.mMouseButtons[button].mWasDown) {
-        return gInput.mMouseButtons[button].mIsDown; 
-    }
-    return false;
-}
-
-bool MouseGetButtonJustUp(int button) {
-    if(gInput.mMouseButtons[button].mIsDown != gInput.mMouseButtons[button].mWasDown) {
-        return gInput.mMouseButtons[button].mWasDown; 
-    }
-    return false;
-}
-
-bool MouseGetButtonUp(int button) {
-    return !gInput.mMouseButtons[button].mIsDown;
-}
-
-int MouseGetCursorX() {
-    return gInput.mMouseX;
-}
-int MouseGetCursorY() {
-    return gInput.mMouseY;
-}
-
-int MouseGetWheel() {
-    return gInput.mMouseWheel;
-}
-
-int MouseGetLastCursorX() {
-    return gLastInput.mMouseX;
-}
-
-int MouseGetLastCursorY() {
-    return gLastInput.mMouseY;
-}
-
-bool JoysickGetButtonDown(int button) {
-    return gInput.mJoyButtons[button].mIsDown;
-}
-
-bool JoysickGetButtonJustDown(int button) {
-    if(gInput.mJoyButtons[button].mIsDown != gInput.mJoyButtons[button].mWasDown) {
-        return gInput.mJoyButtons[button].mIsDown; 
-    }
-    return false;
-}
-
-bool JoysickGetButtonJustUp(int button) {
-    if(gInput.mJoyButtons[button].mIsDown != gInput.mJoyButtons[button].mWasDown) {
-        return gInput.mJoyButtons[button].mWasDown; 
-    }
-    return false;
-}
-
-bool JoysickGetButtonUp(int button) {
-    return !gInput.mJoyButtons[button].mIsDown;
-}
-
-float JoysickGetLeftStickX() {
-    return gInput.mLeftStickX;
-}
-
-float JoysickGetLeftStickY() {
-    return gInput.mLeftStickY;
-}
-
-float JoysickGetRightStickX() {
-    return gInput.mRightStickX;
-}
-
-float JoysickGetRightStickY() {
-    return gInput.mRightStickY;
-}
@@ -0,0 +1,17 @@
+#!/bin/sh
+# Linux build of the headless benchmark runner, the game itself is built with build.bat
+
+mkdir -p ../build
+
+TARGET=headless
+CFLAGS="-O2 -g -Wall -Wno-unused-parameter"
+SRCS="$(ls *.cpp | grep -v WinMain.cpp) ../thirdparty/stb/stb_image.cpp"
+C_SRCS="../thirdparty/glad/src/glad.c ../thirdparty/cgltf/cgltf.c"
+INC_DIR="-I./ -I../thirdparty/stb -I../thirdparty/cgltf -I../thirdparty/glad/include"
+LIBS="-ldl -lpthread"
+DEFINES="-D_APP_DEBUG"
+
+for SRC in $C_SRCS; do
+    gcc -c -O2 -g $INC_DIR $SRC -o ../build/$(basename $SRC .c).o || exit 1
+done
+g++ -std=c++17 $CFLAGS $INC_DIR $DEFINES $SRCS ../build/glad.o ../build/cgltf.o $LIBS -o ../build/$TARGET
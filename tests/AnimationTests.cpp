@@ -0,0 +1,247 @@
+#include "Test.h"
+#include "CrossFadeController.h"
+#include "Mesh.h"
+
+#include <cmath>
+#include <vector>
+
+#define ANIMATION_TEST_DT (1.0f / 60.0f)
+#define ANIMATION_TEST_BLEND 0.2f
+
+// Biggest change of any joint between two poses, local positions and
+// rotation angles in radians
+struct PoseChange {
+    float mPosition;
+    float mRotation;
+};
+
+static PoseChange MeasureChange(Pose &a, Pose &b) {
+    PoseChange change = { 0.0f, 0.0f };
+    for(unsigned int i = 0; i < a.Size(); ++i) {
+        float position = len(a.GetLocalTransform(i).mPosition - b.GetLocalTransform(i).mPosition);
+        float d = fminf(fabsf(dot(a.GetLocalTransform(i).mRotation, b.GetLocalTransform(i).mRotation)), 1.0f);
+        float rotation = 2.0f * acosf(d);
+        change.mPosition = fmaxf(change.mPosition, position);
+        change.mRotation = fmaxf(change.mRotation, rotation);
+    }
+    return change;
+}
+
+static PoseChange MaxChange(PoseChange a, PoseChange b) {
+    PoseChange change = { fmaxf(a.mPosition, b.mPosition), fmaxf(a.mRotation, b.mRotation) };
+    return change;
+}
+
+// Largest change from one frame to the next while the controller plays
+// clip on its own, what a transition is allowed to add up to
+static PoseChange PlaybackChange(CrossFadeController &controller, Clip *clip) {
+    PoseChange change = { 0.0f, 0.0f };
+    controller.Play(clip, clip->mStartTime);
+    controller.Update(0.0f);
+    Pose previous = controller.GetCurrentPose();
+    for(float time = 0.0f; time < clip->GetDuration(); time += ANIMATION_TEST_DT) {
+        controller.Update(ANIMATION_TEST_DT);
+        change = MaxChange(change, MeasureChange(previous, controller.GetCurrentPose()));
+        previous = controller.GetCurrentPose();
+    }
+    return change;
+}
+
+// Steps a second into the transition step starts, first is the change on
+// the frame it starts and the result the largest change on the way
+template <typename F>
+static PoseChange TransitionChange(CrossFadeController &controller, Pose &previous, PoseChange &first, F step) {
+    PoseChange change = { 0.0f, 0.0f };
+    for(unsigned int frame = 0; frame < 60; ++frame) {
+        step(frame);
+        PoseChange frameChange = MeasureChange(previous, controller.GetCurrentPose());
+        if(frame == 0) {
+            first = frameChange;
+        }
+        change = MaxChange(change, frameChange);
+        previous = controller.GetCurrentPose();
+    }
+    return change;
+}
+
+static bool IsWithin(PoseChange change, PoseChange limit, float scale) {
+    return change.mPosition <= limit.mPosition * scale + 0.001f &&
+           change.mRotation <= limit.mRotation * scale + 0.001f;
+}
+
+// acos is coarse next to one, a pose matching another can be a little off
+static bool IsSame(PoseChange change) {
+    return change.mPosition < 0.0001f && change.mRotation < 0.002f;
+}
+
+// Idle to jump, the way the player starts a jump. The frame it starts on
+// moves at most a few frames of idle motion, a pop is a lot more than that
+static void TestInertializedTransition(CrossFadeController &controller, Clip *idle, Clip *jump, PoseChange idleLimit, PoseChange limit) {
+    controller.mMode = TRANSITION_INERTIALIZE;
+    controller.Play(idle, idle->mStartTime);
+    for(unsigned int frame = 0; frame < 30; ++frame) {
+        controller.Update(ANIMATION_TEST_DT);
+    }
+    Pose previous = controller.GetCurrentPose();
+    PoseChange first;
+    PoseChange change = TransitionChange(controller, previous, first, [&](unsigned int frame) {
+        if(frame == 0) {
+            controller.FadeTo(jump, ANIMATION_TEST_BLEND);
+        }
+        controller.Update(ANIMATION_TEST_DT);
+    });
+    TEST_CHECK(controller.GetCurrentClip() == jump);
+    TEST_CHECK(IsWithin(first, idleLimit, 4.0f));
+    // Some slack over the clips themselves for the offsets decaying on top
+    TEST_CHECK(IsWithin(change, limit, 1.5f));
+    // Once the offsets are gone the jump shows as sampled
+    Pose sampled = controller.mRestPose;
+    jump->Sample(sampled, controller.mTime);
+    TEST_CHECK(IsSame(MeasureChange(sampled, controller.GetCurrentPose())));
+
+    // Switching with Play pops, so the check above measures something
+    controller.Play(idle, idle->mStartTime);
+    for(unsigned int frame = 0; frame < 30; ++frame) {
+        controller.Update(ANIMATION_TEST_DT);
+    }
+    previous = controller.GetCurrentPose();
+    TransitionChange(controller, previous, first, [&](unsigned int frame) {
+        if(frame == 0) {
+            controller.Play(jump, jump->mStartTime);
+        }
+        controller.Update(ANIMATION_TEST_DT);
+    });
+    TEST_CHECK(!IsWithin(first, idleLimit, 4.0f));
+}
+
+// Jump back to a pose made outside the controller, the way the player lands
+// into the locomotion blend space, and from there into a clip again
+static void TestFollowTransition(CrossFadeController &controller, Clip *idle, Clip *jump, PoseChange idleLimit, PoseChange jumpLimit, PoseChange limit) {
+    controller.mMode = TRANSITION_INERTIALIZE;
+    controller.Play(jump, jump->mStartTime);
+    for(unsigned int frame = 0; frame < 30; ++frame) {
+        controller.Update(ANIMATION_TEST_DT);
+    }
+    Pose previous = controller.GetCurrentPose();
+    Pose external = controller.mRestPose;
+    float time = idle->mStartTime;
+    PoseChange first;
+    PoseChange change = TransitionChange(controller, previous, first, [&](unsigned int frame) {
+        time = idle->Sample(external, time + ANIMATION_TEST_DT);
+        controller.Follow(external, ANIMATION_TEST_DT, ANIMATION_TEST_BLEND);
+    });
+    TEST_CHECK(controller.GetCurrentClip() == 0);
+    TEST_CHECK(IsWithin(first, jumpLimit, 4.0f));
+    TEST_CHECK(IsWithin(change, limit, 1.5f));
+    TEST_CHECK(IsSame(MeasureChange(external, controller.GetCurrentPose())));
+
+    change = TransitionChange(controller, previous, first, [&](unsigned int frame) {
+        if(frame == 0) {
+            controller.FadeTo(jump, ANIMATION_TEST_BLEND);
+        }
+        controller.Update(ANIMATION_TEST_DT);
+    });
+    TEST_CHECK(controller.GetCurrentClip() == jump);
+    TEST_CHECK(IsWithin(first, idleLimit, 4.0f));
+    TEST_CHECK(IsWithin(change, limit, 1.5f));
+}
+
+// Biggest difference of any joint between two poses, relative to the size
+// of the positions and scales and as 1 - |cos| of the rotations
+static float PoseDifference(Pose &a, Pose &b) {
+    float difference = 0.0f;
+    for(unsigned int i = 0; i < a.Size(); ++i) {
+        Transform ta = a.GetLocalTransform(i);
+        Transform tb = b.GetLocalTransform(i);
+        float position = len(ta.mPosition - tb.mPosition) / fmaxf(len(ta.mPosition), 1.0f);
+        float scale = len(ta.mScale - tb.mScale) / fmaxf(len(ta.mScale), 1.0f);
+        float rotation = 1.0f - fminf(fabsf(dot(ta.mRotation, tb.mRotation)), 1.0f);
+        difference = fmaxf(difference, fmaxf(position, fmaxf(scale, rotation)));
+    }
+    return difference;
+}
+
+template <typename T>
+static void MakeCubic(T &track) {
+    unsigned int count = (unsigned int)track.mFrames.size();
+    track.mInterpolation = INTERPOLATION_CUBIC;
+    for(unsigned int i = 0; i < count && count > 1; ++i) {
+        unsigned int prev = i > 0 ? i - 1 : i;
+        unsigned int next = i < count - 1 ? i + 1 : i;
+        float delta = track.mFrames[next].mTime - track.mFrames[prev].mTime;
+        track.mFrames[i].mIn = (track.mFrames[next].mValue - track.mFrames[prev].mValue) * (1.0f / delta);
+        track.mFrames[i].mOut = track.mFrames[i].mIn;
+    }
+}
+
+// The demo clips are linear, the same keys with finite difference tangents
+static Clip MakeCubicClip(const Clip &source) {
+    Clip clip = source;
+    for(unsigned int i = 0; i < clip.mTracks.size(); ++i) {
+        MakeCubic(clip.mTracks[i].mPosition);
+        MakeCubic(clip.mTracks[i].mRotation);
+        MakeCubic(clip.mTracks[i].mScale);
+    }
+    return clip;
+}
+
+// An additive clip sampled at full weight over the pose it was made from
+// gives back the clip it came from, between keys and across the loop
+static void TestAdditiveRoundTrip(Clip &source, Pose &restPose, bool fromFirstFrame) {
+    Clip additive = source;
+    additive.MakeAdditive(restPose, fromFirstFrame);
+    TEST_CHECK(additive.mAdditive);
+    Pose reference = restPose;
+    if(fromFirstFrame) {
+        source.Sample(reference, source.mStartTime);
+    }
+    float difference = 0.0f;
+    for(float time = source.mStartTime; time < source.mEndTime + 0.5f; time += ANIMATION_TEST_DT * 0.7f) {
+        Pose expected = restPose;
+        source.Sample(expected, time);
+        Pose sampled = reference;
+        additive.SampleAdditive(sampled, time, 1.0f);
+        difference = fmaxf(difference, PoseDifference(expected, sampled));
+    }
+    TEST_CHECK(difference < 0.000001f);
+
+    // At no weight the reference stays as it is
+    Pose sampled = reference;
+    additive.SampleAdditive(sampled, source.mStartTime + source.GetDuration() * 0.5f, 0.0f);
+    TEST_CHECK(PoseDifference(reference, sampled) < 0.00001f);
+}
+
+void RunAnimationTests() {
+    cgltf_data *data = LoadGLTFFile(GAME_ASSET_DIR "/clone2/clone.gltf");
+    TEST_CHECK(data != 0);
+    if(!data) {
+        return;
+    }
+    Pose restPose = LoadRestPose(data);
+    std::vector<Clip> clips = LoadClips(data);
+    FreeGLTFFile(data);
+    TEST_CHECK(restPose.Size() > 0);
+    TEST_CHECK(clips.size() > 3);
+    if(restPose.Size() == 0 || clips.size() <= 3) {
+        return;
+    }
+    // The demo clips: idle is 1, jump is 2 and walk is 3
+    Clip *idle = &clips[1];
+    Clip *jump = &clips[2];
+
+    CrossFadeController *controller = new CrossFadeController();
+    controller->Initialize(restPose);
+    PoseChange idleLimit = PlaybackChange(*controller, idle);
+    PoseChange jumpLimit = PlaybackChange(*controller, jump);
+    PoseChange limit = MaxChange(idleLimit, jumpLimit);
+    TestInertializedTransition(*controller, idle, jump, idleLimit, limit);
+    TestFollowTransition(*controller, idle, jump, idleLimit, jumpLimit, limit);
+    delete controller;
+
+    Clip cubic = MakeCubicClip(clips[3]);
+    Clip *additiveSources[] = { idle, &clips[3], &cubic };
+    for(unsigned int i = 0; i < 3; ++i) {
+        TestAdditiveRoundTrip(*additiveSources[i], restPose, false);
+        TestAdditiveRoundTrip(*additiveSources[i], restPose, true);
+    }
+}
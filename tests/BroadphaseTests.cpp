@@ -0,0 +1,297 @@
+#include "Test.h"
+#include "SweepAndPrune.h"
+#include "SpatialHash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static AABB_min_max MakeBox(vec3 center, float halfSize) {
+    AABB_min_max box;
+    box.min = center - vec3(halfSize, halfSize, halfSize);
+    box.max = center + vec3(halfSize, halfSize, halfSize);
+    return box;
+}
+
+static bool HasPair(const std::vector<SAPPair> &pairs, unsigned int a, unsigned int b) {
+    for(unsigned int i = 0; i < pairs.size(); ++i) {
+        if((pairs[i].mA == a && pairs[i].mB == b) || (pairs[i].mA == b && pairs[i].mB == a)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pairs are reported once when they start and once when they stop overlapping
+static void TestSweepAndPrunePairEvents() {
+    SweepAndPrune sap;
+    unsigned int a = sap.AddProxy(MakeBox(vec3(0, 0, 0), 1.0f), 0);
+    unsigned int b = sap.AddProxy(MakeBox(vec3(1.5f, 0, 0), 1.0f), 1);
+    unsigned int c = sap.AddProxy(MakeBox(vec3(10, 0, 0), 1.0f), 2);
+    sap.Update();
+    TEST_CHECK(sap.mAdded.size() == 1 && HasPair(sap.mAdded, a, b));
+    TEST_CHECK(sap.IsOverlapping(a, b));
+    TEST_CHECK(!sap.IsOverlapping(a, c));
+    sap.ClearPairChanges();
+
+    // Nothing moved, nothing to report
+    sap.Update();
+    TEST_CHECK(sap.mAdded.empty() && sap.mRemoved.empty());
+
+    sap.UpdateProxy(b, MakeBox(vec3(9, 0, 0), 1.0f));
+    sap.Update();
+    TEST_CHECK(sap.mRemoved.size() == 1 && HasPair(sap.mRemoved, a, b));
+    TEST_CHECK(sap.mAdded.size() == 1 && HasPair(sap.mAdded, b, c));
+    TEST_CHECK(!sap.IsOverlapping(a, b));
+    sap.ClearPairChanges();
+
+    sap.RemoveProxy(c);
+    TEST_CHECK(sap.mRemoved.size() == 1 && HasPair(sap.mRemoved, b, c));
+    TEST_CHECK(sap.PairCount() == 0);
+    sap.ClearPairChanges();
+
+    // The freed proxy is reused and sorted in on the next update
+    unsigned int d = sap.AddProxy(MakeBox(vec3(0.5f, 0, 0), 1.0f), 3);
+    TEST_CHECK(d == c);
+    sap.Update();
+    TEST_CHECK(sap.mAdded.size() == 1 && HasPair(sap.mAdded, a, d));
+
+    sap.Clear();
+    TEST_CHECK(sap.mProxies.empty() && sap.PairCount() == 0 && sap.mEndpoints[0].empty());
+}
+
+// Overlap on two axes only is not a pair
+static void TestSweepAndPruneNeedsAllAxes() {
+    SweepAndPrune sap;
+    unsigned int a = sap.AddProxy(MakeBox(vec3(0, 0, 0), 1.0f), 0);
+    unsigned int b = sap.AddProxy(MakeBox(vec3(0.5f, 0.5f, 5), 1.0f), 1);
+    sap.Update();
+    TEST_CHECK(sap.mAdded.empty());
+    sap.UpdateProxy(b, MakeBox(vec3(0.5f, 0.5f, 1.5f), 1.0f));
+    sap.Update();
+    TEST_CHECK(HasPair(sap.mAdded, a, b));
+}
+
+static float RandomUnit(unsigned int &seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return (float)(seed >> 8) / (float)(1 << 24);
+}
+
+// The pairs the sweep found are exactly the overlapping boxes
+static bool SamePairs(SweepAndPrune &sap, const std::vector<AABB_min_max> &boxes, const std::vector<unsigned int> &proxies) {
+    unsigned int expected = 0;
+    bool same = true;
+    for(unsigned int i = 0; i < proxies.size(); ++i) {
+        for(unsigned int j = i + 1; j < proxies.size(); ++j) {
+            const AABB_min_max &a = boxes[i];
+            const AABB_min_max &b = boxes[j];
+            bool overlap = a.max.x >= b.min.x && a.min.x <= b.max.x && a.max.y >= b.min.y &&
+                           a.min.y <= b.max.y && a.max.z >= b.min.z && a.min.z <= b.max.z;
+            expected += overlap ? 1 : 0;
+            same = same && overlap == sap.IsOverlapping(proxies[i], proxies[j]);
+        }
+    }
+    unsigned int visited = 0;
+    sap.ForEachPair([&](unsigned int a, unsigned int b) {
+        same = same && a < b;
+        ++visited;
+    });
+    return same && expected == sap.PairCount() && visited == expected;
+}
+
+// A moving crowd keeps the pair table right through inserts, erases and
+// removed proxies, and the table reserved by AddProxy does not grow while it
+// moves. A pile overlapping more than was reserved grows it and stays right
+static void TestSweepAndPruneCrowd() {
+    const unsigned int count = 200;
+    unsigned int seed = 11;
+    SweepAndPrune sap;
+    std::vector<AABB_min_max> boxes(count);
+    std::vector<vec3> centers(count);
+    std::vector<unsigned int> proxies(count);
+    for(unsigned int i = 0; i < count; ++i) {
+        centers[i] = vec3(RandomUnit(seed) * 20.0f, 0.0f, RandomUnit(seed) * 20.0f);
+        boxes[i] = MakeBox(centers[i], 0.5f);
+        proxies[i] = sap.AddProxy(boxes[i], (int)i);
+    }
+    unsigned int reserved = (unsigned int)sap.mPairTable.size();
+    TEST_CHECK(reserved >= count * SAP_PAIRS_PER_PROXY * 2);
+    sap.Update();
+    TEST_CHECK(SamePairs(sap, boxes, proxies));
+    bool same = true;
+    for(unsigned int frame = 0; frame < 60; ++frame) {
+        for(unsigned int i = 0; i < count; ++i) {
+            centers[i] = centers[i] + vec3(RandomUnit(seed) - 0.5f, 0.0f, RandomUnit(seed) - 0.5f) * 0.4f;
+            boxes[i] = MakeBox(centers[i], 0.5f);
+            sap.UpdateProxy(proxies[i], boxes[i]);
+        }
+        sap.Update();
+        sap.ClearPairChanges();
+        same = same && SamePairs(sap, boxes, proxies);
+    }
+    TEST_CHECK(same);
+    TEST_CHECK(sap.mPairTable.size() == reserved);
+
+    // Every other proxy goes, the pairs left are between the ones that stay
+    std::vector<AABB_min_max> keptBoxes;
+    std::vector<unsigned int> kept;
+    for(unsigned int i = 0; i < count; ++i) {
+        if(i % 2) {
+            sap.RemoveProxy(proxies[i]);
+        }
+        else {
+            keptBoxes.push_back(boxes[i]);
+            kept.push_back(proxies[i]);
+        }
+    }
+    TEST_CHECK(SamePairs(sap, keptBoxes, kept));
+
+    // All on one spot, every kept proxy overlaps every other
+    for(unsigned int i = 0; i < kept.size(); ++i) {
+        keptBoxes[i] = MakeBox(vec3(5.0f, 0.0f, 5.0f) + vec3(RandomUnit(seed), 0.0f, RandomUnit(seed)) * 0.1f, 0.5f);
+        sap.UpdateProxy(kept[i], keptBoxes[i]);
+    }
+    sap.Update();
+    TEST_CHECK(sap.PairCount() == kept.size() * (kept.size() - 1) / 2);
+    TEST_CHECK(SamePairs(sap, keptBoxes, kept));
+}
+
+static int CellOf(float value, float cellSize) {
+    return (int)floorf(value / cellSize);
+}
+
+// After a build the objects are grouped by cell: every used cell covers a
+// range of the sorted arrays holding exactly the objects whose center is in
+// it, and a rebuild with fewer objects in other places leaves nothing behind
+static void TestSpatialHashRebuild() {
+    SpatialHash hash;
+    hash.Initialize(1.0f);
+    vec3 first[] = { vec3(0.5f, 0, 0.5f), vec3(3.2f, 0, 0.1f), vec3(0.9f, 0, 0.2f), vec3(-0.5f, 0, 0.5f),
+                     vec3(3.7f, 0, 0.9f), vec3(0.1f, 0, 0.9f), vec3(-7.5f, 2, 4.5f) };
+    vec3 second[] = { vec3(10.5f, 0, 10.5f), vec3(10.2f, 0, 10.7f), vec3(-3.5f, 0, -3.5f) };
+    struct Build {
+        vec3 *mPositions;
+        unsigned int mCount;
+    } builds[] = { { first, 7 }, { second, 3 }, { first, 7 } };
+    for(unsigned int b = 0; b < 3; ++b) {
+        hash.Build(builds[b].mPositions, 0, builds[b].mCount);
+        unsigned int count = builds[b].mCount;
+        TEST_CHECK(hash.mSortedIds.size() == count);
+        std::vector<bool> seen(count, false);
+        unsigned int covered = 0;
+        for(unsigned int c = 0; c < hash.mUsedCells.size(); ++c) {
+            SpatialHashCell *cell = &hash.mCells[hash.mUsedCells[c]];
+            TEST_CHECK(cell->mUsed && cell->mCount > 0);
+            for(unsigned int i = cell->mStart; i < cell->mStart + cell->mCount; ++i) {
+                unsigned int id = hash.mSortedIds[i];
+                vec3 p = builds[b].mPositions[id];
+                TEST_CHECK(CellOf(p.x, 1.0f) == cell->mX && CellOf(p.y, 1.0f) == cell->mY && CellOf(p.z, 1.0f) == cell->mZ);
+                TEST_CHECK(hash.mSortedPositions[i] == p);
+                TEST_CHECK(!seen[id]);
+                seen[id] = true;
+            }
+            covered += cell->mCount;
+        }
+        TEST_CHECK(covered == count);
+        // Cells left from the build before are gone
+        unsigned int used = 0;
+        for(unsigned int i = 0; i < hash.mCells.size(); ++i) {
+            used += hash.mCells[i].mUsed ? 1 : 0;
+        }
+        TEST_CHECK(used == hash.mUsedCells.size());
+    }
+    TEST_CHECK(hash.mUsedCells.size() == 4);
+}
+
+// Objects in the cells next to the query, on both sides of a boundary and
+// at negative coordinates, are found. A big object whose center is several
+// cells away still reaches a point query through the largest radius
+static void TestSpatialHashAcrossCells() {
+    SpatialHash hash;
+    hash.Initialize(1.0f);
+    vec3 positions[] = { vec3(0.95f, 0.5f, 0.5f), vec3(1.05f, 0.5f, 0.5f), vec3(-0.05f, 0.5f, -0.05f),
+                         vec3(0.5f, 0.5f, 5.5f) };
+    float radii[] = { 0.0f, 0.0f, 0.0f, 4.6f };
+    hash.Build(positions, radii, 4);
+
+    unsigned int found[4];
+    // Straddles the boundary at x = 1
+    int n = hash.QueryRadius(vec3(1.0f, 0.5f, 0.5f), 0.1f, found, 4);
+    std::sort(found, found + n);
+    TEST_CHECK(n == 2 && found[0] == 0 && found[1] == 1);
+    // Straddles the corner at the origin
+    n = hash.QueryRadius(vec3(0.02f, 0.5f, 0.02f), 0.1f, found, 4);
+    TEST_CHECK(n == 1 && found[0] == 2);
+    // Five cells from the center of the big one, inside its radius
+    n = hash.QueryPoint(vec3(0.5f, 0.5f, 1.0f), found, 4);
+    TEST_CHECK(n == 1 && found[0] == 3);
+    // A box over the boundary at x = 1 picks up both sides but not the far one
+    AABB_min_max box;
+    box.min = vec3(0.9f, 0.4f, 0.4f);
+    box.max = vec3(1.1f, 0.6f, 0.6f);
+    n = hash.QueryBox(box, found, 4);
+    std::sort(found, found + n);
+    TEST_CHECK(n == 2 && found[0] == 0 && found[1] == 1);
+}
+
+// Every query answer matches a brute force test over the same spheres
+static void TestSpatialHashQueries() {
+    const unsigned int count = 200;
+    std::vector<vec3> positions(count);
+    std::vector<float> radii(count);
+    unsigned int seed = 7;
+    for(unsigned int i = 0; i < count; ++i) {
+        float v[4];
+        for(int k = 0; k < 4; ++k) {
+            seed = seed * 1664525u + 1013904223u;
+            v[k] = (float)(seed >> 8) / (float)(1 << 24);
+        }
+        positions[i] = vec3(v[0] * 40.0f - 20.0f, v[1] * 4.0f, v[2] * 40.0f - 20.0f);
+        radii[i] = 0.25f + v[3];
+    }
+    SpatialHash hash;
+    hash.Initialize(2.0f);
+    hash.Build(&positions[0], &radii[0], count);
+
+    unsigned int found[count];
+    vec3 centers[] = { vec3(0, 1, 0), vec3(-19, 0, 19), vec3(7.3f, 2, -3.1f), vec3(100, 0, 0) };
+    for(unsigned int q = 0; q < sizeof(centers) / sizeof(centers[0]); ++q) {
+        float radius = 3.0f;
+        int n = hash.QueryRadius(centers[q], radius, found, (int)count);
+        std::vector<unsigned int> expected;
+        for(unsigned int i = 0; i < count; ++i) {
+            vec3 d = positions[i] - centers[q];
+            float r = radius + radii[i];
+            if(dot(d, d) <= r * r) {
+                expected.push_back(i);
+            }
+        }
+        std::sort(found, found + n);
+        TEST_CHECK(n == (int)expected.size());
+        TEST_CHECK(std::equal(expected.begin(), expected.end(), found));
+
+        AABB_min_max box = MakeBox(centers[q], radius);
+        n = hash.QueryBox(box, found, (int)count);
+        expected.clear();
+        for(unsigned int i = 0; i < count; ++i) {
+            if(SqDistPointAABB(positions[i], box) <= radii[i] * radii[i]) {
+                expected.push_back(i);
+            }
+        }
+        std::sort(found, found + n);
+        TEST_CHECK(n == (int)expected.size());
+        TEST_CHECK(std::equal(expected.begin(), expected.end(), found));
+    }
+
+    // Only as many as asked for
+    TEST_CHECK(hash.QueryRadius(vec3(0, 0, 0), 30.0f, found, 5) == 5);
+}
+
+void RunBroadphaseTests() {
+    TestSweepAndPrunePairEvents();
+    TestSweepAndPruneNeedsAllAxes();
+    TestSweepAndPruneCrowd();
+    TestSpatialHashRebuild();
+    TestSpatialHashAcrossCells();
+    TestSpatialHashQueries();
+}
@@ -0,0 +1,52 @@
+#include "Test.h"
+#include "Ecs.h"
+
+// Removing a component moves the entity to the archetype without it,
+// removing its last one destroys it and releases the broadphase proxy
+static void TestRemoveLastComponent() {
+    EntityWorld *world = new EntityWorld();
+    world->Initialize(Pose());
+    unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_COLLIDER);
+    Entity entity = world->CreateEntity(mask);
+    ColliderComponent *collider = world->GetComponent<ColliderComponent>(entity);
+    TEST_CHECK(collider != 0);
+    if(!collider) {
+        delete world;
+        return;
+    }
+    AABB_min_max bounds;
+    bounds.min = vec3(0, 0, 0);
+    bounds.max = vec3(1, 1, 1);
+    collider->mProxy = world->mBroadphase.AddProxy(bounds, 0);
+    world->mProxyEntities.resize(collider->mProxy + 1);
+    world->mProxyEntities[collider->mProxy] = entity;
+    unsigned int proxy = collider->mProxy;
+
+    world->RemoveComponent(entity, COMPONENT_TRANSFORM);
+    TEST_CHECK(world->EntityCount() == 1);
+    TEST_CHECK(!world->HasComponent(entity, COMPONENT_TRANSFORM));
+    TEST_CHECK(world->HasComponent(entity, COMPONENT_COLLIDER));
+    collider = world->GetComponent<ColliderComponent>(entity);
+    TEST_CHECK(collider && collider->mProxy == proxy);
+    TEST_CHECK(world->mBroadphase.mProxies[proxy].mActive);
+
+    world->RemoveComponent(entity, COMPONENT_COLLIDER);
+    TEST_CHECK(world->EntityCount() == 0);
+    TEST_CHECK(!world->HasComponent(entity, COMPONENT_COLLIDER));
+    TEST_CHECK(world->GetComponent<ColliderComponent>(entity) == 0);
+    TEST_CHECK(!world->mBroadphase.mProxies[proxy].mActive);
+    TEST_CHECK(world->mProxyEntities[proxy].mId == ECS_INVALID_INDEX);
+    // Nothing left in any chunk for the systems to walk over
+    unsigned int chunks = 0;
+    world->ForEachChunk(0, [&](Chunk *chunk) {
+        ++chunks;
+    });
+    TEST_CHECK(chunks == 0);
+
+    world->Shutdown();
+    delete world;
+}
+
+void RunEcsTests() {
+    TestRemoveLastComponent();
+}
@@ -0,0 +1,52 @@
+#include "Test.h"
+#include "Arena.h"
+
+#include <stdint.h>
+
+// Pushes are aligned and packed, Reset and FreeToMarker hand the same
+// memory out again and the high water mark remembers the peak
+static void TestArenaReset() {
+    Arena arena;
+    arena.Initialize(1024, "test");
+    unsigned char *first = (unsigned char *)arena.Push(10);
+    TEST_CHECK(first == arena.mBase);
+    float *floats = arena.PushArray<float>(4);
+    TEST_CHECK(((uintptr_t)floats & 15) == 0);
+    TEST_CHECK((unsigned char *)floats >= first + 10);
+
+    size_t marker = arena.GetMarker();
+    void *scratch = arena.Push(100);
+    TEST_CHECK(arena.mUsed >= marker + 100);
+    arena.FreeToMarker(marker);
+    TEST_CHECK(arena.mUsed == marker);
+    TEST_CHECK(arena.Push(100) == scratch);
+
+    size_t peak = arena.mUsed;
+    arena.Reset();
+    TEST_CHECK(arena.mUsed == 0);
+    TEST_CHECK(arena.mHighWater >= peak);
+    TEST_CHECK(arena.Push(10) == first);
+    arena.Shutdown();
+}
+
+// Everything pushed inside a scope is gone once it closes, nested scopes included
+static void TestScratchScope() {
+    Arena *scratch = GetScratchArena();
+    size_t before = scratch->GetMarker();
+    {
+        ScratchScope outer;
+        outer.mArena->PushArray<int>(64);
+        size_t inside = scratch->GetMarker();
+        {
+            ScratchScope inner;
+            inner.mArena->PushArray<int>(256);
+        }
+        TEST_CHECK(scratch->GetMarker() == inside);
+    }
+    TEST_CHECK(scratch->GetMarker() == before);
+}
+
+void RunMemoryTests() {
+    TestArenaReset();
+    TestScratchScope();
+}
@@ -0,0 +1,51 @@
+#include "Test.h"
+#include "MotionMatching.h"
+
+#include <cmath>
+
+static float RandomFloat(unsigned int &seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return (float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+}
+
+// The KD-tree finds a frame as close as the linear scan does, for queries
+// near the rows and far from all of them
+static void TestKDTreeMatchesLinearScan() {
+    const unsigned int count = 2000;
+    MotionDatabase database;
+    database.mFrames.resize(count);
+    database.mFeatures.assign(count * MOTION_FEATURE_STRIDE, 0.0f);
+    unsigned int seed = 11;
+    for(unsigned int i = 0; i < count; ++i) {
+        database.mFrames[i].mClip = 0;
+        database.mFrames[i].mTime = (float)i / MOTION_SAMPLE_RATE;
+        for(unsigned int k = 0; k < MOTION_FEATURE_COUNT; ++k) {
+            database.mFeatures[i * MOTION_FEATURE_STRIDE + k] = RandomFloat(seed);
+        }
+    }
+    database.BuildTree();
+
+    float query[MOTION_FEATURE_STRIDE];
+    bool same = true;
+    for(unsigned int q = 0; q < 200; ++q) {
+        const float *row = database.GetFeatures((q * 37) % count);
+        float spread = q < 100 ? 0.05f : 2.0f;
+        for(unsigned int k = 0; k < MOTION_FEATURE_STRIDE; ++k) {
+            query[k] = k < MOTION_FEATURE_COUNT ? row[k] + RandomFloat(seed) * spread : 0.0f;
+        }
+        float linearDistance, treeDistance;
+        unsigned int linear = database.Search(query, &linearDistance);
+        unsigned int tree = database.SearchTree(query, &treeDistance);
+        same = same && (tree == linear || fabsf(treeDistance - linearDistance) <= 1e-5f * linearDistance);
+    }
+    TEST_CHECK(same);
+
+    // A row itself is found at distance 0
+    float distance;
+    unsigned int frame = database.SearchTree(database.GetFeatures(1234), &distance);
+    TEST_CHECK(frame == 1234 && distance == 0.0f);
+}
+
+void RunMotionMatchingTests() {
+    TestKDTreeMatchesLinearScan();
+}
@@ -0,0 +1,76 @@
+#include "Test.h"
+#include "Raycast.h"
+
+#include <stdlib.h>
+#include <vector>
+
+static float RandomRange(float min, float max) {
+    return min + ((float)rand() / (float)RAND_MAX) * (max - min);
+}
+
+static bool SameHit(const RayHit &a, const RayHit &b) {
+    if(a.mHit != b.mHit) {
+        return false;
+    }
+    return !a.mHit || (a.mCollider == b.mCollider && a.mDistance == b.mDistance);
+}
+
+// A batch big enough for the workers finds the same hits as casting the
+// rays one by one, before, while and after the pool runs
+static void TestBatchOnWorkers() {
+    srand(7);
+    std::vector<Collider> colliders;
+    for(int i = 0; i < 64; ++i) {
+        vec3 min(RandomRange(-20.0f, 20.0f), RandomRange(0.0f, 4.0f), RandomRange(-20.0f, 20.0f));
+        vec3 size(RandomRange(0.5f, 3.0f), RandomRange(0.5f, 3.0f), RandomRange(0.5f, 3.0f));
+        colliders.push_back(MakeAABBCollider(min, min + size));
+    }
+    RaycastWorld world;
+    world.Build(&colliders[0], (int)colliders.size());
+
+    const int count = 2000;
+    std::vector<Ray> rays(count);
+    std::vector<RayHit> expected(count);
+    for(int i = 0; i < count; ++i) {
+        vec3 origin(RandomRange(-25.0f, 25.0f), RandomRange(0.0f, 6.0f), RandomRange(-25.0f, 25.0f));
+        vec3 target(RandomRange(-25.0f, 25.0f), RandomRange(0.0f, 6.0f), RandomRange(-25.0f, 25.0f));
+        rays[i] = MakeSegment(origin, target);
+        world.Raycast(rays[i], expected[i]);
+    }
+
+    std::vector<RayHit> hits(count);
+    int hitCount = 0;
+    bool same = true;
+    world.RaycastBatch(&rays[0], &hits[0], count, 0);
+    for(int i = 0; i < count; ++i) {
+        same = same && SameHit(expected[i], hits[i]);
+        hitCount += expected[i].mHit ? 1 : 0;
+    }
+    TEST_CHECK(same);
+    TEST_CHECK(hitCount > 0 && hitCount < count);
+
+    // More workers than this machine may have, the pool does not care
+    world.StartWorkers(4);
+    TEST_CHECK(world.mWorkers != 0);
+    for(int run = 0; run < 3; ++run) {
+        same = true;
+        world.RaycastBatch(&rays[0], &hits[0], count, run == 2 ? 2 : 0);
+        for(int i = 0; i < count; ++i) {
+            same = same && SameHit(expected[i], hits[i]);
+        }
+        TEST_CHECK(same);
+    }
+    world.StopWorkers();
+    TEST_CHECK(world.mWorkers == 0);
+
+    same = true;
+    world.RaycastBatch(&rays[0], &hits[0], count, 0);
+    for(int i = 0; i < count; ++i) {
+        same = same && SameHit(expected[i], hits[i]);
+    }
+    TEST_CHECK(same);
+}
+
+void RunRaycastTests() {
+    TestBatchOnWorkers();
+}
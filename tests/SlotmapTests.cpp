@@ -0,0 +1,101 @@
+#include "Test.h"
+#include "Slotmap.h"
+
+// A freed slot is handed out again with a new generation, the old key
+// stops working and the new one finds the new value
+static void TestGenerationReuse() {
+    Slotmap<int> map;
+    map.Initialize(4);
+    SlotmapKey a = map.AddComponent(1);
+    SlotmapKey b = map.AddComponent(2);
+    map.RemoveComponent(a);
+    SlotmapKey c = map.AddComponent(3);
+    TEST_CHECK(c.mId == a.mId);
+    TEST_CHECK(c.mGen == a.mGen + 1);
+    TEST_CHECK(map.GetComponent(a) == 0);
+    TEST_CHECK(map.GetComponent(c) && *map.GetComponent(c) == 3);
+    TEST_CHECK(map.GetComponent(b) && *map.GetComponent(b) == 2);
+    TEST_CHECK(map.Size() == 2);
+}
+
+// Removing from the middle moves the last value into the hole, the keys
+// of the moved value still find it
+static void TestRemoveKeepsDenseData() {
+    Slotmap<int> map;
+    map.Initialize();
+    SlotmapKey keys[8];
+    for(int i = 0; i < 8; ++i) {
+        keys[i] = map.AddComponent(i * 10);
+    }
+    map.RemoveComponent(keys[2]);
+    map.RemoveComponent(keys[5]);
+    TEST_CHECK(map.Size() == 6);
+    for(int i = 0; i < 8; ++i) {
+        int *value = map.GetComponent(keys[i]);
+        if(i == 2 || i == 5) {
+            TEST_CHECK(value == 0);
+        }
+        else {
+            TEST_CHECK(value && *value == i * 10);
+        }
+    }
+    for(unsigned int i = 0; i < map.Size(); ++i) {
+        SlotmapKey key = map.GetKey(i);
+        TEST_CHECK(map.GetComponent(key) == &map[i]);
+    }
+}
+
+// A key kept across a remove and a reinsert into the same slot is rejected
+// by every accessor, in both storage layouts
+static void TestStaleHandleRejected() {
+    Slotmap<int> map;
+    map.Initialize();
+    SlotmapKey stale = map.AddComponent(1);
+    map.RemoveComponent(stale);
+    TEST_CHECK(!map.IsValid(stale));
+    TEST_CHECK(map.GetComponent(stale) == 0);
+    SlotmapKey fresh = map.AddComponent(2);
+    TEST_CHECK(fresh.mId == stale.mId);
+    TEST_CHECK(!map.IsValid(stale));
+    TEST_CHECK(map.GetComponent(stale) == 0);
+    TEST_CHECK(map.IsValid(fresh) && *map.GetComponent(fresh) == 2);
+
+    SlotmapSoA<int, float> soa;
+    soa.Initialize();
+    SlotmapKey soaStale = soa.AddComponent(1, 1.0f);
+    soa.AddComponent(2, 2.0f);
+    soa.RemoveComponent(soaStale);
+    SlotmapKey soaFresh = soa.AddComponent(3, 3.0f);
+    TEST_CHECK(soaFresh.mId == soaStale.mId);
+    TEST_CHECK(!soa.IsValid(soaStale));
+    TEST_CHECK(soa.Get<0>(soaStale) == 0 && soa.Get<1>(soaStale) == 0);
+    TEST_CHECK(soa.Get<0>(soaFresh) && *soa.Get<0>(soaFresh) == 3);
+    TEST_CHECK(soa.Get<1>(soaFresh) && *soa.Get<1>(soaFresh) == 3.0f);
+}
+
+// The generation of a slot wraps around to 0 after its last value, the key
+// holding the last generation is stale and the wrapped key is valid
+static void TestGenerationWraparound() {
+    Slotmap<int> map;
+    map.Initialize();
+    SlotmapKey first = map.AddComponent(1);
+    map.RemoveComponent(first);
+    // Skip the 4 billion reuses it takes to get there
+    map.mIndex.mIndices[first.mId].mGen = 0xFFFFFFFF;
+    SlotmapKey last = map.AddComponent(2);
+    TEST_CHECK(last.mId == first.mId && last.mGen == 0xFFFFFFFF);
+    TEST_CHECK(map.GetComponent(last) && *map.GetComponent(last) == 2);
+    map.RemoveComponent(last);
+    SlotmapKey wrapped = map.AddComponent(3);
+    TEST_CHECK(wrapped.mId == first.mId && wrapped.mGen == 0);
+    TEST_CHECK(!map.IsValid(last));
+    TEST_CHECK(map.GetComponent(last) == 0);
+    TEST_CHECK(map.GetComponent(wrapped) && *map.GetComponent(wrapped) == 3);
+}
+
+void RunSlotmapTests() {
+    TestGenerationReuse();
+    TestRemoveKeepsDenseData();
+    TestStaleHandleRejected();
+    TestGenerationWraparound();
+}
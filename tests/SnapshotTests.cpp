@@ -0,0 +1,64 @@
+#include "Test.h"
+#include "Snapshot.h"
+
+#include <string.h>
+#include <vector>
+
+// A frame of fake game state, most of it the same as the frame before
+static void MakeSnapshot(GameSnapshot *snapshot, unsigned int frame) {
+    memset((void *)snapshot, 0, sizeof(GameSnapshot));
+    snapshot->mPlayerTransform.mPosition = vec3((float)frame * 0.1f, 0.5f, 3.0f);
+    snapshot->mPlayerRotation = (float)(frame / 30);
+    snapshot->mCurrentAnim = (frame / 100) % 4;
+    snapshot->mCharacterCount = 32;
+    for(unsigned int i = 0; i < snapshot->mCharacterCount; ++i) {
+        CharacterSnapshot *character = &snapshot->mCharacters[i];
+        character->mEntity.mId = i;
+        character->mTransform.mPosition = vec3((float)i, 0.0f, (float)(i * 2));
+        // A few characters move every frame
+        if(i % 8 == 0) {
+            character->mPlayback = (float)frame / 60.0f;
+        }
+    }
+}
+
+// Every stored snapshot comes back byte for byte, also after the ring
+// dropped the oldest ones, and Rewind forgets the newer ones
+static void TestSnapshotDeltaRoundTrip() {
+    const unsigned int frames = SNAPSHOT_RING_SIZE + 100;
+    std::vector<GameSnapshot> history(frames);
+    GameSnapshot *out = new GameSnapshot();
+    SnapshotRing *ring = new SnapshotRing();
+    ring->Initialize();
+    for(unsigned int i = 0; i < frames; ++i) {
+        MakeSnapshot(&history[i], i);
+        ring->Push(&history[i]);
+    }
+    TEST_CHECK(ring->Count() == SNAPSHOT_RING_SIZE);
+    TEST_CHECK(ring->BytesUsed() < (size_t)SNAPSHOT_RING_SIZE * sizeof(GameSnapshot) / 10);
+
+    bool same = true;
+    for(unsigned int age = 0; age < ring->Count(); ++age) {
+        same = same && ring->Get(age, out) && memcmp(out, &history[frames - 1 - age], sizeof(GameSnapshot)) == 0;
+    }
+    TEST_CHECK(same);
+    TEST_CHECK(!ring->Get(ring->Count(), out));
+
+    TEST_CHECK(ring->Rewind(10, out));
+    TEST_CHECK(memcmp(out, &history[frames - 11], sizeof(GameSnapshot)) == 0);
+    TEST_CHECK(ring->Count() == SNAPSHOT_RING_SIZE - 10);
+    TEST_CHECK(ring->Get(0, out) && memcmp(out, &history[frames - 11], sizeof(GameSnapshot)) == 0);
+
+    // Pushing after a rewind continues from the rewound frame
+    ring->Push(&history[frames - 1]);
+    TEST_CHECK(ring->Get(1, out) && memcmp(out, &history[frames - 11], sizeof(GameSnapshot)) == 0);
+    TEST_CHECK(ring->Get(5, out) && memcmp(out, &history[frames - 15], sizeof(GameSnapshot)) == 0);
+
+    ring->Shutdown();
+    delete ring;
+    delete out;
+}
+
+void RunSnapshotTests() {
+    TestSnapshotDeltaRoundTrip();
+}
@@ -0,0 +1,29 @@
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <stdio.h>
+
+// A failed check is printed and counted, the run goes on so a single pass
+// lists every failure. main returns non zero when any check failed
+extern int gTestChecks;
+extern int gTestFailures;
+
+#define TEST_CHECK(condition) \
+    do { \
+        gTestChecks++; \
+        if(!(condition)) { \
+            gTestFailures++; \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while(0)
+
+void RunSlotmapTests();
+void RunEcsTests();
+void RunBroadphaseTests();
+void RunMemoryTests();
+void RunSnapshotTests();
+void RunMotionMatchingTests();
+void RunRaycastTests();
+void RunAnimationTests();
+
+#endif
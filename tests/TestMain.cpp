@@ -0,0 +1,40 @@
+#include "Test.h"
+#include "Arena.h"
+#include "Platform.h"
+
+#include <chrono>
+
+int gTestChecks = 0;
+int gTestFailures = 0;
+
+// No window or input, the profiler markers only need the timer
+double PlatformGetSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct TestGroup {
+    const char *mName;
+    void (*mRun)();
+};
+
+int main(int argc, char **argv) {
+    MemoryInitialize();
+    TestGroup groups[] = {
+        { "slotmap", RunSlotmapTests },
+        { "ecs", RunEcsTests },
+        { "broadphase", RunBroadphaseTests },
+        { "memory", RunMemoryTests },
+        { "snapshot", RunSnapshotTests },
+        { "motion matching", RunMotionMatchingTests },
+        { "raycast", RunRaycastTests },
+        { "animation", RunAnimationTests }
+    };
+    for(unsigned int i = 0; i < sizeof(groups) / sizeof(groups[0]); ++i) {
+        int failures = gTestFailures;
+        groups[i].mRun();
+        printf("%-16s %s\n", groups[i].mName, gTestFailures == failures ? "ok" : "FAILED");
+    }
+    printf("%d checks, %d failed\n", gTestChecks, gTestFailures);
+    MemoryShutdown();
+    return gTestFailures ? 1 : 0;
+}
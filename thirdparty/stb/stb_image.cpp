@@ -1,2 +1,6 @@
+#include "AllocTracker.h"
+#define STBI_MALLOC(size) TrackedMalloc(size, ALLOC_TAG_TEXTURE)
+#define STBI_REALLOC(ptr, size) TrackedRealloc(ptr, size, ALLOC_TAG_TEXTURE)
+#define STBI_FREE(ptr) TrackedFree(ptr)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"